@@ -17,31 +17,31 @@ namespace HLE {
 
 // Region management
 
-std::array<SharedMemory, 2> g_regions;
+Memory::Fastmem::BackingPtr<std::array<SharedMemory, 2>> g_regions;
 
 static size_t CurrentRegionIndex() {
     // The region with the higher frame counter is chosen unless there is wraparound.
     // This function only returns a 0 or 1.
 
-    if (g_regions[0].frame_counter == 0xFFFFu && g_regions[1].frame_counter != 0xFFFEu) {
+    if ((*g_regions)[0].frame_counter == 0xFFFFu && (*g_regions)[1].frame_counter != 0xFFFEu) {
         // Wraparound has occured.
         return 1;
     }
 
-    if (g_regions[1].frame_counter == 0xFFFFu && g_regions[0].frame_counter != 0xFFFEu) {
+    if ((*g_regions)[1].frame_counter == 0xFFFFu && (*g_regions)[0].frame_counter != 0xFFFEu) {
         // Wraparound has occured.
         return 0;
     }
 
-    return (g_regions[0].frame_counter > g_regions[1].frame_counter) ? 0 : 1;
+    return ((*g_regions)[0].frame_counter > (*g_regions)[1].frame_counter) ? 0 : 1;
 }
 
 static SharedMemory& ReadRegion() {
-    return g_regions[CurrentRegionIndex()];
+    return (*g_regions)[CurrentRegionIndex()];
 }
 
 static SharedMemory& WriteRegion() {
-    return g_regions[1 - CurrentRegionIndex()];
+    return (*g_regions)[1 - CurrentRegionIndex()];
 }
 
 // Audio processing and mixing
@@ -129,6 +129,8 @@ void EnableStretching(bool enable) {
 // Public Interface
 
 void Init() {
+    g_regions = Memory::Fastmem::MakeBacking<std::array<SharedMemory, 2>>();
+
     DSP::HLE::ResetPipes();
 
     for (auto& source : sources) {
@@ -147,6 +149,8 @@ void Shutdown() {
     if (perform_time_stretching) {
         FlushResidualStretcherAudio();
     }
+
+    g_regions = nullptr;
 }
 
 bool Tick() {
@@ -16,6 +16,8 @@
 #include "common/common_types.h"
 #include "common/swap.h"
 
+#include "core/fastmem.h"
+
 namespace AudioCore {
 class Sink;
 }
@@ -503,7 +505,8 @@ struct SharedMemory {
 };
 ASSERT_DSP_STRUCT(SharedMemory, 0x8000);
 
-extern std::array<SharedMemory, 2> g_regions;
+/// Allocated in the fastmem backing pool, so that guest accesses don't take the slow path
+extern Memory::Fastmem::BackingPtr<std::array<SharedMemory, 2>> g_regions;
 
 // Structures must have an offset that is a multiple of two.
 static_assert(offsetof(SharedMemory, frame_counter) % 2 == 0, "Structures in DSP::HLE::SharedMemory must be 2-byte aligned");
@@ -0,0 +1,187 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/microprofile.h"
+#include "common/scm_rev.h"
+#include "common/string_util.h"
+
+#include "core/core.h"
+#include "core/settings.h"
+
+#include "citra/benchmark.h"
+
+#include "video_core/renderer_base.h"
+#include "video_core/video_core.h"
+
+namespace Benchmark {
+
+/// Times spent in a frame, in milliseconds
+struct FrameTimes {
+    double host;  ///< Wall clock time
+    double cpu;   ///< Guest code, including HLE service calls but not the GPU work they trigger
+    double gpu;   ///< Command lists, display transfers, memory fills and GSP DMAs
+    double audio; ///< DSP emulation and audio output
+};
+
+/// Reads the times of the last frame MicroProfile finished collecting
+static FrameTimes ReadProfilerTimes() {
+    FrameTimes times{};
+    times.gpu = MicroProfileGetTime("GPU", "Cmdlist Processing") +
+                MicroProfileGetTime("GPU", "DisplayTransfer") +
+                MicroProfileGetTime("GPU", "MemoryFill") +
+                MicroProfileGetTime("GPU", "GSP DMA");
+    times.audio = MicroProfileGetTime("Audio", "Tick");
+
+    // The GPU is driven by register writes and service calls of the guest, so its timers are
+    // nested in the CPU timer
+    const double cpu_total = Settings::values.use_cpu_jit ? MicroProfileGetTime("ARM JIT", "ARM JIT")
+                                                          : MicroProfileGetTime("DynCom", "Execute");
+    times.cpu = std::max(0.0, cpu_total - times.gpu);
+    return times;
+}
+
+static std::string EscapeJSON(const std::string& str) {
+    std::string result;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            result += Common::StringFromFormat("\\u%04x", c);
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+/// Formats the statistics of one of the times of all frames as a JSON object
+static std::string FormatStatistics(const std::vector<FrameTimes>& frames, double FrameTimes::*member) {
+    std::vector<double> values;
+    values.reserve(frames.size());
+    for (const FrameTimes& frame : frames)
+        values.push_back(frame.*member);
+    std::sort(values.begin(), values.end());
+
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+
+    const auto percentile = [&values](double p) {
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+    };
+
+    return Common::StringFromFormat(
+        "{ \"mean\": %.3f, \"min\": %.3f, \"median\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+        sum / values.size(), values.front(), percentile(0.5), percentile(0.99), values.back());
+}
+
+static std::string FormatReport(const std::string& title, const std::vector<FrameTimes>& frames,
+                                double total_ms) {
+    std::string report = "{\n";
+    report += Common::StringFromFormat("  \"title\": \"%s\",\n", EscapeJSON(title).c_str());
+    report += Common::StringFromFormat("  \"version\": \"%s %s\",\n", EscapeJSON(Common::g_scm_branch).c_str(),
+                                       EscapeJSON(Common::g_scm_desc).c_str());
+    report += Common::StringFromFormat("  \"cpu_backend\": \"%s\",\n",
+                                       Settings::values.use_cpu_jit ? "jit" : "interpreter");
+    report += Common::StringFromFormat("  \"vblanks\": %zu,\n", frames.size());
+    report += Common::StringFromFormat("  \"total_ms\": %.3f,\n", total_ms);
+    report += Common::StringFromFormat("  \"vblanks_per_second\": %.3f,\n", frames.size() * 1000.0 / total_ms);
+
+    report += "  \"summary\": {\n";
+    report += "    \"host_ms\": " + FormatStatistics(frames, &FrameTimes::host) + ",\n";
+    report += "    \"cpu_ms\": " + FormatStatistics(frames, &FrameTimes::cpu) + ",\n";
+    report += "    \"gpu_ms\": " + FormatStatistics(frames, &FrameTimes::gpu) + ",\n";
+    report += "    \"audio_ms\": " + FormatStatistics(frames, &FrameTimes::audio) + "\n";
+    report += "  },\n";
+
+    report += "  \"frames\": [\n";
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const FrameTimes& frame = frames[i];
+        report += Common::StringFromFormat(
+            "    { \"host_ms\": %.3f, \"cpu_ms\": %.3f, \"gpu_ms\": %.3f, \"audio_ms\": %.3f }%s\n",
+            frame.host, frame.cpu, frame.gpu, frame.audio, i + 1 < frames.size() ? "," : "");
+    }
+    report += "  ]\n";
+    report += "}\n";
+    return report;
+}
+
+bool Run(const std::string& title, unsigned vblanks, const std::string& output_filename) {
+    using Clock = std::chrono::steady_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    // Timers are only recorded in enabled groups, which is normally left to the MicroProfile UI
+    MicroProfileSetForceEnable(true);
+    MicroProfileSetEnableAllGroups(true);
+
+    // MicroProfile is flipped on every VBlank, but only reports the timers of a frame a few flips
+    // after it ended
+#if MICROPROFILE_ENABLED
+    const size_t profiler_delay = MICROPROFILE_GPU_FRAME_DELAY;
+#else
+    const size_t profiler_delay = 0;
+#endif
+
+    std::vector<double> host_times;
+    std::vector<FrameTimes> profiler_times;
+    host_times.reserve(vblanks);
+    profiler_times.reserve(vblanks + profiler_delay);
+
+    int last_frame = VideoCore::g_renderer->GetCurrentFrame();
+    const Clock::time_point start = Clock::now();
+    Clock::time_point frame_start = start;
+    Clock::time_point end = start;
+
+    while (profiler_times.size() < vblanks + profiler_delay) {
+        Core::RunLoop();
+
+        const int frame = VideoCore::g_renderer->GetCurrentFrame();
+        if (frame == last_frame)
+            continue;
+
+        if (frame != last_frame + 1) {
+            LOG_WARNING(Frontend, "%d VBlanks passed in a single CPU slice, frame times are merged",
+                        frame - last_frame);
+        }
+        last_frame = frame;
+
+        const Clock::time_point now = Clock::now();
+        if (host_times.size() < vblanks) {
+            host_times.push_back(Milliseconds(now - frame_start).count());
+            end = now;
+        }
+        frame_start = now;
+
+        profiler_times.push_back(ReadProfilerTimes());
+    }
+
+    std::vector<FrameTimes> frames(vblanks);
+    for (size_t i = 0; i < vblanks; ++i) {
+        frames[i] = profiler_times[i + profiler_delay];
+        frames[i].host = host_times[i];
+    }
+
+    const std::string report = FormatReport(title, frames, Milliseconds(end - start).count());
+    if (output_filename.empty()) {
+        std::fputs(report.c_str(), stdout);
+        return true;
+    }
+
+    FileUtil::IOFile file(output_filename, "w");
+    if (!file.IsOpen() || file.WriteBytes(report.data(), report.size()) != report.size()) {
+        LOG_CRITICAL(Frontend, "Failed to write the benchmark report to %s", output_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,22 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+
+namespace Benchmark {
+
+/**
+ * Runs the loaded application for a number of VBlanks as fast as possible, and reports the time
+ * spent in each frame as JSON. The core must have been set up for a headless run, with the null
+ * renderer, the null audio sink, no frame limiting and no frameskip.
+ * @param title Name of the application, copied to the report
+ * @param vblanks Number of VBlanks to measure
+ * @param output_filename File to write the report to, or empty for the standard output
+ * @return False if the report couldn't be written
+ */
+bool Run(const std::string& title, unsigned vblanks, const std::string& output_filename);
+
+} // namespace
@@ -21,8 +21,11 @@
 #include <Windows.h>
 #endif
 
+#include "common/common_paths.h"
+#include "common/file_util.h"
 #include "common/logging/log.h"
 #include "common/logging/backend.h"
+#include "common/logging/binary_log.h"
 #include "common/logging/filter.h"
 #include "common/scm_rev.h"
 #include "common/scope_exit.h"
@@ -34,7 +37,9 @@
 #include "core/gdbstub/gdbstub.h"
 #include "core/loader/loader.h"
 
+#include "citra/benchmark.h"
 #include "citra/config.h"
+#include "citra/emu_window/emu_window_null.h"
 #include "citra/emu_window/emu_window_sdl2.h"
 
 #include "video_core/video_core.h"
@@ -43,9 +48,12 @@
 static void PrintHelp(const char *argv0)
 {
     std::cout << "Usage: " << argv0 << " [options] <filename>\n"
-                 "-g, --gdbport=NUMBER  Enable gdb stub on port NUMBER\n"
-                 "-h, --help            Display this help and exit\n"
-                 "-v, --version         Output version information and exit\n";
+                 "-b, --benchmark=VBLANKS       Run headless for VBLANKS VBlanks as fast as possible,\n"
+                 "                              then print the frame times as JSON and exit\n"
+                 "-o, --benchmark-output=FILE   Write the benchmark report to FILE instead\n"
+                 "-g, --gdbport=NUMBER          Enable gdb stub on port NUMBER\n"
+                 "-h, --help                    Display this help and exit\n"
+                 "-v, --version                 Output version information and exit\n";
 }
 
 static void PrintVersion()
@@ -70,8 +78,12 @@ int main(int argc, char **argv) {
     }
 #endif
     std::string boot_filename;
+    unsigned benchmark_vblanks = 0;
+    std::string benchmark_output;
 
     static struct option long_options[] = {
+        { "benchmark", required_argument, 0, 'b' },
+        { "benchmark-output", required_argument, 0, 'o' },
         { "gdbport", required_argument, 0, 'g' },
         { "help", no_argument, 0, 'h' },
         { "version", no_argument, 0, 'v' },
@@ -79,9 +91,21 @@ int main(int argc, char **argv) {
     };
 
     while (optind < argc) {
-        char arg = getopt_long(argc, argv, "g:hv", long_options, &option_index);
+        char arg = getopt_long(argc, argv, "b:o:g:hv", long_options, &option_index);
         if (arg != -1) {
             switch (arg) {
+            case 'b':
+                errno = 0;
+                benchmark_vblanks = strtoul(optarg, &endarg, 0);
+                if (endarg == optarg || benchmark_vblanks == 0) errno = EINVAL;
+                if (errno != 0) {
+                    perror("--benchmark");
+                    exit(1);
+                }
+                break;
+            case 'o':
+                benchmark_output = optarg;
+                break;
             case 'g':
                 errno = 0;
                 gdb_port = strtoul(optarg, &endarg, 0);
@@ -116,6 +140,10 @@ int main(int argc, char **argv) {
     Log::Filter log_filter(Log::Level::Debug);
     Log::SetFilter(&log_filter);
 
+    const std::string log_dir = FileUtil::GetUserPath(D_LOGS_IDX);
+    FileUtil::CreateFullPath(log_dir);
+    Log::AddSink(std::make_unique<Log::FileSink>(log_dir + MAIN_LOG));
+
     MicroProfileOnThreadCreate("EmuThread");
     SCOPE_EXIT({ MicroProfileShutdown(); });
 
@@ -125,15 +153,36 @@ int main(int argc, char **argv) {
     }
 
     log_filter.ParseFilterString(Settings::values.log_filter);
+    if (Settings::values.use_binary_log && !Log::BinaryLog::Enable(log_dir + BINARY_LOG)) {
+        LOG_ERROR(Frontend, "Failed to create the binary log in %s", log_dir.c_str());
+    }
 
     // Apply the command line arguments
     Settings::values.gdbstub_port = gdb_port;
     Settings::values.use_gdbstub = use_gdbstub;
+    if (benchmark_vblanks != 0) {
+        // Run headless, as fast as possible and the same way on every machine
+        Settings::values.use_null_renderer = true;
+        Settings::values.use_hw_renderer = false;
+        Settings::values.use_vsync = false;
+        Settings::values.frame_skip = 0;
+        Settings::values.sink_id = "null";
+        Settings::values.enable_audio_stretching = false;
+    }
     Settings::Apply();
 
-    std::unique_ptr<EmuWindow_SDL2> emu_window = std::make_unique<EmuWindow_SDL2>();
+    std::unique_ptr<EmuWindow_SDL2> sdl_window;
+    std::unique_ptr<EmuWindow_Null> null_window;
+    EmuWindow* emu_window;
+    if (benchmark_vblanks != 0) {
+        null_window = std::make_unique<EmuWindow_Null>();
+        emu_window = null_window.get();
+    } else {
+        sdl_window = std::make_unique<EmuWindow_SDL2>();
+        emu_window = sdl_window.get();
+    }
 
-    System::Init(emu_window.get());
+    System::Init(emu_window);
     SCOPE_EXIT({ System::Shutdown(); });
 
     std::unique_ptr<Loader::AppLoader> loader = Loader::GetLoader(boot_filename);
@@ -148,7 +197,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
-    while (emu_window->IsOpen()) {
+    if (benchmark_vblanks != 0) {
+        return Benchmark::Run(boot_filename, benchmark_vblanks, benchmark_output) ? 0 : -1;
+    }
+
+    while (sdl_window->IsOpen()) {
         Core::RunLoop();
     }
 
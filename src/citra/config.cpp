@@ -66,13 +66,21 @@ void Config::ReadValues() {
 
     // Core
     Settings::values.use_cpu_jit = sdl2_config->GetBoolean("Core", "use_cpu_jit", true);
+    Settings::values.use_interpreter_block_cache = sdl2_config->GetBoolean("Core", "use_interpreter_block_cache", false);
+    Settings::values.use_fastmem = sdl2_config->GetBoolean("Core", "use_fastmem", false);
     Settings::values.frame_skip = sdl2_config->GetInteger("Core", "frame_skip", 0);
 
     // Renderer
     Settings::values.use_hw_renderer = sdl2_config->GetBoolean("Renderer", "use_hw_renderer", true);
     Settings::values.use_shader_jit = sdl2_config->GetBoolean("Renderer", "use_shader_jit", true);
+    Settings::values.use_shader_jit_disk_cache = sdl2_config->GetBoolean("Renderer", "use_shader_jit_disk_cache", true);
+    Settings::values.use_shader_jit_async = sdl2_config->GetBoolean("Renderer", "use_shader_jit_async", true);
+    Settings::values.use_shader_jit_batch = sdl2_config->GetBoolean("Renderer", "use_shader_jit_batch", true);
     Settings::values.use_scaled_resolution = sdl2_config->GetBoolean("Renderer", "use_scaled_resolution", false);
     Settings::values.use_vsync = sdl2_config->GetBoolean("Renderer", "use_vsync", false);
+    Settings::values.sw_rasterizer_threads = sdl2_config->GetInteger("Renderer", "sw_rasterizer_threads", 0);
+    Settings::values.vertex_shader_threads = sdl2_config->GetInteger("Renderer", "vertex_shader_threads", 0);
+    Settings::values.surface_cache_size = sdl2_config->GetInteger("Renderer", "surface_cache_size", 256);
 
     Settings::values.bg_red   = (float)sdl2_config->GetReal("Renderer", "bg_red",   1.0);
     Settings::values.bg_green = (float)sdl2_config->GetReal("Renderer", "bg_green", 1.0);
@@ -91,10 +99,12 @@ void Config::ReadValues() {
 
     // Miscellaneous
     Settings::values.log_filter = sdl2_config->Get("Miscellaneous", "log_filter", "*:Info");
+    Settings::values.use_binary_log = sdl2_config->GetBoolean("Miscellaneous", "use_binary_log", false);
 
     // Debugging
     Settings::values.use_gdbstub = sdl2_config->GetBoolean("Debugging", "use_gdbstub", false);
     Settings::values.gdbstub_port = static_cast<u16>(sdl2_config->GetInteger("Debugging", "gdbstub_port", 24689));
+    Settings::values.use_guest_profiler = sdl2_config->GetBoolean("Debugging", "use_guest_profiler", false);
 }
 
 void Config::Reload() {
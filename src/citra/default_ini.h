@@ -42,6 +42,15 @@ pad_circle_modifier_scale =
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_cpu_jit =
 
+# Whether the interpreter remembers the code blocks it translated across sessions, so that known code
+# gets translated up front instead of one block at a time
+# 0 (default): Off, 1: On
+use_interpreter_block_cache =
+
+# Whether to mirror the guest address space into host memory for direct memory accesses (Linux x64 only)
+# 0 (default): Off, 1: On
+use_fastmem =
+
 # The applied frameskip amount. Must be a power of two.
 # 0 (default): No frameskip, 1: x2 frameskip, 2: x4 frameskip, 3: x8 frameskip, etc.
 frame_skip =
@@ -55,6 +64,21 @@ use_hw_renderer =
 # 0: Interpreter (slow), 1 (default): JIT (fast)
 use_shader_jit =
 
+# Whether to store shaders compiled by the JIT on disk, so that they don't need to be compiled again
+# the next time a game is started. Only used if use_shader_jit is enabled.
+# 0: Off, 1 (default): On
+use_shader_jit_disk_cache =
+
+# Whether to compile new shaders on a background thread instead of stalling the draw using them.
+# Such draws use the interpreter until compilation has finished. Only used if use_shader_jit is enabled.
+# 0: Off, 1 (default): On
+use_shader_jit_async =
+
+# Whether to shade several vertices at once with a vectorized variant of the shader JIT.
+# Requires SSE4.1 and is only used if use_shader_jit is enabled and vertex_shader_threads is not 1.
+# 0: Off, 1 (default): On
+use_shader_jit_batch =
+
 # Whether to use native 3DS screen resolution or to scale rendering resolution to the displayed screen size.
 # 0 (default): Native, 1: Scaled
 use_scaled_resolution =
@@ -63,6 +87,20 @@ use_scaled_resolution =
 # 0 (default): Off, 1: On
 use_vsync =
 
+# Number of threads used by the software renderer to rasterize triangles in parallel screen tiles.
+# 0 (default): One per host CPU thread, 1: Single-threaded (no tiling), 2 or more: Use that many
+sw_rasterizer_threads =
+
+# Number of threads used to run the vertex shader for the vertices of a draw call in parallel.
+# Draws using a geometry shader are always processed on a single thread.
+# 0 (default): One per host CPU thread, 1: Single-threaded, 2 or more: Use that many
+vertex_shader_threads =
+
+# Memory budget of the hardware renderer's surface cache, in MiB. When it is exceeded, the least
+# recently used surfaces that don't hold unflushed GPU writes are evicted.
+# 0: Unlimited, 256 (default): 256 MiB
+surface_cache_size =
+
 # The clear color for the renderer. What shows up on the sides of the bottom screen.
 # Must be in range of 0.0-1.0. Defaults to 1.0 for all.
 bg_red =
@@ -99,10 +137,20 @@ region_value =
 # Examples: *:Debug Kernel.SVC:Trace Service.*:Critical
 log_filter = *:Info
 
+# Records log messages unformatted into a binary file in the logs directory, to be decoded with
+# citra-logdump. Makes verbose log filters cheap; only warnings and errors are still printed.
+# 0 (default): Off, 1: On
+use_binary_log =
+
 [Debugging]
 # Port for listening to GDB connections.
 use_gdbstub=false
 gdbstub_port=24689
+
+# Samples the guest PC while emulating, and writes the samples to guest_profile.folded in the logs
+# directory on shutdown, in the collapsed stack format read by flamegraph.pl
+# 0 (default): Off, 1: On
+use_guest_profiler =
 )";
 
 }
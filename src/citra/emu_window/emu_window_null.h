@@ -0,0 +1,19 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/emu_window.h"
+
+/// Window without any display or input, for headless runs with the null renderer
+class EmuWindow_Null final : public EmuWindow {
+public:
+    ~EmuWindow_Null() override = default;
+
+    void SwapBuffers() override {}
+    void PollEvents() override {}
+    void MakeCurrent() override {}
+    void DoneCurrent() override {}
+    void ReloadSetKeymaps() override {}
+};
@@ -0,0 +1,201 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+// Measures the throughput of the software implementations of the GPU memory fills, display
+// transfers and texture copies. Throughput counts the bytes read plus the bytes written, the same
+// way for all three operations.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/logging/backend.h"
+#include "common/logging/filter.h"
+#include "common/logging/log.h"
+
+#include "core/hw/display_transfer.h"
+#include "core/hw/gpu.h"
+#include "core/hw/memory_fill.h"
+
+using PixelFormat = GPU::Regs::PixelFormat;
+
+/// Size of the filled region and of the texture copies, larger than the last level cache
+static constexpr size_t BUFFER_SIZE = 4 * 1024 * 1024;
+/// Size of the display transfer images, in pixels
+static constexpr u32 IMAGE_WIDTH = 1024;
+static constexpr u32 IMAGE_HEIGHT = 512;
+/// Each operation is repeated for at least this long
+static constexpr std::chrono::milliseconds MIN_DURATION(200);
+
+static const std::array<PixelFormat, 5> pixel_formats = {{
+    PixelFormat::RGBA8, PixelFormat::RGB8, PixelFormat::RGB565, PixelFormat::RGB5A1, PixelFormat::RGBA4,
+}};
+
+static const char* GetPixelFormatName(PixelFormat format) {
+    switch (format) {
+    case PixelFormat::RGBA8:
+        return "RGBA8";
+    case PixelFormat::RGB8:
+        return "RGB8";
+    case PixelFormat::RGB565:
+        return "RGB565";
+    case PixelFormat::RGB5A1:
+        return "RGB5A1";
+    case PixelFormat::RGBA4:
+        return "RGBA4";
+    }
+    return "Unknown";
+}
+
+/**
+ * Runs the operation once to warm up the caches, then repeatedly for at least MIN_DURATION
+ * @return Throughput in GB/s
+ */
+template <typename Function>
+static double MeasureThroughput(size_t bytes_per_run, const Function& function) {
+    using Clock = std::chrono::steady_clock;
+
+    function();
+
+    size_t runs = 0;
+    const Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do {
+        function();
+        ++runs;
+        elapsed = Clock::now() - start;
+    } while (elapsed < MIN_DURATION);
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return static_cast<double>(bytes_per_run) * runs / seconds / 1e9;
+}
+
+static void BenchmarkMemoryFill(u8* buffer) {
+    struct FillMode {
+        const char* name;
+        bool fill_24bit;
+        bool fill_32bit;
+    };
+    static const std::array<FillMode, 3> fill_modes = {{
+        { "16-bit", false, false },
+        { "24-bit", true, false },
+        { "32-bit", false, true },
+    }};
+
+    std::printf("Memory fill (%zu KiB)\n", BUFFER_SIZE / 1024);
+    for (const FillMode& mode : fill_modes) {
+        GPU::Regs::MemoryFillConfig config{};
+        config.value_32bit = 0x12345678;
+        config.fill_24bit.Assign(mode.fill_24bit);
+        config.fill_32bit.Assign(mode.fill_32bit);
+
+        const double throughput = MeasureThroughput(BUFFER_SIZE, [&] {
+            HW::MemoryFill::PerformMemoryFill(config, buffer, buffer + BUFFER_SIZE);
+        });
+        std::printf("  %-8s %8.2f GB/s\n", mode.name, throughput);
+    }
+}
+
+static void BenchmarkDisplayTransfer(const u8* src, u8* dst) {
+    struct Layout {
+        const char* name;
+        bool input_linear;
+        bool dont_swizzle;
+    };
+    static const std::array<Layout, 2> layouts = {{
+        { "tiled -> linear", false, false },
+        { "linear -> tiled", true, false },
+    }};
+
+    for (const Layout& layout : layouts) {
+        std::printf("Display transfer, %s (%ux%u)\n", layout.name, IMAGE_WIDTH, IMAGE_HEIGHT);
+        for (PixelFormat input_format : pixel_formats) {
+            for (PixelFormat output_format : pixel_formats) {
+                GPU::Regs::DisplayTransferConfig config{};
+                config.input_width.Assign(IMAGE_WIDTH);
+                config.input_height.Assign(IMAGE_HEIGHT);
+                config.output_width.Assign(IMAGE_WIDTH);
+                config.output_height.Assign(IMAGE_HEIGHT);
+                config.input_linear.Assign(layout.input_linear);
+                config.dont_swizzle.Assign(layout.dont_swizzle);
+                config.input_format.Assign(input_format);
+                config.output_format.Assign(output_format);
+
+                const size_t bytes = IMAGE_WIDTH * IMAGE_HEIGHT *
+                    (GPU::Regs::BytesPerPixel(input_format) + GPU::Regs::BytesPerPixel(output_format));
+                const double throughput = MeasureThroughput(bytes, [&] {
+                    HW::DisplayTransfer::PerformDisplayTransfer(config, src, dst);
+                });
+                std::printf("  %-6s -> %-6s %8.2f GB/s\n", GetPixelFormatName(input_format),
+                            GetPixelFormatName(output_format), throughput);
+            }
+        }
+    }
+}
+
+static void BenchmarkTextureCopy(const u8* src, u8* dst) {
+    struct Gaps {
+        u32 input_width; ///< In units of 16 bytes, as in the registers
+        u32 input_gap;
+        u32 output_width;
+        u32 output_gap;
+    };
+    // Contiguous copies, then copies of 256 pixel wide RGBA8 columns out of and into 1024 pixel
+    // wide images
+    static const std::array<Gaps, 3> gaps = {{
+        { 0, 0, 0, 0 },
+        { 64, 192, 64, 0 },
+        { 64, 0, 64, 192 },
+    }};
+
+    std::printf("Texture copy (%zu KiB)\n", BUFFER_SIZE / 4 / 1024);
+    for (const Gaps& gap : gaps) {
+        GPU::Regs::DisplayTransferConfig config{};
+        config.is_texture_copy.Assign(1);
+        // The gaps of the larger images must stay within the buffers
+        config.texture_copy.size = static_cast<u32>(BUFFER_SIZE / 4);
+        config.texture_copy.input_width.Assign(gap.input_width);
+        config.texture_copy.input_gap.Assign(gap.input_gap);
+        config.texture_copy.output_width.Assign(gap.output_width);
+        config.texture_copy.output_gap.Assign(gap.output_gap);
+
+        const double throughput = MeasureThroughput(config.texture_copy.size * 2, [&] {
+            HW::DisplayTransfer::PerformTextureCopy(config, src, dst);
+        });
+        std::printf("  input %5u+%-5u output %5u+%-5u bytes %8.2f GB/s\n", gap.input_width * 16,
+                    gap.input_gap * 16, gap.output_width * 16, gap.output_gap * 16, throughput);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 1) {
+        std::printf("Usage: %s\n"
+                    "Measures the throughput of software memory fills, display transfers and texture copies\n",
+                    argv[0]);
+        return std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0 ? 0 : -1;
+    }
+
+    Log::Filter log_filter(Log::Level::Warning);
+    Log::SetFilter(&log_filter);
+
+    // The images are at most 4 bytes per pixel, which fits in the buffers
+    static_assert(IMAGE_WIDTH * IMAGE_HEIGHT * 4 <= BUFFER_SIZE, "Buffers are too small for the images");
+    std::vector<u8> src(BUFFER_SIZE);
+    std::vector<u8> dst(BUFFER_SIZE);
+    for (size_t i = 0; i < src.size(); ++i)
+        src[i] = static_cast<u8>(i * 7);
+
+    HW::DisplayTransfer::Init();
+
+    BenchmarkMemoryFill(dst.data());
+    BenchmarkDisplayTransfer(src.data(), dst.data());
+    BenchmarkTextureCopy(src.data(), dst.data());
+
+    HW::DisplayTransfer::Shutdown();
+    return 0;
+}
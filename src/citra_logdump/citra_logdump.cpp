@@ -0,0 +1,156 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/file_util.h"
+#include "common/logging/backend.h"
+#include "common/logging/binary_log.h"
+#include "common/logging/log.h"
+#include "common/logging/text_formatter.h"
+
+using namespace Log::BinaryLog;
+
+/// Reads the strings referenced by the messages, as id -> text
+static std::unordered_map<u64, std::string> ReadStrings(const u8* strings, size_t size) {
+    std::unordered_map<u64, std::string> result;
+
+    size_t offset = 0;
+    while (offset + sizeof(StringRecord) <= size) {
+        StringRecord record;
+        std::memcpy(&record, strings + offset, sizeof(record));
+        if (record.id == 0 && record.length == 0)
+            break; // End of the table
+
+        const size_t text_offset = offset + sizeof(StringRecord);
+        if (text_offset + record.length > size)
+            break;
+
+        // The record may still have been written when the log was copied
+        if (record.id != 0)
+            result.emplace(record.id, std::string(reinterpret_cast<const char*>(strings + text_offset), record.length));
+
+        offset += (sizeof(StringRecord) + record.length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+
+    return result;
+}
+
+/// Copies data out of the ring, wrapping around its end
+static void ReadFromRing(const u8* ring, size_t ring_size, u64 position, void* data, size_t size) {
+    const size_t offset = position % ring_size;
+    const size_t first = std::min(size, ring_size - offset);
+    std::memcpy(data, ring + offset, first);
+    std::memcpy(static_cast<u8*>(data) + first, ring, size - first);
+}
+
+/// Finds the records still intact in the ring, sorted from oldest to newest
+static std::vector<MessageRecord> FindRecords(const u8* ring, size_t ring_size) {
+    std::vector<MessageRecord> records;
+    for (size_t offset = 0; offset < ring_size; offset += RECORD_ALIGNMENT) {
+        MessageRecord record;
+        ReadFromRing(ring, ring_size, offset, &record, sizeof(record));
+        if (record.magic != RECORD_MAGIC || record.position % ring_size != offset ||
+            record.size < sizeof(MessageRecord) || record.size > ring_size ||
+            record.size % RECORD_ALIGNMENT != 0) {
+            continue;
+        }
+        records.push_back(record);
+    }
+
+    std::sort(records.begin(), records.end(), [](const MessageRecord& a, const MessageRecord& b) {
+        return a.position < b.position;
+    });
+
+    // Only the last lap of the ring is valid, older records have been partially overwritten
+    u64 end = 0;
+    for (const MessageRecord& record : records)
+        end = std::max(end, record.position + record.size);
+
+    std::vector<MessageRecord> valid;
+    u64 next_position = 0;
+    for (const MessageRecord& record : records) {
+        if (record.position + ring_size < end || record.position < next_position)
+            continue;
+        valid.push_back(record);
+        next_position = record.position + record.size;
+    }
+    return valid;
+}
+
+static const std::string& LookupString(const std::unordered_map<u64, std::string>& strings, u64 id) {
+    static const std::string unknown = "<unknown>";
+    auto it = strings.find(id);
+    return it != strings.end() ? it->second : unknown;
+}
+
+static void PrintHelp(const char* argv0) {
+    std::printf("Usage: %s <binary log>\n"
+                "Prints the messages recorded in a binary log file (emu.binlog)\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0) {
+        PrintHelp(argv[0]);
+        return argc == 2 ? 0 : -1;
+    }
+
+    FileUtil::IOFile file(argv[1], "rb");
+    if (!file.IsOpen()) {
+        std::fprintf(stderr, "Failed to open %s\n", argv[1]);
+        return -1;
+    }
+
+    std::vector<u8> data(file.GetSize());
+    if (data.size() < sizeof(FileHeader) || file.ReadBytes(data.data(), data.size()) != data.size()) {
+        std::fprintf(stderr, "Failed to read %s\n", argv[1]);
+        return -1;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+        header.strings_offset + header.strings_size > data.size() ||
+        header.ring_offset + header.ring_size > data.size() || header.ring_size == 0) {
+        std::fprintf(stderr, "%s isn't a binary log, or was written by another version of Citra\n", argv[1]);
+        return -1;
+    }
+
+    const auto strings = ReadStrings(data.data() + header.strings_offset, header.strings_size);
+    const u8* ring = data.data() + header.ring_offset;
+    const size_t ring_size = header.ring_size;
+
+    std::vector<u8> arguments;
+    std::array<char, 4 * 1024> format_buffer;
+    for (const MessageRecord& record : FindRecords(ring, ring_size)) {
+        arguments.resize(record.size - sizeof(MessageRecord));
+        ReadFromRing(ring, ring_size, record.position + sizeof(MessageRecord), arguments.data(), arguments.size());
+
+        if (record.log_class >= static_cast<u8>(Log::Class::Count) ||
+            record.log_level >= static_cast<u8>(Log::Level::Count)) {
+            continue;
+        }
+
+        Log::Entry entry;
+        entry.timestamp = std::chrono::microseconds(record.timestamp);
+        entry.log_class = static_cast<Log::Class>(record.log_class);
+        entry.log_level = static_cast<Log::Level>(record.log_level);
+        entry.location = LookupString(strings, record.filename) + ':' +
+                         LookupString(strings, record.function) + ':' + std::to_string(record.line_nr);
+        entry.message = DecodeMessage(LookupString(strings, record.format), arguments.data(), arguments.size());
+
+        FormatLogMessage(entry, format_buffer.data(), format_buffer.size());
+        std::puts(format_buffer.data());
+    }
+
+    return 0;
+}
@@ -42,14 +42,22 @@ void Config::ReadValues() {
 
     qt_config->beginGroup("Core");
     Settings::values.use_cpu_jit = qt_config->value("use_cpu_jit", true).toBool();
+    Settings::values.use_interpreter_block_cache = qt_config->value("use_interpreter_block_cache", false).toBool();
+    Settings::values.use_fastmem = qt_config->value("use_fastmem", false).toBool();
     Settings::values.frame_skip = qt_config->value("frame_skip", 0).toInt();
     qt_config->endGroup();
 
     qt_config->beginGroup("Renderer");
     Settings::values.use_hw_renderer = qt_config->value("use_hw_renderer", true).toBool();
     Settings::values.use_shader_jit = qt_config->value("use_shader_jit", true).toBool();
+    Settings::values.use_shader_jit_disk_cache = qt_config->value("use_shader_jit_disk_cache", true).toBool();
+    Settings::values.use_shader_jit_async = qt_config->value("use_shader_jit_async", true).toBool();
+    Settings::values.use_shader_jit_batch = qt_config->value("use_shader_jit_batch", true).toBool();
     Settings::values.use_scaled_resolution = qt_config->value("use_scaled_resolution", false).toBool();
     Settings::values.use_vsync = qt_config->value("use_vsync", false).toBool();
+    Settings::values.sw_rasterizer_threads = qt_config->value("sw_rasterizer_threads", 0).toInt();
+    Settings::values.vertex_shader_threads = qt_config->value("vertex_shader_threads", 0).toInt();
+    Settings::values.surface_cache_size = qt_config->value("surface_cache_size", 256).toInt();
 
     Settings::values.bg_red   = qt_config->value("bg_red",   1.0).toFloat();
     Settings::values.bg_green = qt_config->value("bg_green", 1.0).toFloat();
@@ -72,11 +80,13 @@ void Config::ReadValues() {
 
     qt_config->beginGroup("Miscellaneous");
     Settings::values.log_filter = qt_config->value("log_filter", "*:Info").toString().toStdString();
+    Settings::values.use_binary_log = qt_config->value("use_binary_log", false).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("Debugging");
     Settings::values.use_gdbstub = qt_config->value("use_gdbstub", false).toBool();
     Settings::values.gdbstub_port = qt_config->value("gdbstub_port", 24689).toInt();
+    Settings::values.use_guest_profiler = qt_config->value("use_guest_profiler", false).toBool();
     qt_config->endGroup();
 
     qt_config->beginGroup("UI");
@@ -136,14 +146,22 @@ void Config::SaveValues() {
 
     qt_config->beginGroup("Core");
     qt_config->setValue("use_cpu_jit", Settings::values.use_cpu_jit);
+    qt_config->setValue("use_interpreter_block_cache", Settings::values.use_interpreter_block_cache);
+    qt_config->setValue("use_fastmem", Settings::values.use_fastmem);
     qt_config->setValue("frame_skip", Settings::values.frame_skip);
     qt_config->endGroup();
 
     qt_config->beginGroup("Renderer");
     qt_config->setValue("use_hw_renderer", Settings::values.use_hw_renderer);
     qt_config->setValue("use_shader_jit", Settings::values.use_shader_jit);
+    qt_config->setValue("use_shader_jit_disk_cache", Settings::values.use_shader_jit_disk_cache);
+    qt_config->setValue("use_shader_jit_async", Settings::values.use_shader_jit_async);
+    qt_config->setValue("use_shader_jit_batch", Settings::values.use_shader_jit_batch);
     qt_config->setValue("use_scaled_resolution", Settings::values.use_scaled_resolution);
     qt_config->setValue("use_vsync", Settings::values.use_vsync);
+    qt_config->setValue("sw_rasterizer_threads", Settings::values.sw_rasterizer_threads);
+    qt_config->setValue("vertex_shader_threads", Settings::values.vertex_shader_threads);
+    qt_config->setValue("surface_cache_size", Settings::values.surface_cache_size);
 
     // Cast to double because Qt's written float values are not human-readable
     qt_config->setValue("bg_red",   (double)Settings::values.bg_red);
@@ -167,11 +185,13 @@ void Config::SaveValues() {
 
     qt_config->beginGroup("Miscellaneous");
     qt_config->setValue("log_filter", QString::fromStdString(Settings::values.log_filter));
+    qt_config->setValue("use_binary_log", Settings::values.use_binary_log);
     qt_config->endGroup();
 
     qt_config->beginGroup("Debugging");
     qt_config->setValue("use_gdbstub", Settings::values.use_gdbstub);
     qt_config->setValue("gdbstub_port", Settings::values.gdbstub_port);
+    qt_config->setValue("use_guest_profiler", Settings::values.use_guest_profiler);
     qt_config->endGroup();
 
     qt_config->beginGroup("UI");
@@ -2,9 +2,18 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
+#include <QBoxLayout>
+#include <QFileDialog>
+#include <QLabel>
+#include <QMessageBox>
 #include <QMouseEvent>
 #include <QPainter>
+#include <QPushButton>
+#include <QStandardItemModel>
 #include <QString>
+#include <QTreeView>
 
 #include "citra_qt/debugger/profiler.h"
 #include "citra_qt/util/util.h"
@@ -13,6 +22,8 @@
 #include "common/microprofile.h"
 #include "common/profiler_reporting.h"
 
+#include "core/guest_profiler.h"
+
 // Include the implementation of the UI in this file. This isn't in microprofile.cpp because the
 // non-Qt frontends don't need it (and don't implement the UI drawing hooks either).
 #if MICROPROFILE_ENABLED
@@ -128,6 +139,125 @@ void ProfilerWidget::setProfilingInfoUpdateEnabled(bool enable)
     }
 }
 
+GuestProfilerWidget::GuestProfilerWidget(QWidget* parent) : QDockWidget(tr("Guest Profiler"), parent)
+{
+    setObjectName("GuestProfiler");
+
+    sampling_button = new QPushButton(tr("Start Sampling"));
+    sampling_button->setCheckable(true);
+    sampling_button->setEnabled(false);
+    QPushButton* clear_button = new QPushButton(tr("Clear"));
+    QPushButton* save_button = new QPushButton(QIcon::fromTheme("document-save"), tr("Save Flamegraph Stacks..."));
+    total_label = new QLabel;
+
+    model = new QStandardItemModel(this);
+    model->setColumnCount(4);
+    model->setHeaderData(0, Qt::Horizontal, tr("Function"));
+    model->setHeaderData(1, Qt::Horizontal, tr("Address"));
+    model->setHeaderData(2, Qt::Horizontal, tr("Samples"));
+    model->setHeaderData(3, Qt::Horizontal, tr("%"));
+
+    QTreeView* tree_view = new QTreeView;
+    tree_view->setModel(model);
+    tree_view->setRootIsDecorated(false);
+    tree_view->setUniformRowHeights(true);
+
+    auto main_widget = new QWidget;
+    auto main_layout = new QVBoxLayout;
+    {
+        auto sub_layout = new QHBoxLayout;
+        sub_layout->addWidget(sampling_button);
+        sub_layout->addWidget(clear_button);
+        sub_layout->addWidget(save_button);
+        sub_layout->addStretch();
+        sub_layout->addWidget(total_label);
+        main_layout->addLayout(sub_layout);
+    }
+    main_layout->addWidget(tree_view);
+    main_widget->setLayout(main_layout);
+    setWidget(main_widget);
+
+    connect(sampling_button, SIGNAL(toggled(bool)), SLOT(setSamplingEnabled(bool)));
+    connect(clear_button, SIGNAL(clicked()), SLOT(clearSamples()));
+    connect(save_button, SIGNAL(clicked()), SLOT(saveCollapsedStacks()));
+    connect(this, SIGNAL(visibilityChanged(bool)), SLOT(setUpdateEnabled(bool)));
+    connect(&update_timer, SIGNAL(timeout()), SLOT(updateHotFunctions()));
+}
+
+void GuestProfilerWidget::OnEmulationStarting(EmuThread* emu_thread)
+{
+    // The profiler may have been started from the settings
+    sampling_button->setChecked(GuestProfiler::IsRunning());
+    sampling_button->setEnabled(true);
+}
+
+void GuestProfilerWidget::OnEmulationStopping()
+{
+    // The samples stay available until the next emulation starts
+    sampling_button->setChecked(false);
+    sampling_button->setEnabled(false);
+    updateHotFunctions();
+}
+
+void GuestProfilerWidget::setUpdateEnabled(bool enable)
+{
+    if (enable) {
+        update_timer.start(1000);
+        updateHotFunctions();
+    } else {
+        update_timer.stop();
+    }
+}
+
+void GuestProfilerWidget::setSamplingEnabled(bool enable)
+{
+    if (enable)
+        GuestProfiler::Start();
+    else
+        GuestProfiler::Stop();
+
+    sampling_button->setText(enable ? tr("Stop Sampling") : tr("Start Sampling"));
+}
+
+void GuestProfilerWidget::clearSamples()
+{
+    GuestProfiler::Clear();
+    updateHotFunctions();
+}
+
+void GuestProfilerWidget::saveCollapsedStacks()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Flamegraph Stacks"), "",
+                                                    tr("Collapsed stacks (*.folded);;All files (*)"));
+    if (filename.isEmpty())
+        return;
+
+    if (!GuestProfiler::WriteCollapsedStacks(filename.toStdString()))
+        QMessageBox::critical(this, tr("Guest Profiler"), tr("Failed to write %1").arg(filename));
+}
+
+void GuestProfilerWidget::updateHotFunctions()
+{
+    const u64 total = GuestProfiler::GetTotalSamples();
+    total_label->setText(tr("%1 samples").arg(total));
+
+    model->removeRows(0, model->rowCount());
+    if (total == 0)
+        return;
+
+    // Only the hottest functions are interesting, and filling the model with all of them is slow
+    const size_t max_rows = 200;
+    const auto functions = GuestProfiler::GetHotFunctions();
+    for (size_t i = 0; i < std::min(functions.size(), max_rows); ++i) {
+        const GuestProfiler::Function& function = functions[i];
+        const int row = static_cast<int>(i);
+        model->setItem(row, 0, new QStandardItem(QString::fromStdString(function.name)));
+        model->setItem(row, 1, new QStandardItem(QString("0x%1").arg(function.address, 8, 16, QLatin1Char('0'))));
+        model->setItem(row, 2, new QStandardItem(QString::number(function.samples)));
+        model->setItem(row, 3, new QStandardItem(QString::number(100.0 * function.samples / total, 'f', 2)));
+    }
+}
+
 #if MICROPROFILE_ENABLED
 
 class MicroProfileWidget : public QWidget {
@@ -13,6 +13,11 @@
 #include "common/microprofile.h"
 #include "common/profiler_reporting.h"
 
+class EmuThread;
+class QLabel;
+class QPushButton;
+class QStandardItemModel;
+
 class ProfilerModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -68,3 +73,29 @@ protected:
 private:
     QAction* toggle_view_action = nullptr;
 };
+
+/// Shows the guest functions where the sampling profiler found the emulated CPU spending its time
+class GuestProfilerWidget : public QDockWidget {
+    Q_OBJECT
+
+public:
+    GuestProfilerWidget(QWidget* parent = nullptr);
+
+public slots:
+    void OnEmulationStarting(EmuThread* emu_thread);
+    void OnEmulationStopping();
+
+private slots:
+    void setUpdateEnabled(bool enable);
+    void setSamplingEnabled(bool enable);
+    void clearSamples();
+    void saveCollapsedStacks();
+    void updateHotFunctions();
+
+private:
+    QStandardItemModel* model;
+    QPushButton* sampling_button;
+    QLabel* total_label;
+
+    QTimer update_timer;
+};
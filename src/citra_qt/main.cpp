@@ -38,12 +38,15 @@
 #include "citra_qt/debugger/registers.h"
 #include "citra_qt/debugger/wait_tree.h"
 
+#include "common/common_paths.h"
+#include "common/file_util.h"
 //#include "common/microprofile.h"
 #include "common/platform.h"
 #include "common/scm_rev.h"
 #include "common/scope_exit.h"
 #include "common/string_util.h"
 #include "common/logging/backend.h"
+#include "common/logging/binary_log.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
@@ -83,6 +86,10 @@ GMainWindow::GMainWindow() : config(new Config()), emu_thread(nullptr)
     microProfileDialog->hide();
 #endif
 
+    guestProfilerWidget = new GuestProfilerWidget(this);
+    addDockWidget(Qt::BottomDockWidgetArea, guestProfilerWidget);
+    guestProfilerWidget->hide();
+
     disasmWidget = new DisassemblerWidget(this, emu_thread.get());
     addDockWidget(Qt::BottomDockWidgetArea, disasmWidget);
     disasmWidget->hide();
@@ -129,6 +136,7 @@ GMainWindow::GMainWindow() : config(new Config()), emu_thread(nullptr)
 #if MICROPROFILE_ENABLED
     debug_menu->addAction(microProfileDialog->toggleViewAction());
 #endif
+    debug_menu->addAction(guestProfilerWidget->toggleViewAction());
     debug_menu->addAction(disasmWidget->toggleViewAction());
     debug_menu->addAction(registersWidget->toggleViewAction());
     debug_menu->addAction(callstackWidget->toggleViewAction());
@@ -200,6 +208,8 @@ GMainWindow::GMainWindow() : config(new Config()), emu_thread(nullptr)
     connect(this, SIGNAL(EmulationStopping()), graphicsTracingWidget, SLOT(OnEmulationStopping()));
     connect(this, SIGNAL(EmulationStarting(EmuThread*)), waitTreeWidget, SLOT(OnEmulationStarting(EmuThread*)));
     connect(this, SIGNAL(EmulationStopping()), waitTreeWidget, SLOT(OnEmulationStopping()));
+    connect(this, SIGNAL(EmulationStarting(EmuThread*)), guestProfilerWidget, SLOT(OnEmulationStarting(EmuThread*)));
+    connect(this, SIGNAL(EmulationStopping()), guestProfilerWidget, SLOT(OnEmulationStopping()));
 
     // Setup hotkeys
     RegisterHotkey("Main Window", "Load File", QKeySequence::Open);
@@ -597,6 +607,10 @@ int main(int argc, char* argv[]) {
     Log::Filter log_filter(Log::Level::Info);
     Log::SetFilter(&log_filter);
 
+    const std::string log_dir = FileUtil::GetUserPath(D_LOGS_IDX);
+    FileUtil::CreateFullPath(log_dir);
+    Log::AddSink(std::make_unique<Log::FileSink>(log_dir + MAIN_LOG));
+
     MicroProfileOnThreadCreate("Frontend");
     SCOPE_EXIT({
         MicroProfileShutdown();
@@ -616,6 +630,9 @@ int main(int argc, char* argv[]) {
     GMainWindow main_window;
     // After settings have been loaded by GMainWindow, apply the filter
     log_filter.ParseFilterString(Settings::values.log_filter);
+    if (Settings::values.use_binary_log && !Log::BinaryLog::Enable(log_dir + BINARY_LOG)) {
+        LOG_ERROR(Frontend, "Failed to create the binary log in %s", log_dir.c_str());
+    }
 
     main_window.show();
     return app.exec();
@@ -17,6 +17,7 @@ class GRenderWindow;
 class EmuThread;
 class ProfilerWidget;
 class MicroProfileDialog;
+class GuestProfilerWidget;
 class DisassemblerWidget;
 class RegistersWidget;
 class CallstackWidget;
@@ -126,6 +127,7 @@ private:
 
     ProfilerWidget* profilerWidget;
     MicroProfileDialog* microProfileDialog;
+    GuestProfilerWidget* guestProfilerWidget;
     DisassemblerWidget* disasmWidget;
     RegistersWidget* registersWidget;
     CallstackWidget* callstackWidget;
@@ -60,6 +60,8 @@
 
 // Files in the directory returned by GetUserPath(D_LOGS_IDX)
 #define MAIN_LOG "emu.log"
+#define BINARY_LOG "emu.binlog"
+#define GUEST_PROFILE "guest_profile.folded"
 
 // Files in the directory returned by GetUserPath(D_SYSCONF_IDX)
 #define SYSCONF "SYSCONF"
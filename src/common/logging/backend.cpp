@@ -4,14 +4,25 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "common/assert.h"
 #include "common/common_funcs.h" // snprintf compatibility define
 #include "common/logging/backend.h"
+#include "common/logging/binary_log.h"
 #include "common/logging/filter.h"
 #include "common/logging/log.h"
 #include "common/logging/text_formatter.h"
+#include "common/mpsc_queue.h"
 
 namespace Log {
 
@@ -98,18 +109,21 @@ const char* GetLevelName(Level log_level) {
 #undef LVL
 }
 
-Entry CreateEntry(Class log_class, Level log_level,
-                        const char* filename, unsigned int line_nr, const char* function,
-                        const char* format, va_list args) {
+static std::chrono::microseconds GetTimestamp() {
     using std::chrono::steady_clock;
     using std::chrono::duration_cast;
 
     static steady_clock::time_point time_origin = steady_clock::now();
+    return duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+}
 
+Entry CreateEntry(Class log_class, Level log_level,
+                        const char* filename, unsigned int line_nr, const char* function,
+                        const char* format, va_list args) {
     std::array<char, 4 * 1024> formatting_buffer;
 
     Entry entry;
-    entry.timestamp = duration_cast<std::chrono::microseconds>(steady_clock::now() - time_origin);
+    entry.timestamp = GetTimestamp();
     entry.log_class = log_class;
     entry.log_level = log_level;
 
@@ -128,19 +142,288 @@ void SetFilter(Filter* new_filter) {
     filter = new_filter;
 }
 
+void ColorConsoleSink::Write(const Entry& entry) {
+    PrintColoredMessage(entry);
+}
+
+void ColorConsoleSink::Flush() {
+    fflush(stderr);
+}
+
+FileSink::FileSink(const std::string& filename) : file(filename, "w") {}
+
+void FileSink::Write(const Entry& entry) {
+    if (!file.IsOpen())
+        return;
+
+    std::array<char, 4 * 1024> format_buffer;
+    // Leave room for the line break
+    FormatLogMessage(entry, format_buffer.data(), format_buffer.size() - 1);
+    const size_t length = strlen(format_buffer.data());
+    format_buffer[length] = '\n';
+    file.WriteBytes(format_buffer.data(), length + 1);
+}
+
+void FileSink::Flush() {
+    file.Flush();
+}
+
+namespace {
+
+/// Messages longer than this are stored out of line, up to the 4 KiB limit of CreateEntry
+constexpr size_t INLINE_MESSAGE_SIZE = 1024;
+constexpr size_t MAX_MESSAGE_SIZE = 4 * 1024;
+
+/**
+ * A log message formatted by the logging thread. Short messages are stored without any heap
+ * allocation, longer ones in long_message.
+ */
+struct QueuedEntry {
+    std::chrono::microseconds timestamp;
+    Class log_class;
+    Level log_level;
+    const char* filename; ///< Always a string literal, see LOG_GENERIC
+    const char* function;
+    unsigned int line_nr;
+    std::array<char, INLINE_MESSAGE_SIZE> message;
+    std::string long_message;
+
+    const char* GetMessage() const {
+        return long_message.empty() ? message.data() : long_message.c_str();
+    }
+};
+
+/**
+ * Moves log messages from the logging threads to the sinks. Messages are pushed into a lock-free
+ * queue and written by a dedicated thread, which wakes up periodically or when the queue starts
+ * filling up. When the queue is full, messages are dropped and reported later instead of blocking
+ * the logging thread.
+ *
+ * The backend is never destroyed, so that static destructors can still log. Stop() is called
+ * during static destruction instead: it joins the writer thread, after which messages are written
+ * synchronously.
+ */
+class Backend {
+public:
+    Backend() {
+        sinks.emplace_back(std::make_unique<ColorConsoleSink>());
+        writer_thread = std::thread([this] { WriterLoop(); });
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            stop_requested = true;
+        }
+        writer_cv.notify_one();
+        writer_thread.join();
+
+        // Catch messages pushed while the writer was finishing
+        WriteQueuedEntries();
+    }
+
+    void Push(QueuedEntry& entry) {
+        if (stop_requested) {
+            std::lock_guard<std::mutex> lock(sinks_mutex);
+            WriteToSinks(ToEntry(entry));
+            for (auto& sink : sinks) {
+                sink->Flush();
+            }
+            return;
+        }
+
+        const size_t queued = ++num_queued;
+        if (!queue.TryPush(std::move(entry))) {
+            --num_queued;
+            ++num_dropped;
+            return;
+        }
+
+        // Wake the writer early rather than dropping messages during bursts
+        if (queued == QUEUE_SIZE / 2) {
+            writer_cv.notify_one();
+        }
+    }
+
+    void AddSink(std::unique_ptr<Sink> sink) {
+        std::lock_guard<std::mutex> lock(sinks_mutex);
+        sinks.emplace_back(std::move(sink));
+    }
+
+    void Flush() {
+        std::unique_lock<std::mutex> lock(writer_mutex);
+        // Once stopped, Push writes synchronously and nothing would complete the request
+        if (stop_requested)
+            return;
+        const u64 request = ++flush_requested;
+        writer_cv.notify_one();
+        flushed_cv.wait(lock, [this, request] { return flush_completed >= request; });
+    }
+
+private:
+    static constexpr size_t QUEUE_SIZE = 1024;
+
+    void WriterLoop() {
+        for (;;) {
+            bool stop;
+            u64 request;
+            {
+                std::unique_lock<std::mutex> lock(writer_mutex);
+                writer_cv.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                    return stop_requested || flush_requested != flush_completed ||
+                           num_queued >= QUEUE_SIZE / 2;
+                });
+                stop = stop_requested;
+                request = flush_requested;
+            }
+
+            WriteQueuedEntries();
+
+            {
+                std::lock_guard<std::mutex> lock(writer_mutex);
+                flush_completed = request;
+            }
+            flushed_cv.notify_all();
+
+            if (stop)
+                return;
+        }
+    }
+
+    void WriteQueuedEntries() {
+        std::lock_guard<std::mutex> lock(sinks_mutex);
+
+        bool written = false;
+        QueuedEntry queued;
+        while (queue.TryPop(queued)) {
+            --num_queued;
+            WriteToSinks(ToEntry(queued));
+            written = true;
+        }
+
+        const u32 dropped = num_dropped.exchange(0);
+        if (dropped != 0) {
+            Entry entry;
+            entry.timestamp = GetTimestamp();
+            entry.log_class = Class::Log;
+            entry.log_level = Level::Warning;
+            entry.location = "";
+            entry.message = std::to_string(dropped) + " messages dropped, the log queue was full";
+            WriteToSinks(entry);
+            written = true;
+        }
+
+        if (written) {
+            for (auto& sink : sinks) {
+                sink->Flush();
+            }
+        }
+    }
+
+    static Entry ToEntry(const QueuedEntry& queued) {
+        Entry entry;
+        entry.timestamp = queued.timestamp;
+        entry.log_class = queued.log_class;
+        entry.log_level = queued.log_level;
+
+        std::array<char, 512> location;
+        snprintf(location.data(), location.size(), "%s:%s:%u", queued.filename, queued.function, queued.line_nr);
+        entry.location = location.data();
+        entry.message = queued.GetMessage();
+        return entry;
+    }
+
+    void WriteToSinks(const Entry& entry) {
+        for (auto& sink : sinks) {
+            sink->Write(entry);
+        }
+    }
+
+    Common::BoundedMPSCQueue<QueuedEntry, QUEUE_SIZE> queue;
+    std::atomic<size_t> num_queued{0};
+    std::atomic<u32> num_dropped{0};
+
+    std::mutex sinks_mutex;
+    std::vector<std::unique_ptr<Sink>> sinks;
+
+    std::thread writer_thread;
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    std::condition_variable flushed_cv;
+    std::atomic<bool> stop_requested{false};
+    u64 flush_requested = 0;
+    u64 flush_completed = 0;
+};
+
+Backend& GetBackend() {
+    // Constructed in static storage and never destroyed, see Backend. The queue is cache line
+    // aligned, which plain new does not guarantee before C++17.
+    static std::aligned_storage<sizeof(Backend), alignof(Backend)>::type storage;
+    static Backend* backend = new (&storage) Backend;
+    static struct BackendStopper {
+        ~BackendStopper() {
+            backend->Stop();
+        }
+    } stopper;
+    return *backend;
+}
+
+} // namespace
+
+void AddSink(std::unique_ptr<Sink> sink) {
+    GetBackend().AddSink(std::move(sink));
+}
+
+void Flush() {
+    GetBackend().Flush();
+}
+
 void LogMessage(Class log_class, Level log_level,
                 const char* filename, unsigned int line_nr, const char* function,
                 const char* format, ...) {
     if (filter != nullptr && !filter->CheckMessage(log_class, log_level))
         return;
 
+    if (BinaryLog::IsEnabled()) {
+        va_list args;
+        va_start(args, format);
+        BinaryLog::Write(log_class, log_level, filename, line_nr, function, format, args);
+        va_end(args);
+
+        // Only warnings and errors still get formatted for the console and the text log
+        if (log_level < Level::Warning)
+            return;
+    }
+
+    QueuedEntry entry;
+    entry.timestamp = GetTimestamp();
+    entry.log_class = log_class;
+    entry.log_level = log_level;
+    entry.filename = filename;
+    entry.function = function;
+    entry.line_nr = line_nr;
+
     va_list args;
     va_start(args, format);
-    Entry entry = CreateEntry(log_class, log_level,
-            filename, line_nr, function, format, args);
+    va_list long_args;
+    va_copy(long_args, args);
+    const int length = vsnprintf(entry.message.data(), entry.message.size(), format, args);
+    if (length >= static_cast<int>(entry.message.size())) {
+        const size_t size = std::min(static_cast<size_t>(length) + 1, MAX_MESSAGE_SIZE);
+        entry.long_message.resize(size);
+        vsnprintf(&entry.long_message[0], size, format, long_args);
+        entry.long_message.resize(std::strlen(entry.long_message.c_str()));
+    }
+    va_end(long_args);
     va_end(args);
 
-    PrintColoredMessage(entry);
+    Backend& backend = GetBackend();
+    backend.Push(entry);
+
+    // Critical messages usually precede a crash, make sure they get out
+    if (log_level == Level::Critical) {
+        backend.Flush();
+    }
 }
 
 }
@@ -6,9 +6,12 @@
 
 #include <chrono>
 #include <cstdarg>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "common/file_util.h"
+
 #include "common/logging/log.h"
 
 namespace Log {
@@ -50,4 +53,45 @@ Entry CreateEntry(Class log_class, Level log_level,
 
 void SetFilter(Filter* filter);
 
+/// Destination of log entries. Sinks are only ever called from the logging thread.
+class Sink {
+public:
+    virtual ~Sink() = default;
+
+    /// Writes a log entry that passed the filter
+    virtual void Write(const Entry& entry) = 0;
+
+    /// Called after each batch of entries has been written
+    virtual void Flush() {}
+};
+
+/// Prints log entries to stderr, colored according to their severity level
+class ColorConsoleSink : public Sink {
+public:
+    void Write(const Entry& entry) override;
+    void Flush() override;
+};
+
+/// Appends log entries to a text file
+class FileSink : public Sink {
+public:
+    explicit FileSink(const std::string& filename);
+
+    void Write(const Entry& entry) override;
+    void Flush() override;
+
+private:
+    FileUtil::IOFile file;
+};
+
+/**
+ * Adds a sink receiving all log entries passing the filter, in addition to the console.
+ * Messages are formatted on the logging threads, but written to the sinks on a dedicated writer
+ * thread, so that logging doesn't stall the emulation.
+ */
+void AddSink(std::unique_ptr<Sink> sink);
+
+/// Blocks until all messages logged so far have been written to the sinks
+void Flush();
+
 }
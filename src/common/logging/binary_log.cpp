@@ -0,0 +1,603 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+
+#ifdef _WIN32
+#include <windows.h>
+#include "common/string_util.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "common/common_funcs.h" // snprintf compatibility define
+#include "common/logging/binary_log.h"
+
+namespace Log {
+namespace BinaryLog {
+
+/// Size of the string table, it only ever holds each distinct format string and location once
+constexpr size_t STRINGS_SIZE = 1024 * 1024;
+/// Maximum size of the encoded arguments of a message, the remaining ones are dropped
+constexpr size_t MAX_ARGUMENTS_SIZE = 1024;
+/// Maximum number of characters recorded for a string argument
+constexpr size_t MAX_STRING_ARGUMENT_LENGTH = 256;
+/// Number of entries of the set of strings already written to the string table
+constexpr size_t REGISTERED_STRINGS_SIZE = 8192;
+
+static size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+namespace {
+
+enum class Length { Default, Char, Short, Long, LongLong, IntMax, Size, PtrDiff, LongDouble };
+
+/// A printf conversion specification, as ranges of the format string
+struct Conversion {
+    const char* flags_begin;
+    const char* flags_end;
+    const char* width_begin; ///< "*" if the width is passed as an argument
+    const char* width_end;
+    bool has_precision;
+    const char* precision_begin; ///< "*" if the precision is passed as an argument
+    const char* precision_end;
+    Length length;
+    char specifier; ///< 0 if the specification is malformed
+};
+
+/**
+ * Parses the conversion specification following a '%'
+ * @return Pointer to the character following the specification
+ */
+const char* ParseConversion(const char* p, Conversion& conversion) {
+    conversion.flags_begin = p;
+    while (*p != '\0' && std::strchr("-+ #0", *p) != nullptr)
+        ++p;
+    conversion.flags_end = p;
+
+    conversion.width_begin = p;
+    if (*p == '*') {
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9')
+            ++p;
+    }
+    conversion.width_end = p;
+
+    conversion.has_precision = *p == '.';
+    if (conversion.has_precision)
+        ++p;
+    conversion.precision_begin = p;
+    if (*p == '*') {
+        ++p;
+    } else {
+        while (*p >= '0' && *p <= '9')
+            ++p;
+    }
+    conversion.precision_end = p;
+
+    conversion.length = Length::Default;
+    switch (*p) {
+    case 'h':
+        ++p;
+        conversion.length = Length::Short;
+        if (*p == 'h') {
+            ++p;
+            conversion.length = Length::Char;
+        }
+        break;
+    case 'l':
+        ++p;
+        conversion.length = Length::Long;
+        if (*p == 'l') {
+            ++p;
+            conversion.length = Length::LongLong;
+        }
+        break;
+    case 'j':
+        ++p;
+        conversion.length = Length::IntMax;
+        break;
+    case 'z':
+        ++p;
+        conversion.length = Length::Size;
+        break;
+    case 't':
+        ++p;
+        conversion.length = Length::PtrDiff;
+        break;
+    case 'L':
+        ++p;
+        conversion.length = Length::LongDouble;
+        break;
+    }
+
+    if (*p != '\0' && std::strchr("diouxXcfFeEgGaAspn%", *p) != nullptr) {
+        conversion.specifier = *p++;
+    } else {
+        conversion.specifier = 0;
+    }
+    return p;
+}
+
+bool IsStar(const char* begin, const char* end) {
+    return end - begin == 1 && *begin == '*';
+}
+
+class ArgumentWriter {
+public:
+    ArgumentWriter(u8* out, size_t size) : out(out), size(size) {}
+
+    void Put(const void* data, size_t length) {
+        if (full || position + length > size) {
+            full = true;
+            return;
+        }
+        std::memcpy(out + position, data, length);
+        position += length;
+    }
+
+    void PutInteger(u64 value) {
+        Put(&value, sizeof(value));
+    }
+
+    void PutDouble(double value) {
+        Put(&value, sizeof(value));
+    }
+
+    void PutString(const char* string, size_t max_length) {
+        if (string == nullptr)
+            string = "(null)";
+
+        size_t length = 0;
+        while (length < max_length && string[length] != '\0')
+            ++length;
+
+        const u32 length32 = static_cast<u32>(length);
+        Put(&length32, sizeof(length32));
+        Put(string, length);
+    }
+
+    size_t Size() const {
+        return position;
+    }
+
+private:
+    u8* out;
+    size_t size;
+    size_t position = 0;
+    bool full = false;
+};
+
+class ArgumentReader {
+public:
+    ArgumentReader(const u8* data, size_t size) : data(data), size(size) {}
+
+    template <typename T>
+    bool Get(T& value) {
+        if (position + sizeof(T) > size)
+            return false;
+        std::memcpy(&value, data + position, sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+
+    bool GetString(std::string& value) {
+        u32 length;
+        if (!Get(length) || position + length > size)
+            return false;
+        value.assign(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return true;
+    }
+
+private:
+    const u8* data;
+    size_t size;
+    size_t position = 0;
+};
+
+template <typename T>
+void AppendFormatted(std::string& out, const std::string& spec, T value) {
+    std::array<char, 256> buffer;
+    const int length = snprintf(buffer.data(), buffer.size(), spec.c_str(), value);
+    if (length < 0)
+        return;
+
+    if (static_cast<size_t>(length) < buffer.size()) {
+        out.append(buffer.data(), length);
+    } else {
+        std::string large(length + 1, '\0');
+        snprintf(&large[0], large.size(), spec.c_str(), value);
+        out.append(large.c_str(), length);
+    }
+}
+
+} // namespace
+
+size_t EncodeArguments(const char* format, va_list args, u8* out, size_t out_size) {
+    ArgumentWriter writer(out, out_size);
+
+    const char* p = format;
+    while ((p = std::strchr(p, '%')) != nullptr) {
+        Conversion conversion;
+        p = ParseConversion(p + 1, conversion);
+        if (conversion.specifier == 0 || conversion.specifier == '%')
+            continue;
+
+        if (IsStar(conversion.width_begin, conversion.width_end))
+            writer.PutInteger(static_cast<s64>(va_arg(args, int)));
+
+        size_t max_string_length = MAX_STRING_ARGUMENT_LENGTH;
+        if (conversion.has_precision) {
+            int precision = -1;
+            if (IsStar(conversion.precision_begin, conversion.precision_end)) {
+                precision = va_arg(args, int);
+                writer.PutInteger(static_cast<s64>(precision));
+            } else {
+                precision = std::atoi(conversion.precision_begin);
+            }
+            if (precision >= 0)
+                max_string_length = std::min<size_t>(max_string_length, precision);
+        }
+
+        switch (conversion.specifier) {
+        case 'd':
+        case 'i':
+            switch (conversion.length) {
+            case Length::Long:
+                writer.PutInteger(static_cast<s64>(va_arg(args, long)));
+                break;
+            case Length::LongLong:
+                writer.PutInteger(static_cast<s64>(va_arg(args, long long)));
+                break;
+            case Length::IntMax:
+                writer.PutInteger(static_cast<s64>(va_arg(args, intmax_t)));
+                break;
+            case Length::Size:
+            case Length::PtrDiff:
+                writer.PutInteger(static_cast<s64>(va_arg(args, ptrdiff_t)));
+                break;
+            case Length::Char:
+                writer.PutInteger(static_cast<s8>(va_arg(args, int)));
+                break;
+            case Length::Short:
+                writer.PutInteger(static_cast<s16>(va_arg(args, int)));
+                break;
+            default:
+                writer.PutInteger(static_cast<s64>(va_arg(args, int)));
+                break;
+            }
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (conversion.length) {
+            case Length::Long:
+                writer.PutInteger(static_cast<u64>(va_arg(args, unsigned long)));
+                break;
+            case Length::LongLong:
+                writer.PutInteger(static_cast<u64>(va_arg(args, unsigned long long)));
+                break;
+            case Length::IntMax:
+                writer.PutInteger(static_cast<u64>(va_arg(args, uintmax_t)));
+                break;
+            case Length::Size:
+            case Length::PtrDiff:
+                writer.PutInteger(static_cast<u64>(va_arg(args, size_t)));
+                break;
+            case Length::Char:
+                writer.PutInteger(static_cast<u8>(va_arg(args, unsigned int)));
+                break;
+            case Length::Short:
+                writer.PutInteger(static_cast<u16>(va_arg(args, unsigned int)));
+                break;
+            default:
+                writer.PutInteger(static_cast<u64>(va_arg(args, unsigned int)));
+                break;
+            }
+            break;
+        case 'c':
+            writer.PutInteger(static_cast<s64>(conversion.length == Length::Long ? va_arg(args, wint_t) : va_arg(args, int)));
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (conversion.length == Length::LongDouble) {
+                writer.PutDouble(static_cast<double>(va_arg(args, long double)));
+            } else {
+                writer.PutDouble(va_arg(args, double));
+            }
+            break;
+        case 's':
+            if (conversion.length == Length::Long) {
+                // Wide strings aren't used by the logging code, only record that there was one
+                va_arg(args, const wchar_t*);
+                writer.PutString("(wide string)", max_string_length);
+            } else {
+                writer.PutString(va_arg(args, const char*), max_string_length);
+            }
+            break;
+        case 'p':
+            writer.PutInteger(reinterpret_cast<uintptr_t>(va_arg(args, void*)));
+            break;
+        case 'n':
+            va_arg(args, void*);
+            break;
+        }
+    }
+
+    return writer.Size();
+}
+
+std::string DecodeMessage(const std::string& format, const u8* args, size_t args_size) {
+    ArgumentReader reader(args, args_size);
+    std::string result;
+
+    const char* p = format.c_str();
+    for (;;) {
+        const char* percent = std::strchr(p, '%');
+        if (percent == nullptr) {
+            result.append(p);
+            return result;
+        }
+        result.append(p, percent);
+
+        Conversion conversion;
+        p = ParseConversion(percent + 1, conversion);
+        if (conversion.specifier == 0) {
+            result.append(percent, p);
+            continue;
+        }
+        if (conversion.specifier == '%') {
+            result += '%';
+            continue;
+        }
+        if (conversion.specifier == 'n')
+            continue;
+
+        // Rebuild the specification with the arguments in the width in which they were recorded
+        std::string spec = "%";
+        spec.append(conversion.flags_begin, conversion.flags_end);
+
+        bool missing = false;
+        if (IsStar(conversion.width_begin, conversion.width_end)) {
+            s64 width = 0;
+            missing |= !reader.Get(width);
+            spec += std::to_string(width);
+        } else {
+            spec.append(conversion.width_begin, conversion.width_end);
+        }
+
+        if (conversion.has_precision) {
+            if (IsStar(conversion.precision_begin, conversion.precision_end)) {
+                s64 precision = 0;
+                missing |= !reader.Get(precision);
+                // A negative precision is taken as if it was omitted
+                if (precision >= 0)
+                    spec += '.' + std::to_string(precision);
+            } else {
+                spec += '.';
+                spec.append(conversion.precision_begin, conversion.precision_end);
+            }
+        }
+
+        switch (conversion.specifier) {
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X': {
+            u64 value = 0;
+            missing |= !reader.Get(value);
+            spec += "ll";
+            spec += conversion.specifier;
+            if (!missing)
+                AppendFormatted(result, spec, static_cast<unsigned long long>(value));
+            break;
+        }
+        case 'c': {
+            s64 value = 0;
+            missing |= !reader.Get(value);
+            spec += 'c';
+            if (!missing)
+                AppendFormatted(result, spec, static_cast<int>(value));
+            break;
+        }
+        case 's': {
+            std::string value;
+            missing |= !reader.GetString(value);
+            spec += 's';
+            if (!missing)
+                AppendFormatted(result, spec, value.c_str());
+            break;
+        }
+        case 'p': {
+            u64 value = 0;
+            missing |= !reader.Get(value);
+            spec.assign("0x%llx");
+            if (!missing)
+                AppendFormatted(result, spec, static_cast<unsigned long long>(value));
+            break;
+        }
+        default: {
+            double value = 0;
+            missing |= !reader.Get(value);
+            spec += conversion.specifier;
+            if (!missing)
+                AppendFormatted(result, spec, value);
+            break;
+        }
+        }
+
+        if (missing)
+            result += "<missing>";
+    }
+}
+
+static u8* file_base = nullptr;
+static FileHeader* header = nullptr;
+static u8* strings = nullptr;
+static u8* ring = nullptr;
+
+static std::atomic<bool> enabled{false};
+static std::atomic<u64> strings_used{0};
+static std::atomic<u64> ring_position{0};
+static std::array<std::atomic<uintptr_t>, REGISTERED_STRINGS_SIZE> registered_strings;
+static std::chrono::steady_clock::time_point time_origin;
+
+/// Creates a file of the given size, zero-filled, and maps it into memory
+static u8* MapFile(const std::string& filename, size_t size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(Common::UTF8ToUTF16W(filename).c_str(), GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(static_cast<u64>(size) >> 32),
+                                        static_cast<DWORD>(size), nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return nullptr;
+
+    // The view keeps the mapping alive
+    void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return static_cast<u8*>(base);
+#else
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return nullptr;
+
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    // The mapping stays valid after closing the file
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return base == MAP_FAILED ? nullptr : static_cast<u8*>(base);
+#endif
+}
+
+bool Enable(const std::string& filename, size_t ring_size) {
+    if (enabled)
+        return true;
+
+    ring_size = AlignUp(std::max<size_t>(ring_size, 64 * 1024), 4096);
+    const size_t strings_offset = AlignUp(sizeof(FileHeader), 4096);
+    const size_t ring_offset = strings_offset + STRINGS_SIZE;
+
+    file_base = MapFile(filename, ring_offset + ring_size);
+    if (file_base == nullptr)
+        return false;
+
+    header = reinterpret_cast<FileHeader*>(file_base);
+    header->magic = FILE_MAGIC;
+    header->version = FILE_VERSION;
+    header->strings_offset = strings_offset;
+    header->strings_size = STRINGS_SIZE;
+    header->ring_offset = ring_offset;
+    header->ring_size = ring_size;
+    strings = file_base + strings_offset;
+    ring = file_base + ring_offset;
+
+    time_origin = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+bool IsEnabled() {
+    return enabled.load(std::memory_order_acquire);
+}
+
+/// Appends a string to the string table
+static void AppendString(const char* string, uintptr_t id) {
+    const u32 length = static_cast<u32>(std::strlen(string));
+    const size_t size = AlignUp(sizeof(StringRecord) + length, RECORD_ALIGNMENT);
+    const u64 offset = strings_used.fetch_add(size, std::memory_order_relaxed);
+    if (offset + size > STRINGS_SIZE)
+        return;
+
+    u8* record = strings + offset;
+    std::memcpy(record + sizeof(StringRecord), string, length);
+    // citra-logdump stops at the first record without an id, so set it last
+    std::memcpy(record + offsetof(StringRecord, length), &length, sizeof(length));
+    const u64 id64 = id;
+    std::memcpy(record + offsetof(StringRecord, id), &id64, sizeof(id64));
+}
+
+/// Returns the id of a string literal, adding it to the string table on first use
+static u64 RegisterString(const char* string) {
+    const uintptr_t id = reinterpret_cast<uintptr_t>(string);
+    size_t index = static_cast<size_t>((static_cast<u64>(id) * 0x9E3779B97F4A7C15ULL) >> 40);
+
+    for (size_t probe = 0; probe < REGISTERED_STRINGS_SIZE; ++probe, ++index) {
+        auto& slot = registered_strings[index % REGISTERED_STRINGS_SIZE];
+        uintptr_t current = slot.load(std::memory_order_relaxed);
+        if (current == 0 && slot.compare_exchange_strong(current, id, std::memory_order_relaxed)) {
+            AppendString(string, id);
+            return id;
+        }
+        if (current == id)
+            return id;
+    }
+
+    // The set is full, the messages will be decoded without this string
+    return id;
+}
+
+/// Copies data to the ring, wrapping around its end
+static void CopyToRing(u64 position, const void* data, size_t size) {
+    const size_t ring_size = header->ring_size;
+    const size_t offset = position % ring_size;
+    const size_t first = std::min(size, ring_size - offset);
+    std::memcpy(ring + offset, data, first);
+    std::memcpy(ring, static_cast<const u8*>(data) + first, size - first);
+}
+
+void Write(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+           const char* function, const char* format, va_list args) {
+    std::array<u8, MAX_ARGUMENTS_SIZE> arguments;
+    const size_t arguments_size = EncodeArguments(format, args, arguments.data(), arguments.size());
+
+    MessageRecord record = {};
+    record.magic = RECORD_MAGIC;
+    record.size = static_cast<u32>(AlignUp(sizeof(MessageRecord) + arguments_size, RECORD_ALIGNMENT));
+    record.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - time_origin).count();
+    record.format = RegisterString(format);
+    record.filename = RegisterString(filename);
+    record.function = RegisterString(function);
+    record.line_nr = line_nr;
+    record.log_class = static_cast<u8>(log_class);
+    record.log_level = static_cast<u8>(log_level);
+
+    record.position = ring_position.fetch_add(record.size, std::memory_order_relaxed);
+    CopyToRing(record.position + sizeof(MessageRecord), arguments.data(), arguments_size);
+    CopyToRing(record.position, &record, sizeof(MessageRecord));
+}
+
+} // namespace BinaryLog
+} // namespace Log
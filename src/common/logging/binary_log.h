@@ -0,0 +1,90 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <string>
+
+#include "common/common_types.h"
+#include "common/logging/log.h"
+
+/**
+ * Binary log: instead of formatting messages, the logging thread only records the format string,
+ * source location and raw arguments into a ring buffer in a memory mapped file. The messages are
+ * formatted offline by citra-logdump, which makes it cheap enough to keep verbose logging enabled.
+ *
+ * File layout:
+ *  - FileHeader
+ *  - String table, holding the text of format strings, file and function names, as StringRecords
+ *    appended on first use
+ *  - Ring buffer of MessageRecords, each followed by the encoded arguments and padded to a
+ *    multiple of RECORD_ALIGNMENT. Records may wrap around the end of the ring.
+ */
+namespace Log {
+namespace BinaryLog {
+
+constexpr u32 FILE_MAGIC = 0x474C5443; // "CTLG"
+constexpr u32 FILE_VERSION = 1;
+constexpr u32 RECORD_MAGIC = 0x52474F4C; // "LOGR"
+constexpr size_t RECORD_ALIGNMENT = 8;
+
+struct FileHeader {
+    u32 magic;
+    u32 version;
+    u64 strings_offset;
+    u64 strings_size;
+    u64 ring_offset;
+    u64 ring_size;
+};
+
+/// Entry of the string table, followed by `length` characters
+struct StringRecord {
+    u64 id; ///< Address of the string in the logging process, never 0
+    u32 length;
+    u32 padding;
+};
+
+/// Entry of the ring buffer, followed by the arguments encoded by EncodeArguments
+struct MessageRecord {
+    u32 magic;
+    u32 size;      ///< Size of the whole record, including the arguments and padding
+    u64 position;  ///< Position of the record in the stream of all records ever written
+    u64 timestamp; ///< Microseconds since the logging started
+    u64 format;    ///< String ids
+    u64 filename;
+    u64 function;
+    u32 line_nr;
+    u8 log_class;
+    u8 log_level;
+    u16 padding;
+};
+
+/**
+ * Starts recording all log messages into a binary log file, replacing any existing file
+ * @param ring_size Size of the ring buffer holding the messages, older messages get overwritten
+ * @return False if the file couldn't be created
+ */
+bool Enable(const std::string& filename, size_t ring_size = 16 * 1024 * 1024);
+
+/// Returns whether messages are being recorded into a binary log file
+bool IsEnabled();
+
+/// Records a log message, to be called only if IsEnabled()
+void Write(Class log_class, Level log_level, const char* filename, unsigned int line_nr,
+           const char* function, const char* format, va_list args);
+
+/**
+ * Encodes the arguments referenced by a printf format string
+ * @return Number of bytes written to `out`, which may be shorter than needed if `out_size` is
+ *         too small
+ */
+size_t EncodeArguments(const char* format, va_list args, u8* out, size_t out_size);
+
+/// Formats a message from a format string and arguments encoded by EncodeArguments
+std::string DecodeMessage(const std::string& format, const u8* args, size_t args_size);
+
+} // namespace BinaryLog
+} // namespace Log
@@ -0,0 +1,93 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace Common {
+
+/**
+ * Bounded lock-free queue with any number of producers and a single consumer. Each slot carries a
+ * sequence number telling whether it is free for the producer of a given position or holds data
+ * for the consumer, so neither side ever blocks the other (see D. Vyukov's bounded MPMC queue).
+ * @tparam T Type of the elements, must be default constructible
+ * @tparam Capacity Maximum number of queued elements, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class BoundedMPSCQueue final {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    BoundedMPSCQueue() {
+        for (size_t i = 0; i < Capacity; ++i)
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedMPSCQueue(const BoundedMPSCQueue&) = delete;
+    BoundedMPSCQueue& operator=(const BoundedMPSCQueue&) = delete;
+
+    /**
+     * Appends an element to the queue, may be called from any thread
+     * @return False if the queue is full, in which case `value` is left untouched
+     */
+    template <typename U>
+    bool TryPush(U&& value) {
+        size_t position = enqueue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[position & (Capacity - 1)];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const ptrdiff_t difference = static_cast<ptrdiff_t>(sequence - position);
+
+            if (difference == 0) {
+                // The slot is free, try to claim it
+                if (enqueue_position.compare_exchange_weak(position, position + 1,
+                                                           std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                // The consumer hasn't freed the slot from the previous round yet
+                return false;
+            } else {
+                // Another producer claimed the slot first
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Removes the oldest element from the queue, must only be called from the consumer thread
+     * @return False if the queue is empty or the next element is still being written
+     */
+    bool TryPop(T& value) {
+        Slot& slot = slots[dequeue_position & (Capacity - 1)];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeue_position + 1)
+            return false;
+
+        value = std::move(slot.value);
+        slot.sequence.store(dequeue_position + Capacity, std::memory_order_release);
+        ++dequeue_position;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Producers and the consumer work on separate cache lines
+    alignas(64) std::array<Slot, Capacity> slots;
+    alignas(64) std::atomic<size_t> enqueue_position{0};
+    alignas(64) size_t dequeue_position = 0;
+};
+
+} // namespace Common
@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
+
 #include "common/symbols.h"
 
 TSymbolsMap g_symbols;
@@ -37,6 +39,21 @@ namespace Symbols
         return {};
     }
 
+    TSymbol GetSymbolContaining(u32 address)
+    {
+        auto iter = g_symbols.upper_bound(address);
+        if (iter == g_symbols.begin())
+            return {};
+
+        --iter;
+        const TSymbol& symbol = iter->second;
+        // Symbols without a size only cover their own address
+        if (address - symbol.address < std::max(symbol.size, 1u))
+            return symbol;
+
+        return {};
+    }
+
     const std::string GetName(u32 address)
     {
         return GetSymbol(address).name;
@@ -27,6 +27,8 @@ namespace Symbols
 
     void Add(u32 address, const std::string& name, u32 size, u32 type);
     TSymbol GetSymbol(u32 address);
+    /// Returns the symbol whose range contains the address, or an empty symbol if there is none
+    TSymbol GetSymbolContaining(u32 address);
     const std::string GetName(u32 address);
     void Remove(u32 address);
     void Clear();
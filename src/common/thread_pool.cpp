@@ -0,0 +1,77 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <utility>
+
+#include "common/assert.h"
+#include "common/thread.h"
+#include "common/thread_pool.h"
+
+namespace Common {
+
+ThreadPool::ThreadPool(size_t num_threads, const std::string& name) {
+    ASSERT(num_threads > 0);
+
+    workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, name + std::to_string(i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Push(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::WaitForIdle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && num_busy == 0; });
+}
+
+size_t ThreadPool::DefaultThreadCount() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::WorkerLoop(std::string thread_name) {
+    SetCurrentThreadName(thread_name.c_str());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+        // Drain any remaining tasks before honoring a stop request
+        if (tasks.empty())
+            return;
+
+        Task task = std::move(tasks.front());
+        tasks.pop_front();
+        ++num_busy;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        --num_busy;
+        if (tasks.empty() && num_busy == 0)
+            idle.notify_all();
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,69 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+/**
+ * Fixed-size pool of worker threads executing tasks in FIFO order. Intended for fork/join style
+ * workloads: the owner pushes a batch of independent tasks and then blocks in WaitForIdle() until
+ * all of them have completed.
+ */
+class ThreadPool final {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * Creates a thread pool
+     * @param num_threads Number of worker threads to spawn, must be at least one
+     * @param name Name given to the worker threads (suffixed by the worker index)
+     */
+    ThreadPool(size_t num_threads, const std::string& name);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Queues a task for execution on one of the worker threads
+    void Push(Task task);
+
+    /// Blocks until the task queue is empty and no worker is executing a task
+    void WaitForIdle();
+
+    /// Returns the number of worker threads in this pool
+    size_t NumThreads() const {
+        return workers.size();
+    }
+
+    /**
+     * Suggests a number of worker threads to use for CPU-bound work, based on the number of
+     * hardware threads available on the host.
+     */
+    static size_t DefaultThreadCount();
+
+private:
+    void WorkerLoop(std::string thread_name);
+
+    std::vector<std::thread> workers;
+    std::deque<Task> tasks;
+
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable idle;
+
+    size_t num_busy = 0;
+    bool stopping = false;
+};
+
+} // namespace Common
@@ -35,6 +35,14 @@ public:
     /// Clear all instruction cache
     virtual void ClearInstructionCache() = 0;
 
+    /**
+     * Discards the translated code of a range of guest memory, after the code there was modified
+     * or the permissions of the range changed
+     * @param start_address Address of the first modified byte
+     * @param length Size of the modified range in bytes
+     */
+    virtual void InvalidateCacheRange(u32 start_address, size_t length) = 0;
+
     /**
      * Set the Program Counter to an address
      * @param addr Address to set PC to
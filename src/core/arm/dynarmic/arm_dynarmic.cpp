@@ -2,6 +2,8 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <bitset>
+
 #include "common/assert.h"
 #include "common/microprofile.h"
 
@@ -11,6 +13,9 @@
 #include "core/arm/dyncom/arm_dyncom_interpreter.h"
 #include "core/core.h"
 #include "core/core_timing.h"
+#include "core/fastmem.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/vm_manager.h"
 #include "core/hle/svc.h"
 #include "core/memory.h"
 
@@ -35,9 +40,30 @@ static void InterpreterFallback(u32 pc, Dynarmic::Jit* jit, void* user_arg) {
     jit->SetFpscr(state->VFP[VFP_FPSCR]);
 }
 
+constexpr size_t NUM_PAGES = 1 << (32 - Memory::PAGE_BITS);
+
+/// Pages reported as read-only to the JIT since its cache was last cleared. Reads from them may
+/// have been folded into code located anywhere.
+static std::bitset<NUM_PAGES> read_only_pages;
+/// Pages that had their code invalidated, which are never reported as read-only again since they
+/// are likely to be modified again (e.g. by CRO relocations)
+static std::bitset<NUM_PAGES> invalidated_pages;
+
 static bool IsReadOnlyMemory(u32 vaddr) {
-    // TODO(bunnei): ImplementMe
-    return false;
+    const u32 page = vaddr >> Memory::PAGE_BITS;
+    if (invalidated_pages[page] || Kernel::g_current_process == nullptr)
+        return false;
+
+    // Only code and read-only data of the process can be relied on to never change
+    const auto& vm_manager = Kernel::g_current_process->vm_manager;
+    auto vma = vm_manager.FindVMA(vaddr);
+    if (vma == vm_manager.vma_map.end() || vma->second.meminfo_state != Kernel::MemoryState::Code ||
+        (static_cast<u8>(vma->second.permissions) & static_cast<u8>(Kernel::VMAPermission::Write)) != 0) {
+        return false;
+    }
+
+    read_only_pages[page] = true;
+    return true;
 }
 
 static Dynarmic::UserCallbacks GetUserCallbacks(ARMul_State* interpeter_state) {
@@ -54,6 +80,18 @@ static Dynarmic::UserCallbacks GetUserCallbacks(ARMul_State* interpeter_state) {
     user_callbacks.MemoryWrite16 = &Memory::Write16;
     user_callbacks.MemoryWrite32 = &Memory::Write32;
     user_callbacks.MemoryWrite64 = &Memory::Write64;
+
+    // Go through the fastmem arena if available, its accessors fall back to the ones above
+    if (const Memory::Fastmem::Accessors* fastmem = Memory::Fastmem::GetAccessors()) {
+        user_callbacks.MemoryRead8 = fastmem->Read8;
+        user_callbacks.MemoryRead16 = fastmem->Read16;
+        user_callbacks.MemoryRead32 = fastmem->Read32;
+        user_callbacks.MemoryRead64 = fastmem->Read64;
+        user_callbacks.MemoryWrite8 = fastmem->Write8;
+        user_callbacks.MemoryWrite16 = fastmem->Write16;
+        user_callbacks.MemoryWrite32 = fastmem->Write32;
+        user_callbacks.MemoryWrite64 = fastmem->Write64;
+    }
     return user_callbacks;
 }
 
@@ -62,6 +100,12 @@ ARM_Dynarmic::ARM_Dynarmic(PrivilegeMode initial_mode) {
     jit = std::make_unique<Dynarmic::Jit>(GetUserCallbacks(interpreter_state.get()));
 }
 
+ARM_Dynarmic::~ARM_Dynarmic() {
+    // The cores are destroyed when emulation shuts down, the next session may run other code
+    read_only_pages.reset();
+    invalidated_pages.reset();
+}
+
 void ARM_Dynarmic::SetPC(u32 pc) {
     jit->Regs()[15] = pc;
 }
@@ -123,9 +167,12 @@ void ARM_Dynarmic::AddTicks(u64 ticks) {
 MICROPROFILE_DEFINE(ARM_Jit, "ARM JIT", "ARM JIT", MP_RGB(255, 64, 64));
 
 void ARM_Dynarmic::ExecuteInstructions(int num_instructions) {
-    MICROPROFILE_SCOPE(ARM_Jit);
-
-    jit->Run(static_cast<unsigned>(num_instructions));
+    {
+        // CoreTiming events run by AddTicks aren't guest code, keep them out of the JIT timer as
+        // with the interpreter
+        MICROPROFILE_SCOPE(ARM_Jit);
+        jit->Run(static_cast<unsigned>(num_instructions));
+    }
 
     AddTicks(num_instructions);
 }
@@ -164,4 +211,27 @@ void ARM_Dynarmic::PrepareReschedule() {
 
 void ARM_Dynarmic::ClearInstructionCache() {
     jit->ClearCache();
+    read_only_pages.reset();
+}
+
+void ARM_Dynarmic::InvalidateCacheRange(u32 start_address, size_t length) {
+    if (length == 0)
+        return;
+
+    const u32 first_page = start_address >> Memory::PAGE_BITS;
+    const u32 last_page = static_cast<u32>((static_cast<u64>(start_address) + length - 1) >> Memory::PAGE_BITS);
+
+    bool folded = false;
+    for (u32 page = first_page; page <= last_page; ++page) {
+        folded |= read_only_pages[page];
+        invalidated_pages[page] = true;
+    }
+
+    // Reads from pages reported as read-only may have been compiled into blocks elsewhere, which
+    // can't be tracked down
+    if (folded) {
+        ClearInstructionCache();
+    } else {
+        jit->InvalidateCacheRange(start_address, length);
+    }
 }
@@ -20,6 +20,7 @@ struct ThreadContext;
 class ARM_Dynarmic final : public ARM_Interface {
 public:
     ARM_Dynarmic(PrivilegeMode initial_mode);
+    ~ARM_Dynarmic();
 
     void SetPC(u32 pc) override;
     u32 GetPC() const override;
@@ -43,6 +44,7 @@ public:
     void ExecuteInstructions(int num_instructions) override;
 
     void ClearInstructionCache() override;
+    void InvalidateCacheRange(u32 start_address, size_t length) override;
 
 private:
     std::unique_ptr<Dynarmic::Jit> jit;
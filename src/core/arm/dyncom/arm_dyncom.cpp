@@ -16,19 +16,54 @@
 
 #include "core/core.h"
 #include "core/core_timing.h"
+#include "core/memory.h"
 
 ARM_DynCom::ARM_DynCom(PrivilegeMode initial_mode) {
     state = std::make_unique<ARMul_State>(initial_mode);
 }
 
 ARM_DynCom::~ARM_DynCom() {
+    FlushBlockDiskCache();
 }
 
 void ARM_DynCom::ClearInstructionCache() {
+    FlushBlockDiskCache();
     state->instruction_cache.clear();
+    state->instruction_cache_pages.clear();
+    state->code_pages_seen.clear();
     trans_cache_buf_top = 0;
 }
 
+void ARM_DynCom::InvalidateCacheRange(u32 start_address, size_t length) {
+    // Discarded blocks keep using space in the translation cache until it is cleared entirely
+    if (trans_cache_buf_top > TRANS_CACHE_SIZE / 4 * 3) {
+        ClearInstructionCache();
+        return;
+    }
+
+    if (length == 0)
+        return;
+
+    // Blocks never cross a page boundary, so only the blocks starting in the pages of the range
+    // can contain modified code
+    const u32 start_page = start_address & ~Memory::PAGE_MASK;
+    const u64 end = static_cast<u64>(start_address) + length;
+
+    for (u64 page = start_page; page < end; page += Memory::PAGE_SIZE) {
+        auto blocks = state->instruction_cache_pages.find(static_cast<u32>(page));
+        if (blocks != state->instruction_cache_pages.end()) {
+            for (u32 pc : blocks->second) {
+                state->instruction_cache.erase(pc);
+            }
+            state->instruction_cache_pages.erase(blocks);
+        }
+        state->code_pages_seen.erase(static_cast<u32>(page));
+    }
+
+    // The links of the remaining blocks may lead to discarded ones
+    ++block_links_generation;
+}
+
 void ARM_DynCom::SetPC(u32 pc) {
     state->Reg[15] = pc;
 }
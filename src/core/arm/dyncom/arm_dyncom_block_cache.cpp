@@ -0,0 +1,119 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+
+#include "core/arm/dyncom/arm_dyncom_block_cache.h"
+
+static const u32 CACHE_MAGIC = 0x4B4C4244; // "DBLK"
+/// Needs to be incremented whenever the file format changes
+static const u32 CACHE_VERSION = 1;
+/// At most an ARM and a Thumb block per halfword of a page, used to reject corrupted files
+static const u32 MAX_ENTRY_POINTS = 2 * 2048;
+
+struct CacheFileHeader {
+    u32 magic;
+    u32 version;
+};
+
+struct CacheEntryHeader {
+    u64 page_hash;
+    u32 num_entry_points;
+    u32 reserved;
+};
+
+BlockDiskCache::BlockDiskCache() {
+    const std::string dir = FileUtil::GetUserPath(D_CACHE_IDX);
+    const std::string path = dir + "dyncom_blocks.bin";
+
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(Core_ARM11, "Failed to create cache directory %s", dir.c_str());
+        return;
+    }
+
+    if (!file.Open(path, FileUtil::Exists(path) ? "r+b" : "w+b")) {
+        LOG_ERROR(Core_ARM11, "Failed to open block cache %s", path.c_str());
+        return;
+    }
+
+    ReadEntries();
+    LOG_INFO(Core_ARM11, "Loaded blocks of %zu code pages from %s", pages.size(), path.c_str());
+}
+
+void BlockDiskCache::ReadEntries() {
+    const CacheFileHeader expected = {CACHE_MAGIC, CACHE_VERSION};
+
+    CacheFileHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        // Missing or outdated cache, start over
+        file.Clear();
+        file.Resize(0);
+        file.Seek(0, SEEK_SET);
+        file.WriteBytes(&expected, sizeof(expected));
+        file.Flush();
+        return;
+    }
+
+    u64 valid_size = file.Tell();
+    CacheEntryHeader entry;
+    while (file.ReadBytes(&entry, sizeof(entry)) == sizeof(entry) &&
+           entry.num_entry_points <= MAX_ENTRY_POINTS) {
+        std::vector<EntryPoint> entry_points(entry.num_entry_points);
+        if (file.ReadArray(entry_points.data(), entry_points.size()) != entry_points.size())
+            break;
+
+        // A page may have several entries, each adding the blocks found by one session
+        auto& known = pages[entry.page_hash];
+        known.insert(known.end(), entry_points.begin(), entry_points.end());
+        valid_size = file.Tell();
+    }
+
+    for (auto& page : pages) {
+        std::sort(page.second.begin(), page.second.end());
+        page.second.erase(std::unique(page.second.begin(), page.second.end()), page.second.end());
+    }
+
+    // Drop a partially written entry at the end of the file, so that new ones can be appended
+    file.Clear();
+    file.Resize(valid_size);
+    file.Seek(valid_size, SEEK_SET);
+}
+
+const std::vector<BlockDiskCache::EntryPoint>* BlockDiskCache::Find(u64 page_hash) const {
+    auto iter = pages.find(page_hash);
+    return iter != pages.end() ? &iter->second : nullptr;
+}
+
+void BlockDiskCache::Record(u64 page_hash, EntryPoint entry_point) {
+    auto& known = pages[page_hash];
+    auto position = std::lower_bound(known.begin(), known.end(), entry_point);
+    if (position != known.end() && *position == entry_point)
+        return;
+
+    known.insert(position, entry_point);
+    pending[page_hash].push_back(entry_point);
+}
+
+void BlockDiskCache::Flush() {
+    if (!file.IsOpen() || pending.empty())
+        return;
+
+    for (const auto& page : pending) {
+        CacheEntryHeader entry{};
+        entry.page_hash = page.first;
+        entry.num_entry_points = static_cast<u32>(page.second.size());
+
+        file.WriteBytes(&entry, sizeof(entry));
+        file.WriteArray(page.second.data(), page.second.size());
+    }
+    file.Flush();
+    pending.clear();
+}
@@ -0,0 +1,43 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/file_util.h"
+
+/**
+ * Persistent record of the blocks translated by the interpreter, stored in the cache directory of
+ * the user path. Translated blocks contain host pointers and can't be stored themselves, so the
+ * cache remembers the entry points of the blocks found in each code page instead, keyed by a hash
+ * of the page contents. When a page with known contents gets executed again, all of its blocks are
+ * translated at once rather than one miss at a time.
+ */
+class BlockDiskCache final {
+public:
+    /// Offset of a block in its page, with bit 0 set for Thumb code
+    using EntryPoint = u16;
+
+    BlockDiskCache();
+
+    /// Returns the entry points recorded for a page with the given contents, or nullptr
+    const std::vector<EntryPoint>* Find(u64 page_hash) const;
+
+    /// Records a block translated in a page with the given contents
+    void Record(u64 page_hash, EntryPoint entry_point);
+
+    /// Appends the blocks recorded since the last call to the cache file
+    void Flush();
+
+private:
+    /// Reads all entries of the cache file, or resets the file if it is not usable
+    void ReadEntries();
+
+    FileUtil::IOFile file;
+    std::unordered_map<u64, std::vector<EntryPoint>> pages;
+    std::unordered_map<u64, std::vector<EntryPoint>> pending;
+};
@@ -6,14 +6,18 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <memory>
 
 #include "common/common_types.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
 
 #include "core/memory.h"
+#include "core/settings.h"
 #include "core/hle/svc.h"
 #include "core/arm/disassembler/arm_disasm.h"
+#include "core/arm/dyncom/arm_dyncom_block_cache.h"
 #include "core/arm/dyncom/arm_dyncom_dec.h"
 #include "core/arm/dyncom/arm_dyncom_interpreter.h"
 #include "core/arm/dyncom/arm_dyncom_thumb.h"
@@ -820,26 +824,57 @@ static unsigned int InterpreterTranslateInstruction(const ARMul_State* cpu, cons
     return inst_size;
 }
 
-static int InterpreterTranslateBlock(ARMul_State* cpu, int& bb_start, u32 addr) {
-    MICROPROFILE_SCOPE(DynCom_Decode);
+/// Allocates the links of a new block, returning the offset of its first instruction
+static int AllocBlock() {
+    BlockLinks* links = static_cast<BlockLinks*>(AllocBuffer(sizeof(BlockLinks)));
+    *links = {};
+    links->generation = block_links_generation;
+    return static_cast<int>(trans_cache_buf_top);
+}
+
+/// Adds a translated block to the instruction cache, indexed by the page it starts in
+static void AddToInstructionCache(ARMul_State* cpu, u32 pc, int ptr) {
+    if (cpu->instruction_cache.emplace(pc, ptr).second) {
+        cpu->instruction_cache_pages[pc & ~Memory::PAGE_MASK].push_back(pc);
+    } else {
+        cpu->instruction_cache[pc] = ptr;
+    }
+}
+
+static std::unique_ptr<BlockDiskCache> block_disk_cache;
+
+static BlockDiskCache* GetBlockDiskCache() {
+    if (!Settings::values.use_interpreter_block_cache)
+        return nullptr;
+    if (!block_disk_cache)
+        block_disk_cache = std::make_unique<BlockDiskCache>();
+    return block_disk_cache.get();
+}
 
+void FlushBlockDiskCache() {
+    if (block_disk_cache)
+        block_disk_cache->Flush();
+}
+
+static u64 HashCodePage(u32 page) {
+    const u8* memory = Memory::GetPointer(page);
+    return memory != nullptr ? Common::ComputeHash64(memory, Memory::PAGE_SIZE) : 0;
+}
+
+/// Decodes instructions starting at `addr` until the end of the basic block
+static int TranslateBasicBlock(ARMul_State* cpu, u32 addr) {
     // Decode instruction, get index
     // Allocate memory and init InsCream
     // Go on next, until terminal instruction
-    // Save start addr of basicblock in CreamCache
     ARM_INST_PTR inst_base = nullptr;
     TransExtData ret = TransExtData::NON_BRANCH;
-    int size = 0; // instruction size of basic block
-    bb_start = trans_cache_buf_top;
+    int bb_start = AllocBlock();
 
     u32 phys_addr = addr;
-    u32 pc_start = cpu->Reg[15];
 
     while (ret == TransExtData::NON_BRANCH) {
         unsigned int inst_size = InterpreterTranslateInstruction(cpu, phys_addr, inst_base);
 
-        size++;
-
         phys_addr += inst_size;
 
         if ((phys_addr & 0xfff) == 0) {
@@ -848,7 +883,58 @@ static int InterpreterTranslateBlock(ARMul_State* cpu, int& bb_start, u32 addr)
         ret = inst_base->br;
     };
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    return bb_start;
+}
+
+/**
+ * Translates all blocks recorded in the disk cache for a code page, the first time the page is
+ * executed since the translation cache was cleared
+ */
+static void TranslateCachedBlocks(ARMul_State* cpu, BlockDiskCache& disk_cache, u32 page) {
+    if (!cpu->code_pages_seen.insert(page).second)
+        return;
+
+    const u64 page_hash = HashCodePage(page);
+    const auto* entry_points = page_hash != 0 ? disk_cache.Find(page_hash) : nullptr;
+    if (entry_points == nullptr)
+        return;
+
+    // The decoder picks the instruction set from the current state
+    const u32 tflag = cpu->TFlag;
+    for (BlockDiskCache::EntryPoint entry_point : *entry_points) {
+        const u32 pc = page | (entry_point & ~1u);
+        if (cpu->instruction_cache.count(pc) != 0)
+            continue;
+
+        cpu->TFlag = entry_point & 1;
+        AddToInstructionCache(cpu, pc, TranslateBasicBlock(cpu, pc));
+    }
+    cpu->TFlag = tflag;
+}
+
+static int InterpreterTranslateBlock(ARMul_State* cpu, int& bb_start, u32 addr) {
+    MICROPROFILE_SCOPE(DynCom_Decode);
+
+    BlockDiskCache* disk_cache = GetBlockDiskCache();
+    if (disk_cache != nullptr) {
+        const u32 page = addr & ~Memory::PAGE_MASK;
+        TranslateCachedBlocks(cpu, *disk_cache, page);
+
+        auto itr = cpu->instruction_cache.find(addr);
+        if (itr != cpu->instruction_cache.end()) {
+            bb_start = itr->second;
+            return KEEP_GOING;
+        }
+
+        // Hash the page as it is now, it may have changed since it was first executed
+        const u64 page_hash = HashCodePage(page);
+        if (page_hash != 0)
+            disk_cache->Record(page_hash, static_cast<u16>((addr & Memory::PAGE_MASK) | cpu->TFlag));
+    }
+
+    // Save start addr of basicblock in CreamCache
+    bb_start = TranslateBasicBlock(cpu, addr);
+    AddToInstructionCache(cpu, addr, bb_start);
 
     return KEEP_GOING;
 }
@@ -857,7 +943,7 @@ static int InterpreterTranslateSingle(ARMul_State* cpu, int& bb_start, u32 addr)
     MICROPROFILE_SCOPE(DynCom_Decode);
 
     ARM_INST_PTR inst_base = nullptr;
-    bb_start = trans_cache_buf_top;
+    bb_start = AllocBlock();
 
     u32 phys_addr = addr;
     u32 pc_start = cpu->Reg[15];
@@ -868,7 +954,7 @@ static int InterpreterTranslateSingle(ARMul_State* cpu, int& bb_start, u32 addr)
         inst_base->br = TransExtData::SINGLE_STEP;
     }
 
-    cpu->instruction_cache[pc_start] = bb_start;
+    AddToInstructionCache(cpu, pc_start, bb_start);
 
     return KEEP_GOING;
 }
@@ -1202,6 +1288,7 @@ unsigned InterpreterMainLoop(ARMul_State* cpu) {
     unsigned int num_instrs = 0;
 
     int ptr;
+    BlockLinks* current_block = nullptr;
 
     LOAD_NZCVT;
     DISPATCH:
@@ -1217,17 +1304,25 @@ unsigned InterpreterMainLoop(ARMul_State* cpu) {
         else
             cpu->Reg[15] &= 0xfffffffc;
 
-        // Find the cached instruction cream, otherwise translate it...
-        auto itr = cpu->instruction_cache.find(cpu->Reg[15]);
-        if (itr != cpu->instruction_cache.end()) {
-            ptr = itr->second;
-        } else if (cpu->NumInstrsToExecute != 1) {
-            if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-                goto END;
-        } else {
-            if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
-                goto END;
+        // Follow the links of the previous block, otherwise find the cached instruction cream,
+        // otherwise translate it...
+        ptr = current_block != nullptr ? current_block->Find(cpu->Reg[15]) : 0;
+        if (ptr == 0) {
+            auto itr = cpu->instruction_cache.find(cpu->Reg[15]);
+            if (itr != cpu->instruction_cache.end()) {
+                ptr = itr->second;
+            } else if (cpu->NumInstrsToExecute != 1) {
+                if (InterpreterTranslateBlock(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            } else {
+                if (InterpreterTranslateSingle(cpu, ptr, cpu->Reg[15]) == FETCH_EXCEPTION)
+                    goto END;
+            }
+
+            if (current_block != nullptr)
+                current_block->Link(cpu->Reg[15], ptr);
         }
+        current_block = &GetBlockLinks(ptr);
 
         // Find breakpoint if one exists within the block
         if (GDBStub::g_server_enabled && GDBStub::IsConnected()) {
@@ -3528,6 +3623,8 @@ unsigned InterpreterMainLoop(ARMul_State* cpu) {
         if (inst_base->cond == ConditionCode::AL || CondPassed(cpu, inst_base->cond)) {
             swi_inst* const inst_cream = (swi_inst*)inst_base->component;
             SVC::CallSVC(inst_cream->num & 0xFFFF);
+            // The SVC may have invalidated translated code, along with the current block links
+            current_block = nullptr;
         }
 
         cpu->Reg[15] += cpu->GetInstructionSize();
@@ -7,3 +7,6 @@
 struct ARMul_State;
 
 unsigned InterpreterMainLoop(ARMul_State* state);
+
+/// Writes the blocks recorded since the last call to the interpreter block disk cache
+void FlushBlockDiskCache();
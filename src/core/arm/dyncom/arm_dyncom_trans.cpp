@@ -11,8 +11,9 @@
 
 char trans_cache_buf[TRANS_CACHE_SIZE];
 size_t trans_cache_buf_top = 0;
+u32 block_links_generation = 0;
 
-static void* AllocBuffer(size_t size) {
+void* AllocBuffer(size_t size) {
     size_t start = trans_cache_buf_top;
     trans_cache_buf_top += size;
     ASSERT_MSG(trans_cache_buf_top <= TRANS_CACHE_SIZE, "Translation cache is full!");
@@ -488,6 +488,56 @@ typedef ARM_INST_PTR (*transop_fp_t)(unsigned int, int);
 extern const transop_fp_t arm_instruction_trans[];
 extern const size_t arm_instruction_trans_len;
 
+/// Incremented whenever translated blocks are discarded, which makes all existing block links stale
+extern u32 block_links_generation;
+
+/**
+ * Placed in front of the first instruction of each translated block. Caches the two blocks most
+ * recently dispatched to after this one, so that following a branch usually doesn't need a lookup
+ * in the instruction cache. Links made before blocks were last discarded are ignored, since they
+ * may lead to discarded blocks.
+ */
+struct BlockLinks {
+    static constexpr size_t NUM_LINKS = 2;
+
+    u32 generation; ///< Value of block_links_generation when the links were made
+    u32 target_pc[NUM_LINKS];
+    int target_ptr[NUM_LINKS]; ///< Offset of the target block in trans_cache_buf, 0 if unused
+
+    /// Returns the offset of the linked block starting at `pc`, or 0 if there is none
+    int Find(u32 pc) const {
+        if (generation != block_links_generation)
+            return 0;
+        for (size_t i = 0; i < NUM_LINKS; ++i) {
+            if (target_ptr[i] != 0 && target_pc[i] == pc)
+                return target_ptr[i];
+        }
+        return 0;
+    }
+
+    /// Links the block at `ptr`, replacing the least recently linked one
+    void Link(u32 pc, int ptr) {
+        if (generation != block_links_generation) {
+            *this = {};
+            generation = block_links_generation;
+        }
+        for (size_t i = NUM_LINKS - 1; i > 0; --i) {
+            target_pc[i] = target_pc[i - 1];
+            target_ptr[i] = target_ptr[i - 1];
+        }
+        target_pc[0] = pc;
+        target_ptr[0] = ptr;
+    }
+};
+
 #define TRANS_CACHE_SIZE (64 * 1024 * 2000)
 extern char trans_cache_buf[TRANS_CACHE_SIZE];
 extern size_t trans_cache_buf_top;
+
+/// Allocates space in the translation cache
+void* AllocBuffer(size_t size);
+
+/// Returns the links of the block whose first instruction is at the given offset
+inline BlockLinks& GetBlockLinks(int ptr) {
+    return *reinterpret_cast<BlockLinks*>(&trans_cache_buf[ptr - sizeof(BlockLinks)]);
+}
@@ -19,6 +19,8 @@
 
 #include <array>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "common/common_types.h"
 #include "core/arm/skyeye_common/arm_regformat.h"
@@ -239,6 +241,10 @@ public:
     // TODO(bunnei): Move this cache to a better place - it should be per codeset (likely per
     // process for our purposes), not per ARMul_State (which tracks CPU core state).
     std::unordered_map<u32, int> instruction_cache;
+    /// Start addresses of the blocks in instruction_cache, by the page they start in
+    std::unordered_map<u32, std::vector<u32>> instruction_cache_pages;
+    /// Code pages whose blocks from the block disk cache have already been translated
+    std::unordered_set<u32> code_pages_seen;
 
 private:
     void ResetMPCoreCP15Registers();
@@ -3,9 +3,14 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <set>
 
 #include "common/file_util.h"
+#include "core/arm/arm_interface.h"
 #include "core/cheat_core.h"
+#include "core/core.h"
+#include "core/hle/kernel/process.h"
+#include "core/hle/kernel/vm_manager.h"
 #include "core/loader/ncch.h"
 #include "core/memory.h"
 
@@ -36,6 +41,63 @@ void RefreshCheats() {
 }
 
 namespace CheatEngine {
+    /// Pages of the code segments modified by cheats since the last call to InvalidateModifiedCode
+    static std::set<VAddr> modified_code_pages;
+
+    static bool IsCodeMemory(VAddr addr) {
+        if (Kernel::g_current_process == nullptr)
+            return false;
+        const auto& vm_manager = Kernel::g_current_process->vm_manager;
+        auto vma = vm_manager.FindVMA(addr);
+        return vma != vm_manager.vma_map.end() && vma->second.meminfo_state == Kernel::MemoryState::Code;
+    }
+
+    /**
+     * Writes a value for a cheat. The CPU may have translated the code at the address, or folded
+     * reads from it into translated code, so modified code pages are recorded to be invalidated.
+     * Cheats usually write the same values every frame, which doesn't count as a modification.
+     */
+    template <typename T>
+    static void WriteMemory(VAddr addr, T value, T (*read)(VAddr), void (*write)(VAddr, T)) {
+        if (!IsCodeMemory(addr)) {
+            write(addr, value);
+            return;
+        }
+
+        if (read(addr) == value)
+            return;
+        write(addr, value);
+        modified_code_pages.insert(addr & ~Memory::PAGE_MASK);
+        modified_code_pages.insert((addr + sizeof(T) - 1) & ~Memory::PAGE_MASK);
+    }
+
+    static void Write32(VAddr addr, u32 value) {
+        WriteMemory<u32>(addr, value, Memory::Read32, Memory::Write32);
+    }
+
+    static void Write16(VAddr addr, u16 value) {
+        WriteMemory<u16>(addr, value, Memory::Read16, Memory::Write16);
+    }
+
+    static void Write8(VAddr addr, u8 value) {
+        WriteMemory<u8>(addr, value, Memory::Read8, Memory::Write8);
+    }
+
+    /// Invalidates the translated code of the code pages modified by cheats, see CROHelper
+    static void InvalidateModifiedCode() {
+        // Merge consecutive pages into a single range
+        auto page = modified_code_pages.begin();
+        while (page != modified_code_pages.end()) {
+            const VAddr start = *page;
+            VAddr end = start + Memory::PAGE_SIZE;
+            while (++page != modified_code_pages.end() && *page == end)
+                end += Memory::PAGE_SIZE;
+
+            Core::g_app_core->InvalidateCacheRange(start, end - start);
+        }
+        modified_code_pages.clear();
+    }
+
     CheatEngine::CheatEngine() {
         //Create folder and file for cheats if it doesn't exist
         FileUtil::CreateDir(FileUtil::GetUserPath(D_USER_IDX) + "\\cheats");
@@ -133,6 +195,7 @@ namespace CheatEngine {
         for (auto& cheat : cheats_list) {
             cheat->Execute();
         }
+        InvalidateModifiedCode();
     }
 
     void GatewayCheat::Execute() {
@@ -177,17 +240,17 @@ namespace CheatEngine {
             switch (line.type) {
             case 0x00: { // 0XXXXXXX YYYYYYYY   word[XXXXXXX+offset] = YYYYYYYY
                 addr = line.address + offset;
-                Memory::Write32(addr, val);
+                Write32(addr, val);
                 break;
             }
             case 0x01: { // 1XXXXXXX 0000YYYY   half[XXXXXXX+offset] = YYYY
                 addr = line.address + offset;
-                Memory::Write16(addr, static_cast<u16>(val));
+                Write16(addr, static_cast<u16>(val));
                 break;
             }
             case 0x02: { // 2XXXXXXX 000000YY   byte[XXXXXXX+offset] = YY
                 addr = line.address + offset;
-                Memory::Write8(addr, static_cast<u8>(val));
+                Write8(addr, static_cast<u8>(val));
                 break;
             }
             case 0x03: { // 3XXXXXXX YYYYYYYY   IF YYYYYYYY > word[XXXXXXX]   ;unsigned
@@ -343,19 +406,19 @@ namespace CheatEngine {
                 }
                 case 0x06: {
                     addr = line.value + offset;
-                    Memory::Write32(addr, reg);
+                    Write32(addr, reg);
                     offset += 4;
                     break;
                 }
                 case 0x07: {
                     addr = line.value + offset;
-                    Memory::Write16(addr, static_cast<u16>(reg));
+                    Write16(addr, static_cast<u16>(reg));
                     offset += 2;
                     break;
                 }
                 case 0x08: {
                     addr = line.value + offset;
-                    Memory::Write8(addr, static_cast<u8>(reg));
+                    Write8(addr, static_cast<u8>(reg));
                     offset += 1;
                     break;
                 }
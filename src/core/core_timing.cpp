@@ -2,13 +2,15 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
-#include "common/chunk_file.h"
 #include "common/logging/log.h"
+#include "common/mpsc_queue.h"
 #include "common/string_util.h"
 
 #include "core/arm/arm_interface.h"
@@ -43,16 +45,58 @@ struct BaseEvent
     int type;
 };
 
-typedef LinkedListItem<BaseEvent> Event;
+/// Event in the main queue
+struct Event : BaseEvent
+{
+    u64 fifo_order; ///< Breaks ties between events scheduled for the same time
+    size_t heap_index; ///< Position in event_queue
+};
+
+/// Event scheduled from another thread, waiting to be moved into the main queue
+struct ThreadsafeEvent : BaseEvent
+{
+    u64 sequence; ///< Submission order across ts_queue and ts_overflow
+};
+
+struct EventKey
+{
+    int type;
+    u64 userdata;
+
+    bool operator==(const EventKey& other) const {
+        return type == other.type && userdata == other.userdata;
+    }
+};
 
-static Event* first;
-static Event* ts_first;
-static Event* ts_last;
+struct EventKeyHash
+{
+    size_t operator()(const EventKey& key) const {
+        return std::hash<u64>()(key.userdata) ^ (static_cast<size_t>(key.type) * 0x9E3779B97F4A7C15ull);
+    }
+};
 
-// event pools
-static Event* event_pool = nullptr;
-static Event* event_ts_pool = nullptr;
-static int allocated_ts_events = 0;
+// The main queue is a binary min-heap of indices into `events`, ordered by time and then by the
+// order of scheduling. Every event knows its position in the heap, so that events found through
+// `events_by_key` can be unscheduled in O(log n).
+static std::vector<Event> events;
+static std::vector<size_t> free_events;
+static std::vector<size_t> event_queue;
+static std::unordered_multimap<EventKey, size_t, EventKeyHash> events_by_key;
+static u64 event_fifo_id;
+
+// Events scheduled from other threads, moved into the main queue by the CPU thread. Producers only
+// take the lock if the ring is full. Events are numbered when they are submitted, so that the
+// order between the ring and the overflow vector can be restored when draining them.
+static Common::BoundedMPSCQueue<ThreadsafeEvent, 1024> ts_queue;
+static std::mutex ts_overflow_lock;
+static std::vector<ThreadsafeEvent> ts_overflow;
+static std::atomic<bool> has_ts_overflow(false);
+static std::atomic<u64> ts_sequence(0);
+// Events taken out of the queues above but not yet moved into the main queue
+static std::vector<ThreadsafeEvent> ts_pending;
+// Held by the consumer of ts_queue while it drains it or modifies ts_pending. The consumer is
+// normally the CPU thread, but the thread-safe unschedule functions may be called from any thread.
+static std::mutex ts_consumer_lock;
 // Optimization to skip MoveEvents when possible.
 static std::atomic<bool> has_ts_events(false);
 
@@ -63,8 +107,6 @@ static s64 idled_cycles;
 static s64 last_global_time_ticks;
 static s64 last_global_time_us;
 
-static std::recursive_mutex external_event_section;
-
 // Warning: not included in save state.
 using AdvanceCallback = void(int cycles_executed);
 static AdvanceCallback* advance_callback = nullptr;
@@ -98,35 +140,105 @@ u64 GetGlobalTimeUs() {
     return last_global_time_us + us_since_last;
 }
 
-static Event* GetNewEvent() {
-    if (!event_pool)
-        return new Event;
+static bool FiresBefore(size_t a, size_t b) {
+    const Event& event_a = events[a];
+    const Event& event_b = events[b];
+    return event_a.time < event_b.time ||
+        (event_a.time == event_b.time && event_a.fifo_order < event_b.fifo_order);
+}
+
+static void PlaceInQueue(size_t heap_index, size_t event) {
+    event_queue[heap_index] = event;
+    events[event].heap_index = heap_index;
+}
+
+static void SiftUp(size_t heap_index) {
+    const size_t event = event_queue[heap_index];
+    while (heap_index > 0) {
+        const size_t parent = (heap_index - 1) / 2;
+        if (!FiresBefore(event, event_queue[parent]))
+            break;
+        PlaceInQueue(heap_index, event_queue[parent]);
+        heap_index = parent;
+    }
+    PlaceInQueue(heap_index, event);
+}
+
+static void SiftDown(size_t heap_index) {
+    const size_t event = event_queue[heap_index];
+    const size_t size = event_queue.size();
+    for (;;) {
+        size_t child = heap_index * 2 + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && FiresBefore(event_queue[child + 1], event_queue[child]))
+            child++;
+        if (!FiresBefore(event_queue[child], event))
+            break;
+        PlaceInQueue(heap_index, event_queue[child]);
+        heap_index = child;
+    }
+    PlaceInQueue(heap_index, event);
+}
+
+static void AddEventToQueue(s64 time, int event_type, u64 userdata) {
+    size_t index;
+    if (free_events.empty()) {
+        index = events.size();
+        events.emplace_back();
+    } else {
+        index = free_events.back();
+        free_events.pop_back();
+    }
+
+    Event& event = events[index];
+    event.time = time;
+    event.userdata = userdata;
+    event.type = event_type;
+    event.fifo_order = event_fifo_id++;
 
-    Event* event = event_pool;
-    event_pool = event->next;
-    return event;
+    event_queue.push_back(index);
+    SiftUp(event_queue.size() - 1);
+    events_by_key.emplace(EventKey{ event_type, userdata }, index);
 }
 
-static Event* GetNewTsEvent() {
-    allocated_ts_events++;
+/// Removes the event at the given position of the heap and returns a copy of it
+static BaseEvent RemoveEventFromQueue(size_t heap_index) {
+    const size_t index = event_queue[heap_index];
+    const BaseEvent removed = events[index];
+
+    auto range = events_by_key.equal_range(EventKey{ removed.type, removed.userdata });
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        if (iter->second == index) {
+            events_by_key.erase(iter);
+            break;
+        }
+    }
 
-    if (!event_ts_pool)
-        return new Event;
+    const size_t last = event_queue.back();
+    event_queue.pop_back();
+    if (heap_index < event_queue.size()) {
+        PlaceInQueue(heap_index, last);
+        if (heap_index > 0 && FiresBefore(last, event_queue[(heap_index - 1) / 2])) {
+            SiftUp(heap_index);
+        } else {
+            SiftDown(heap_index);
+        }
+    }
 
-    Event* event = event_ts_pool;
-    event_ts_pool = event->next;
-    return event;
+    free_events.push_back(index);
+    return removed;
 }
 
-static void FreeEvent(Event* event) {
-    event->next = event_pool;
-    event_pool = event;
+static const Event* GetFirstEvent() {
+    return event_queue.empty() ? nullptr : &events[event_queue.front()];
 }
 
-static void FreeTsEvent(Event* event) {
-    event->next = event_ts_pool;
-    event_ts_pool = event;
-    allocated_ts_events--;
+/// Returns the indices of all pending events, sorted in the order they will fire
+static std::vector<size_t> GetSortedEvents() {
+    std::vector<size_t> sorted = event_queue;
+    std::sort(sorted.begin(), sorted.end(), FiresBefore);
+    return sorted;
 }
 
 int RegisterEvent(const char* name, TimedCallback callback) {
@@ -147,7 +259,7 @@ void RestoreRegisterEvent(int event_type, const char* name, TimedCallback callba
 }
 
 void UnregisterAllEvents() {
-    if (first)
+    if (!event_queue.empty())
         LOG_ERROR(Core_Timing, "Cannot unregister events with events pending");
     event_types.clear();
 }
@@ -162,13 +274,17 @@ void Init() {
     has_ts_events = 0;
     mhz_change_callbacks.clear();
 
-    first = nullptr;
-    ts_first = nullptr;
-    ts_last = nullptr;
+    ClearPendingEvents();
+    event_fifo_id = 0;
 
-    event_pool = nullptr;
-    event_ts_pool = nullptr;
-    allocated_ts_events = 0;
+    std::lock_guard<std::mutex> consumer_lock(ts_consumer_lock);
+    ThreadsafeEvent event;
+    while (ts_queue.TryPop(event)) {
+    }
+    ts_overflow.clear();
+    has_ts_overflow = false;
+    ts_sequence = 0;
+    ts_pending.clear();
 
     advance_callback = nullptr;
 }
@@ -177,19 +293,6 @@ void Shutdown() {
     MoveEvents();
     ClearPendingEvents();
     UnregisterAllEvents();
-
-    while (event_pool) {
-        Event* event = event_pool;
-        event_pool = event->next;
-        delete event;
-    }
-
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    while (event_ts_pool) {
-        Event* event = event_ts_pool;
-        event_ts_pool = event->next;
-        delete event;
-    }
 }
 
 u64 GetTicks() {
@@ -204,142 +307,112 @@ u64 GetIdleTicks() {
 // This is to be called when outside threads, such as the graphics thread, wants to
 // schedule things to be executed on the main thread.
 void ScheduleEvent_Threadsafe(s64 cycles_into_future, int event_type, u64 userdata) {
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    Event* new_event = GetNewTsEvent();
-    new_event->time = GetTicks() + cycles_into_future;
-    new_event->type = event_type;
-    new_event->next = nullptr;
-    new_event->userdata = userdata;
-    if (!ts_first)
-        ts_first = new_event;
-    if (ts_last)
-        ts_last->next = new_event;
-    ts_last = new_event;
+    ThreadsafeEvent new_event;
+    new_event.time = GetTicks() + cycles_into_future;
+    new_event.type = event_type;
+    new_event.userdata = userdata;
+    new_event.sequence = ts_sequence.fetch_add(1, std::memory_order_relaxed);
+
+    if (!ts_queue.TryPush(new_event)) {
+        // The CPU thread is lagging behind, keep the event on the side
+        std::lock_guard<std::mutex> lock(ts_overflow_lock);
+        ts_overflow.push_back(new_event);
+        has_ts_overflow.store(true, std::memory_order_release);
+    }
 
-    has_ts_events = true;
+    has_ts_events.store(true, std::memory_order_release);
 }
 
 // Same as ScheduleEvent_Threadsafe(0, ...) EXCEPT if we are already on the CPU thread
 // in which case the event will get handled immediately, before returning.
 void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata) {
-    if (false) //Core::IsCPUThread())
-    {
-        std::lock_guard<std::recursive_mutex> lock(external_event_section);
-        event_types[event_type].callback(userdata, 0);
-    }
-    else
-        ScheduleEvent_Threadsafe(0, event_type, userdata);
+    // TODO: Run the callback right away when called from the CPU thread
+    ScheduleEvent_Threadsafe(0, event_type, userdata);
 }
 
 void ClearPendingEvents() {
-    while (first) {
-        Event* event = first->next;
-        FreeEvent(first);
-        first = event;
-    }
-}
-
-static void AddEventToQueue(Event* new_event) {
-    Event* prev_event = nullptr;
-    Event** next_event = &first;
-    for (;;) {
-        Event*& next = *next_event;
-        if (!next || new_event->time < next->time) {
-            new_event->next = next;
-            next = new_event;
-            break;
-        }
-        prev_event = next;
-        next_event = &prev_event->next;
-    }
+    events.clear();
+    free_events.clear();
+    event_queue.clear();
+    events_by_key.clear();
 }
 
 void ScheduleEvent(s64 cycles_into_future, int event_type, u64 userdata) {
-    Event* new_event = GetNewEvent();
-    new_event->userdata = userdata;
-    new_event->type = event_type;
-    new_event->time = GetTicks() + cycles_into_future;
-    AddEventToQueue(new_event);
+    AddEventToQueue(GetTicks() + cycles_into_future, event_type, userdata);
 }
 
 s64 UnscheduleEvent(int event_type, u64 userdata) {
     s64 result = 0;
-    if (!first)
-        return result;
-    while (first) {
-        if (first->type == event_type && first->userdata == userdata) {
-            result = first->time - GetTicks();
-
-            Event* next = first->next;
-            FreeEvent(first);
-            first = next;
-        } else {
-            break;
+    bool found = false;
+    size_t last_event = 0;
+
+    auto range = events_by_key.equal_range(EventKey{ event_type, userdata });
+    while (range.first != range.second) {
+        // Report the remaining time of the last matching event to fire
+        const size_t index = range.first->second;
+        if (!found || FiresBefore(last_event, index)) {
+            result = events[index].time - GetTicks();
+            last_event = index;
+            found = true;
         }
-    }
-    if (!first)
-        return result;
-
-    Event* prev_event = first;
-    Event* ptr = prev_event->next;
-
-    while (ptr) {
-        if (ptr->type == event_type && ptr->userdata == userdata) {
-            result = ptr->time - GetTicks();
 
-            prev_event->next = ptr->next;
-            FreeEvent(ptr);
-            ptr = prev_event->next;
-        } else {
-            prev_event = ptr;
-            ptr = ptr->next;
-        }
+        RemoveEventFromQueue(events[index].heap_index);
+        range = events_by_key.equal_range(EventKey{ event_type, userdata });
     }
 
     return result;
 }
 
-s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata) {
-    s64 result = 0;
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    if (!ts_first)
-        return result;
-
-    while (ts_first) {
-        if (ts_first->type == event_type && ts_first->userdata == userdata) {
-            result = ts_first->time - GetTicks();
-
-            Event* next = ts_first->next;
-            FreeTsEvent(ts_first);
-            ts_first = next;
-        } else {
-            break;
-        }
-    }
+/**
+ * Takes the events scheduled from other threads out of the lock-free queue and the overflow
+ * vector, appending the ones matching `keep` to ts_pending in the order they were submitted.
+ * ts_consumer_lock must be held.
+ */
+template <typename Predicate>
+static void DrainThreadsafeEvents(Predicate keep) {
+    const size_t first_drained = ts_pending.size();
 
-    if (!ts_first)
-    {
-        ts_last = nullptr;
-        return result;
+    ThreadsafeEvent event;
+    while (ts_queue.TryPop(event)) {
+        if (keep(event))
+            ts_pending.push_back(event);
     }
 
-    Event* prev_event = ts_first;
-    Event* next = prev_event->next;
-    while (next) {
-        if (next->type == event_type && next->userdata == userdata) {
-            result = next->time - GetTicks();
-
-            prev_event->next = next->next;
-            if (next == ts_last)
-                ts_last = prev_event;
-            FreeTsEvent(next);
-            next = prev_event->next;
-        } else {
-            prev_event = next;
-            next = next->next;
+    if (has_ts_overflow.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(ts_overflow_lock);
+        for (const ThreadsafeEvent& overflow_event : ts_overflow) {
+            if (keep(overflow_event))
+                ts_pending.push_back(overflow_event);
         }
+        ts_overflow.clear();
+        has_ts_overflow.store(false, std::memory_order_relaxed);
+
+        // Events that overflowed were submitted before the ones that later found room in the
+        // ring. Restore that order, it decides which of two events due at the same time fires
+        // first.
+        std::sort(ts_pending.begin() + first_drained, ts_pending.end(),
+                  [](const ThreadsafeEvent& a, const ThreadsafeEvent& b) {
+                      return a.sequence < b.sequence;
+                  });
     }
+}
 
+/// Removes the events scheduled from other threads that match `remove`
+template <typename Predicate>
+static void RemoveThreadsafeEvents(Predicate remove) {
+    std::lock_guard<std::mutex> consumer_lock(ts_consumer_lock);
+    ts_pending.erase(std::remove_if(ts_pending.begin(), ts_pending.end(), remove), ts_pending.end());
+    DrainThreadsafeEvents([&](const BaseEvent& event) { return !remove(event); });
+}
+
+s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata) {
+    s64 result = 0;
+    RemoveThreadsafeEvents([&](const BaseEvent& event) {
+        if (event.type != event_type || event.userdata != userdata)
+            return false;
+        result = event.time - GetTicks();
+        return true;
+    });
     return result;
 }
 
@@ -353,79 +426,28 @@ void RegisterMHzChangeCallback(MHzChangeCallback callback) {
 }
 
 bool IsScheduled(int event_type) {
-    if (!first)
-        return false;
-    Event* event = first;
-    while (event) {
-        if (event->type == event_type)
+    for (size_t index : event_queue) {
+        if (events[index].type == event_type)
             return true;
-        event = event->next;
     }
     return false;
 }
 
 void RemoveEvent(int event_type) {
-    if (!first)
-        return;
-    while (first) {
-        if (first->type == event_type) {
-            Event *next = first->next;
-            FreeEvent(first);
-            first = next;
-        } else {
-            break;
-        }
-    }
-    if (!first)
-        return;
-    Event* prev = first;
-    Event* next = prev->next;
-    while (next) {
-        if (next->type == event_type) {
-            prev->next = next->next;
-            FreeEvent(next);
-            next = prev->next;
-        } else {
-            prev = next;
-            next = next->next;
-        }
+    std::vector<size_t> matching_events;
+    for (size_t index : event_queue) {
+        if (events[index].type == event_type)
+            matching_events.push_back(index);
     }
+
+    for (size_t index : matching_events)
+        RemoveEventFromQueue(events[index].heap_index);
 }
 
 void RemoveThreadsafeEvent(int event_type) {
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    if (!ts_first)
-        return;
-
-    while (ts_first) {
-        if (ts_first->type == event_type) {
-            Event* next = ts_first->next;
-            FreeTsEvent(ts_first);
-            ts_first = next;
-        } else {
-            break;
-        }
-    }
-
-    if (!ts_first) {
-        ts_last = nullptr;
-        return;
-    }
-
-    Event* prev = ts_first;
-    Event* next = prev->next;
-    while (next) {
-        if (next->type == event_type) {
-            prev->next = next->next;
-            if (next == ts_last)
-                ts_last = prev;
-            FreeTsEvent(next);
-            next = prev->next;
-        } else {
-            prev = next;
-            next = next->next;
-        }
-    }
+    RemoveThreadsafeEvents([event_type](const BaseEvent& event) {
+        return event.type == event_type;
+    });
 }
 
 void RemoveAllEvents(int event_type) {
@@ -435,12 +457,11 @@ void RemoveAllEvents(int event_type) {
 
 // This raise only the events required while the fifo is processing data
 void ProcessFifoWaitEvents() {
-    while (first) {
+    while (const Event* first = GetFirstEvent()) {
         if (first->time <= (s64)GetTicks()) {
-            Event* evt = first;
-            first = first->next;
-            event_types[evt->type].callback(evt->userdata, (int)(GetTicks() - evt->time));
-            FreeEvent(evt);
+            // The callback may schedule new events, so the event is removed from the queue first
+            const BaseEvent evt = RemoveEventFromQueue(0);
+            event_types[evt.type].callback(evt.userdata, (int)(GetTicks() - evt.time));
         } else {
             break;
         }
@@ -448,25 +469,16 @@ void ProcessFifoWaitEvents() {
 }
 
 void MoveEvents() {
+    // Events pushed concurrently set has_ts_events again, so they will be picked up by the next
+    // call if they're missed here
     has_ts_events = false;
 
-    std::lock_guard<std::recursive_mutex> lock(external_event_section);
-    // Move events from async queue into main queue
-    while (ts_first) {
-        Event* next = ts_first->next;
-        AddEventToQueue(ts_first);
-        ts_first = next;
-    }
-    ts_last = nullptr;
-
-    // Move free events to threadsafe pool
-    while (allocated_ts_events > 0 && event_pool) {
-        Event* event = event_pool;
-        event_pool = event->next;
-        event->next = event_ts_pool;
-        event_ts_pool = event;
-        allocated_ts_events--;
-    }
+    std::lock_guard<std::mutex> consumer_lock(ts_consumer_lock);
+    DrainThreadsafeEvents([](const BaseEvent&) { return true; });
+
+    for (const ThreadsafeEvent& event : ts_pending)
+        AddEventToQueue(event.time, event.type, event.userdata);
+    ts_pending.clear();
 }
 
 void ForceCheck() {
@@ -487,6 +499,7 @@ void Advance() {
         MoveEvents();
     ProcessFifoWaitEvents();
 
+    const Event* first = GetFirstEvent();
     if (!first) {
         if (g_slice_length < 10000) {
             g_slice_length += 10000;
@@ -507,11 +520,12 @@ void Advance() {
 }
 
 void LogPendingEvents() {
-    Event* event = first;
-    while (event) {
-        //LOG_TRACE(Core_Timing, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, next->time, next->type);
-        event = event->next;
+#ifdef _DEBUG // LOG_TRACE is compiled out otherwise, don't sort the events for nothing
+    for (size_t index : GetSortedEvents()) {
+        LOG_TRACE(Core_Timing, "PENDING: Now: %" PRId64 " Pending: %" PRId64 " Type: %d",
+                  global_timer, events[index].time, events[index].type);
     }
+#endif
 }
 
 void Idle(int max_idle) {
@@ -519,6 +533,7 @@ void Idle(int max_idle) {
     if (max_idle != 0 && cycles_down > max_idle)
         cycles_down = max_idle;
 
+    const Event* first = GetFirstEvent();
     if (first && cycles_down > 0) {
         s64 cycles_executed = g_slice_length - Core::g_app_core->down_count;
         s64 cycles_next_event = first->time - global_timer;
@@ -540,10 +555,10 @@ void Idle(int max_idle) {
 }
 
 std::string GetScheduledEventsSummary() {
-    Event* event = first;
     std::string text = "Scheduled events\n";
     text.reserve(1000);
-    while (event) {
+    for (size_t index : GetSortedEvents()) {
+        const Event* event = &events[index];
         unsigned int t = event->type;
         if (t >= event_types.size())
             LOG_ERROR(Core_Timing, "Invalid event type"); // %i", t);
@@ -552,7 +567,6 @@ std::string GetScheduledEventsSummary() {
             name = "[unknown]";
         text += Common::StringFromFormat("%s : %i %08x%08x\n", name, (int)event->time,
                 (u32)(event->userdata >> 32), (u32)(event->userdata));
-        event = event->next;
     }
     return text;
 }
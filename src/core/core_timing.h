@@ -107,6 +107,10 @@ void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata = 0);
  */
 s64 UnscheduleEvent(int event_type, u64 userdata);
 
+/**
+ * Unschedules events scheduled with ScheduleEvent_Threadsafe that haven't been moved into the main
+ * queue yet. Like RemoveThreadsafeEvent, this can be called from any thread.
+ */
 s64 UnscheduleThreadsafeEvent(int event_type, u64 userdata);
 
 void RemoveEvent(int event_type);
@@ -0,0 +1,352 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <mutex>
+
+#if defined(__linux__) && defined(ARCHITECTURE_x86_64)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "common/x64/abi.h"
+#include "common/x64/emitter.h"
+#define HAVE_FASTMEM
+#endif
+
+#include "common/assert.h"
+#include "common/logging/log.h"
+
+#include "core/fastmem.h"
+#include "core/memory.h"
+#include "core/settings.h"
+
+namespace Memory {
+namespace Fastmem {
+
+#ifdef HAVE_FASTMEM
+
+/// Size of the shared memory pool backing guest memory blocks. Host memory is only committed once
+/// the pool is actually used.
+constexpr size_t POOL_SIZE = size_t(1) << 31;
+/// Size of the arena, covering the whole guest address space plus a guard page for accesses
+/// crossing its end
+constexpr size_t ARENA_SIZE = (size_t(1) << 32) + PAGE_SIZE;
+
+static int pool_fd = -1;
+static u8* pool_base = nullptr;
+static u8* arena_base = nullptr;
+static bool active = false;
+
+/// Free ranges of the pool, as offset -> size
+static std::map<size_t, size_t> free_ranges;
+static std::mutex pool_mutex;
+
+/// Host instructions accessing the arena, and where to resume execution when they fault
+struct FaultSite {
+    const u8* access;
+    const u8* fallback;
+};
+
+static std::array<FaultSite, 8> fault_sites;
+static Accessors accessors;
+static struct sigaction old_sigsegv_action;
+
+static size_t RoundUpToPage(size_t size) {
+    return (size + PAGE_MASK) & ~static_cast<size_t>(PAGE_MASK);
+}
+
+static bool CreatePool() {
+    pool_fd = static_cast<int>(syscall(SYS_memfd_create, "citra-fastmem", 0));
+    if (pool_fd < 0) {
+        LOG_ERROR(Core, "Failed to create the fastmem backing pool: %s", strerror(errno));
+        return false;
+    }
+
+    if (ftruncate(pool_fd, POOL_SIZE) != 0) {
+        LOG_ERROR(Core, "Failed to resize the fastmem backing pool: %s", strerror(errno));
+        close(pool_fd);
+        pool_fd = -1;
+        return false;
+    }
+
+    void* base = mmap(nullptr, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, pool_fd, 0);
+    if (base == MAP_FAILED) {
+        LOG_ERROR(Core, "Failed to map the fastmem backing pool: %s", strerror(errno));
+        close(pool_fd);
+        pool_fd = -1;
+        return false;
+    }
+
+    pool_base = static_cast<u8*>(base);
+    free_ranges.emplace(0, POOL_SIZE);
+    return true;
+}
+
+/// Makes the entire arena inaccessible, reserving it first if needed
+static bool ResetArena() {
+    void* base = mmap(arena_base, ARENA_SIZE, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | (arena_base ? MAP_FIXED : 0), -1, 0);
+    if (base == MAP_FAILED) {
+        LOG_ERROR(Core, "Failed to reserve the fastmem arena: %s", strerror(errno));
+        return false;
+    }
+
+    arena_base = static_cast<u8*>(base);
+    return true;
+}
+
+class AccessorCode : public Gen::XCodeBlock {
+public:
+    AccessorCode() {
+        AllocCodeSpace(4096);
+
+        accessors.Read8 = reinterpret_cast<u8 (*)(VAddr)>(EmitRead(8, reinterpret_cast<const void*>(&Memory::Read8)));
+        accessors.Read16 = reinterpret_cast<u16 (*)(VAddr)>(EmitRead(16, reinterpret_cast<const void*>(&Memory::Read16)));
+        accessors.Read32 = reinterpret_cast<u32 (*)(VAddr)>(EmitRead(32, reinterpret_cast<const void*>(&Memory::Read32)));
+        accessors.Read64 = reinterpret_cast<u64 (*)(VAddr)>(EmitRead(64, reinterpret_cast<const void*>(&Memory::Read64)));
+        accessors.Write8 = reinterpret_cast<void (*)(VAddr, u8)>(EmitWrite(8, reinterpret_cast<const void*>(&Memory::Write8)));
+        accessors.Write16 = reinterpret_cast<void (*)(VAddr, u16)>(EmitWrite(16, reinterpret_cast<const void*>(&Memory::Write16)));
+        accessors.Write32 = reinterpret_cast<void (*)(VAddr, u32)>(EmitWrite(32, reinterpret_cast<const void*>(&Memory::Write32)));
+        accessors.Write64 = reinterpret_cast<void (*)(VAddr, u64)>(EmitWrite(64, reinterpret_cast<const void*>(&Memory::Write64)));
+
+        ASSERT(num_sites == fault_sites.size());
+        ASSERT(std::is_sorted(fault_sites.begin(), fault_sites.end(),
+                              [](const FaultSite& a, const FaultSite& b) { return a.access < b.access; }));
+    }
+
+private:
+    /**
+     * Emits an accessor loading from the arena. The arguments are left untouched, so that a
+     * faulting access can simply be restarted from the fallback.
+     */
+    const u8* EmitRead(int bits, const void* fallback) {
+        using namespace Gen;
+
+        const u8* entry = GetCodePtr();
+        MOV(32, R(RAX), R(ABI_PARAM1));
+        MOV(64, R(RCX), ImmPtr(arena_base));
+        const u8* access = GetCodePtr();
+        if (bits < 32) {
+            MOVZX(32, bits, RAX, MComplex(RCX, RAX, SCALE_1, 0));
+        } else {
+            MOV(bits, R(RAX), MComplex(RCX, RAX, SCALE_1, 0));
+        }
+        RET();
+        EmitFallback(access, fallback);
+        return entry;
+    }
+
+    /// Emits an accessor storing to the arena, see EmitRead
+    const u8* EmitWrite(int bits, const void* fallback) {
+        using namespace Gen;
+
+        const u8* entry = GetCodePtr();
+        MOV(32, R(RAX), R(ABI_PARAM1));
+        MOV(64, R(RCX), ImmPtr(arena_base));
+        const u8* access = GetCodePtr();
+        MOV(bits, MComplex(RCX, RAX, SCALE_1, 0), R(ABI_PARAM2));
+        RET();
+        EmitFallback(access, fallback);
+        return entry;
+    }
+
+    /// Emits a tail call to the page table based accessor, taken when `access` faults
+    void EmitFallback(const u8* access, const void* fallback) {
+        using namespace Gen;
+
+        fault_sites[num_sites++] = {access, GetCodePtr()};
+        MOV(64, R(RAX), ImmPtr(fallback));
+        JMPptr(R(RAX));
+    }
+
+    size_t num_sites = 0;
+};
+
+/// Finds the fault site of a faulting instruction, the sites being emitted in ascending order
+static const FaultSite* FindFaultSite(const u8* pc) {
+    auto it = std::lower_bound(fault_sites.begin(), fault_sites.end(), pc,
+                               [](const FaultSite& site, const u8* p) { return site.access < p; });
+    return (it != fault_sites.end() && it->access == pc) ? &*it : nullptr;
+}
+
+static void SigsegvHandler(int sig, siginfo_t* info, void* raw_context) {
+    ucontext_t* context = static_cast<ucontext_t*>(raw_context);
+    greg_t& rip = context->uc_mcontext.gregs[REG_RIP];
+    const u8* fault_address = static_cast<const u8*>(info->si_addr);
+
+    if (fault_address >= arena_base && fault_address < arena_base + ARENA_SIZE) {
+        if (const FaultSite* site = FindFaultSite(reinterpret_cast<const u8*>(rip))) {
+            rip = reinterpret_cast<greg_t>(site->fallback);
+            return;
+        }
+    }
+
+    // Not caused by an arena access, forward the signal to whoever was handling it before
+    if (old_sigsegv_action.sa_flags & SA_SIGINFO) {
+        old_sigsegv_action.sa_sigaction(sig, info, raw_context);
+    } else if (old_sigsegv_action.sa_handler == SIG_DFL) {
+        // Returning restarts the faulting instruction, which then takes the default action
+        signal(sig, SIG_DFL);
+    } else if (old_sigsegv_action.sa_handler != SIG_IGN) {
+        old_sigsegv_action.sa_handler(sig);
+    }
+}
+
+static bool InstallHandler() {
+    struct sigaction action = {};
+    action.sa_sigaction = &SigsegvHandler;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGSEGV, &action, &old_sigsegv_action) != 0) {
+        LOG_ERROR(Core, "Failed to install the fastmem fault handler: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void Init() {
+    active = false;
+    if (!Settings::values.use_fastmem)
+        return;
+
+    if (pool_base == nullptr && !CreatePool())
+        return;
+    if (!ResetArena())
+        return;
+
+    static bool handler_installed = false;
+    if (!handler_installed) {
+        static AccessorCode accessor_code;
+        if (!InstallHandler())
+            return;
+        handler_installed = true;
+    }
+
+    active = true;
+    LOG_INFO(Core, "Fastmem arena at %p", arena_base);
+}
+
+void Shutdown() {
+    if (!active)
+        return;
+
+    ResetArena();
+    active = false;
+}
+
+const Accessors* GetAccessors() {
+    return active ? &accessors : nullptr;
+}
+
+void MapRegion(VAddr base, u32 size, u8* memory) {
+    if (!active || size == 0)
+        return;
+
+    u8* target = arena_base + base;
+    void* result;
+    if (memory != nullptr && IsBackingMemory(memory) && IsBackingMemory(memory + size - 1)) {
+        result = mmap(target, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, pool_fd,
+                      memory - pool_base);
+    } else {
+        result = mmap(target, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    }
+    ASSERT_MSG(result != MAP_FAILED, "Failed to map fastmem region %08X-%08X: %s", base, base + size, strerror(errno));
+}
+
+void* AllocateBacking(size_t size) {
+    if (!active || size == 0)
+        return nullptr;
+
+    size = RoundUpToPage(size);
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        if (it->second < size)
+            continue;
+
+        const size_t offset = it->first;
+        const size_t remaining = it->second - size;
+        free_ranges.erase(it);
+        if (remaining != 0)
+            free_ranges.emplace(offset + size, remaining);
+        return pool_base + offset;
+    }
+
+    LOG_WARNING(Core, "Fastmem backing pool exhausted, allocating %zu bytes outside of it", size);
+    return nullptr;
+}
+
+void FreeBacking(void* pointer, size_t size) {
+    if (size == 0)
+        return;
+
+    size_t offset = static_cast<u8*>(pointer) - pool_base;
+    size = RoundUpToPage(size);
+
+    // Give the pages back to the host, this also zeroes them for the next allocation
+    fallocate(pool_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size);
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    auto next = free_ranges.lower_bound(offset);
+    if (next != free_ranges.end() && offset + size == next->first) {
+        size += next->second;
+        next = free_ranges.erase(next);
+    }
+    if (next != free_ranges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    free_ranges.emplace(offset, size);
+}
+
+bool IsBackingMemory(const void* pointer) {
+    const u8* p = static_cast<const u8*>(pointer);
+    return pool_base != nullptr && p >= pool_base && p < pool_base + POOL_SIZE;
+}
+
+#else
+
+void Init() {
+    if (Settings::values.use_fastmem) {
+        LOG_WARNING(Core, "Fastmem isn't supported on this platform");
+    }
+}
+
+void Shutdown() {}
+
+const Accessors* GetAccessors() {
+    return nullptr;
+}
+
+void MapRegion(VAddr base, u32 size, u8* memory) {}
+
+void* AllocateBacking(size_t size) {
+    return nullptr;
+}
+
+void FreeBacking(void* pointer, size_t size) {
+    UNREACHABLE();
+}
+
+bool IsBackingMemory(const void* pointer) {
+    return false;
+}
+
+#endif
+
+} // namespace Fastmem
+} // namespace Memory
@@ -0,0 +1,128 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "common/common_types.h"
+
+/**
+ * Fastmem: the whole 4GiB guest address space mirrored into a host address range (the arena), so
+ * that guest memory can be accessed with a single host load or store at `arena + vaddr`.
+ *
+ * Guest memory blocks are allocated from a shared memory pool, which lets each mapped page be
+ * mirrored into the arena. Pages which can't be accessed directly (unmapped, MMIO, rasterizer
+ * cached or backed by memory outside of the pool) are left inaccessible in the arena. Accesses to
+ * them fault, and a SIGSEGV handler resumes execution on the regular page table based path.
+ */
+namespace Memory {
+namespace Fastmem {
+
+/// Memory accessors going through the arena, with the same signatures as Memory::Read8 etc.
+struct Accessors {
+    u8 (*Read8)(VAddr addr);
+    u16 (*Read16)(VAddr addr);
+    u32 (*Read32)(VAddr addr);
+    u64 (*Read64)(VAddr addr);
+    void (*Write8)(VAddr addr, u8 data);
+    void (*Write16)(VAddr addr, u16 data);
+    void (*Write32)(VAddr addr, u32 data);
+    void (*Write64)(VAddr addr, u64 data);
+};
+
+/**
+ * Sets up the arena if enabled in the settings and supported by the host. Must be called before
+ * any guest memory block is allocated.
+ */
+void Init();
+
+/// Makes the whole arena inaccessible again
+void Shutdown();
+
+/// Returns the arena based memory accessors, or nullptr if fastmem isn't active
+const Accessors* GetAccessors();
+
+/**
+ * Mirrors a region of guest memory into the arena, or makes it inaccessible
+ * @param base Page aligned virtual address of the region
+ * @param size Page aligned size of the region
+ * @param memory Host memory backing the region, or nullptr if accesses to the region must take
+ *        the slow path
+ */
+void MapRegion(VAddr base, u32 size, u8* memory);
+
+/// Allocates memory from the backing pool, or returns nullptr if fastmem isn't active
+void* AllocateBacking(size_t size);
+
+/// Frees memory allocated by AllocateBacking
+void FreeBacking(void* pointer, size_t size);
+
+/// Returns whether the pointer has been allocated by AllocateBacking
+bool IsBackingMemory(const void* pointer);
+
+/**
+ * Allocator for containers holding guest memory, placing their storage in the backing pool
+ * whenever fastmem is active.
+ */
+template <typename T>
+struct BackingAllocator {
+    using value_type = T;
+
+    BackingAllocator() = default;
+    template <typename U>
+    BackingAllocator(const BackingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* pointer = AllocateBacking(n * sizeof(T));
+        if (pointer == nullptr)
+            pointer = ::operator new(n * sizeof(T));
+        return static_cast<T*>(pointer);
+    }
+
+    void deallocate(T* pointer, size_t n) {
+        if (IsBackingMemory(pointer)) {
+            FreeBacking(pointer, n * sizeof(T));
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const BackingAllocator<T>&, const BackingAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const BackingAllocator<T>&, const BackingAllocator<U>&) {
+    return false;
+}
+
+/// Destroys and frees an object allocated by MakeBacking
+template <typename T>
+struct BackingDeleter {
+    void operator()(T* pointer) const {
+        pointer->~T();
+        BackingAllocator<T>().deallocate(pointer, 1);
+    }
+};
+
+template <typename T>
+using BackingPtr = std::unique_ptr<T, BackingDeleter<T>>;
+
+/**
+ * Creates a value-initialized object in the backing pool, for fixed guest memory regions (config
+ * memory, the shared page...) which are mapped straight from an emulator side structure.
+ */
+template <typename T>
+BackingPtr<T> MakeBacking() {
+    T* pointer = BackingAllocator<T>().allocate(1);
+    return BackingPtr<T>(new (pointer) T());
+}
+
+} // namespace Fastmem
+} // namespace Memory
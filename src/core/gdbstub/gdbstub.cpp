@@ -670,6 +670,9 @@ static void WriteMemory() {
     }
 
     GdbHexToMem(dst, len_pos + 1, len);
+
+    // The client may patch code, e.g. to set software breakpoints
+    Core::g_app_core->InvalidateCacheRange(addr, len);
     SendReply("OK");
 }
 
@@ -0,0 +1,200 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "common/common_paths.h"
+#include "common/file_util.h"
+#include "common/logging/log.h"
+#include "common/string_util.h"
+#include "common/symbols.h"
+
+#include "core/core.h"
+#include "core/core_timing.h"
+#include "core/guest_profiler.h"
+#include "core/settings.h"
+#include "core/arm/arm_interface.h"
+#include "core/hle/kernel/thread.h"
+
+namespace GuestProfiler {
+
+/// Guest time between two samples
+static const int SAMPLE_INTERVAL_US = 1000;
+
+/// Key of samples taken while no thread was running
+static const u64 IDLE_SAMPLE = ~0ull;
+
+static int sample_event;
+
+static std::mutex sample_mutex;
+/// Number of samples per (PC << 32 | LR)
+static std::unordered_map<u64, u64> samples;
+static u64 total_samples;
+static bool running;
+static bool event_scheduled;
+
+static void SampleCallback(u64, int cycles_late) {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    if (!running) {
+        event_scheduled = false;
+        return;
+    }
+
+    if (Kernel::GetCurrentThread() == nullptr) {
+        ++samples[IDLE_SAMPLE];
+    } else {
+        // The Thumb bit of LR is dropped, so that it compares equal to the address of the caller
+        const u64 pc = Core::g_app_core->GetPC();
+        const u64 lr = Core::g_app_core->GetReg(14) & ~1u;
+        ++samples[pc << 32 | lr];
+    }
+    ++total_samples;
+
+    CoreTiming::ScheduleEvent(usToCycles(SAMPLE_INTERVAL_US) - cycles_late, sample_event);
+}
+
+/// Resolves an address to the function containing it
+static Function Symbolize(u32 address) {
+    const TSymbol symbol = Symbols::GetSymbolContaining(address);
+    if (symbol.name.empty())
+        return { address, Common::StringFromFormat("0x%08X", address), 0 };
+
+    return { symbol.address, symbol.name, 0 };
+}
+
+void Init() {
+    sample_event = CoreTiming::RegisterEvent("GuestProfiler::SampleCallback", SampleCallback);
+
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    samples.clear();
+    total_samples = 0;
+    running = false;
+    event_scheduled = false;
+
+    if (Settings::values.use_guest_profiler) {
+        running = true;
+        event_scheduled = true;
+        CoreTiming::ScheduleEvent(usToCycles(SAMPLE_INTERVAL_US), sample_event);
+    }
+}
+
+void Shutdown() {
+    if (Settings::values.use_guest_profiler && GetTotalSamples() != 0) {
+        const std::string path = FileUtil::GetUserPath(D_LOGS_IDX) + GUEST_PROFILE;
+        if (WriteCollapsedStacks(path))
+            LOG_INFO(Core, "Wrote %llu guest profile samples to %s",
+                     static_cast<unsigned long long>(GetTotalSamples()), path.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    CoreTiming::UnscheduleEvent(sample_event, 0);
+    running = false;
+    event_scheduled = false;
+}
+
+void Start() {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    running = true;
+    // The previous event may still be pending if sampling was stopped only recently
+    if (!event_scheduled) {
+        event_scheduled = true;
+        CoreTiming::ScheduleEvent_Threadsafe(usToCycles(SAMPLE_INTERVAL_US), sample_event);
+    }
+}
+
+void Stop() {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    running = false;
+}
+
+bool IsRunning() {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    return running;
+}
+
+void Clear() {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    samples.clear();
+    total_samples = 0;
+}
+
+u64 GetTotalSamples() {
+    std::lock_guard<std::mutex> lock(sample_mutex);
+    return total_samples;
+}
+
+std::vector<Function> GetHotFunctions() {
+    std::unordered_map<u64, u64> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        snapshot = samples;
+    }
+
+    std::map<u32, Function> functions;
+    for (const auto& sample : snapshot) {
+        if (sample.first == IDLE_SAMPLE)
+            continue;
+
+        const Function function = Symbolize(static_cast<u32>(sample.first >> 32));
+        auto inserted = functions.emplace(function.address, function);
+        inserted.first->second.samples += sample.second;
+    }
+
+    std::vector<Function> result;
+    result.reserve(functions.size());
+    for (auto& function : functions)
+        result.push_back(std::move(function.second));
+
+    std::sort(result.begin(), result.end(), [](const Function& a, const Function& b) {
+        return a.samples > b.samples;
+    });
+    return result;
+}
+
+bool WriteCollapsedStacks(const std::string& filename) {
+    std::unordered_map<u64, u64> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(sample_mutex);
+        snapshot = samples;
+    }
+
+    // Samples with different addresses in the same functions fold into a single stack
+    std::map<std::string, u64> stacks;
+    for (const auto& sample : snapshot) {
+        if (sample.first == IDLE_SAMPLE) {
+            stacks["[idle]"] += sample.second;
+            continue;
+        }
+
+        const Function callee = Symbolize(static_cast<u32>(sample.first >> 32));
+        const Function caller = Symbolize(static_cast<u32>(sample.first));
+        // LR pointing into the sampled function means it is stale or the function is recursive,
+        // either way the caller is unknown
+        if (caller.address == callee.address || static_cast<u32>(sample.first) == 0)
+            stacks[callee.name] += sample.second;
+        else
+            stacks[caller.name + ';' + callee.name] += sample.second;
+    }
+
+    FileUtil::IOFile file(filename, "w");
+    if (!file.IsOpen()) {
+        LOG_ERROR(Core, "Failed to open %s", filename.c_str());
+        return false;
+    }
+
+    for (const auto& stack : stacks) {
+        const std::string line = Common::StringFromFormat("%s %llu\n", stack.first.c_str(),
+                                                          static_cast<unsigned long long>(stack.second));
+        if (file.WriteBytes(line.data(), line.size()) != line.size()) {
+            LOG_ERROR(Core, "Failed to write %s", filename.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
@@ -0,0 +1,60 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/common_types.h"
+
+/**
+ * Sampling profiler for guest code. A CoreTiming event periodically records the PC and LR of the
+ * application core, so samples are spread over guest time rather than host time. Samples are
+ * symbolized through the symbol table (ELF symbols or a loaded symbol map) when reported.
+ *
+ * LR is used as an approximation of the caller: it is exact on function entry and in leaf
+ * functions, but may be stale in functions that saved it and called others.
+ */
+namespace GuestProfiler {
+
+/// Samples aggregated per guest function
+struct Function {
+    u32 address;      ///< Start of the symbol, or the sampled address if there is no symbol
+    std::string name; ///< Symbol name, or the address formatted as hex
+    u64 samples;
+};
+
+/// Registers the sampling event, and starts sampling if enabled in the settings
+void Init();
+
+/// Stops sampling. If sampling was enabled in the settings, writes the collapsed stacks to the
+/// logs directory first.
+void Shutdown();
+
+/// Starts recording samples, may be called from any thread
+void Start();
+
+/// Stops recording samples, keeping those already recorded
+void Stop();
+
+bool IsRunning();
+
+/// Discards all recorded samples
+void Clear();
+
+/// Returns the number of samples recorded, including those taken while the CPU was idle
+u64 GetTotalSamples();
+
+/// Returns the sampled functions, ordered from the hottest
+std::vector<Function> GetHotFunctions();
+
+/**
+ * Writes the samples in the collapsed stack format ("caller;callee count" per line) understood by
+ * flamegraph.pl and similar tools
+ * @return False if the file couldn't be written
+ */
+bool WriteCollapsedStacks(const std::string& filename);
+
+} // namespace
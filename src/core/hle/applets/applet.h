@@ -6,6 +6,7 @@
 
 #include <memory>
 
+#include "core/hle/kernel/vm_manager.h"
 #include "core/hle/result.h"
 #include "core/hle/service/apt/apt.h"
 
@@ -65,7 +66,7 @@ protected:
     virtual ResultCode StartImpl(const Service::APT::AppletStartupParameter& parameter) = 0;
 
     Service::APT::AppletId id; ///< Id of this Applet
-    std::shared_ptr<std::vector<u8>> heap_memory; ///< Heap memory for this Applet
+    std::shared_ptr<Kernel::MemoryBlock> heap_memory; ///< Heap memory for this Applet
 };
 
 //Return the registered applet count
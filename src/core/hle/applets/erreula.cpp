@@ -28,7 +28,7 @@ ResultCode ErrEula::ReceiveParameter(const Service::APT::MessageParameter& param
     // TODO: allocated memory never released
     using Kernel::MemoryPermission;
     // Allocate a heap block of the required size for this applet.
-    heap_memory = std::make_shared<std::vector<u8>>(capture_info.size);
+    heap_memory = std::make_shared<Kernel::MemoryBlock>(capture_info.size);
     // Create a SharedMemory that directly points to this heap block.
     framebuffer_memory = Kernel::SharedMemory::CreateForApplet(heap_memory, 0, heap_memory->size(),
                                                                MemoryPermission::ReadWrite, MemoryPermission::ReadWrite,
@@ -13,6 +13,7 @@
 #include "common/common_types.h"
 #include "common/swap.h"
 
+#include "core/fastmem.h"
 #include "core/memory.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -49,8 +50,10 @@ struct ConfigMemDef {
 };
 static_assert(sizeof(ConfigMemDef) == Memory::CONFIG_MEMORY_SIZE, "Config Memory structure size is wrong");
 
-extern ConfigMemDef config_mem;
+/// Allocated in the fastmem backing pool, so that guest reads don't take the slow path
+extern Memory::Fastmem::BackingPtr<ConfigMemDef> config_mem;
 
 void Init();
+void Shutdown();
 
 } // namespace
@@ -153,6 +153,9 @@ void Shutdown() {
     Kernel::TimersShutdown();
     Kernel::ResourceLimitsShutdown();
     Kernel::MemoryShutdown();
+
+    SharedPage::Shutdown();
+    ConfigMem::Shutdown();
 }
 
 } // namespace
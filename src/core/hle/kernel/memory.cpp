@@ -12,6 +12,7 @@
 #include "common/common_types.h"
 #include "common/logging/log.h"
 
+#include "core/fastmem.h"
 #include "core/hle/config_mem.h"
 #include "core/hle/kernel/memory.h"
 #include "core/hle/kernel/vm_manager.h"
@@ -54,7 +55,7 @@ void MemoryInit(u32 mem_type) {
         memory_regions[i].base = base;
         memory_regions[i].size = memory_region_sizes[mem_type][i];
         memory_regions[i].used = 0;
-        memory_regions[i].linear_heap_memory = std::make_shared<std::vector<u8>>();
+        memory_regions[i].linear_heap_memory = std::make_shared<MemoryBlock>();
         // Reserve enough space for this region of FCRAM.
         // We do not want this block of memory to be relocated when allocating from it.
         memory_regions[i].linear_heap_memory->reserve(memory_regions[i].size);
@@ -66,12 +67,12 @@ void MemoryInit(u32 mem_type) {
     ASSERT(base == Memory::FCRAM_SIZE);
 
     using ConfigMem::config_mem;
-    config_mem.app_mem_type = mem_type;
+    config_mem->app_mem_type = mem_type;
     // app_mem_malloc does not always match the configured size for memory_region[0]: in case the
     // n3DS type override is in effect it reports the size the game expects, not the real one.
-    config_mem.app_mem_alloc = memory_region_sizes[mem_type][0];
-    config_mem.sys_mem_alloc = memory_regions[1].size;
-    config_mem.base_mem_alloc = memory_regions[2].size;
+    config_mem->app_mem_alloc = memory_region_sizes[mem_type][0];
+    config_mem->sys_mem_alloc = memory_regions[1].size;
+    config_mem->base_mem_alloc = memory_regions[2].size;
 }
 
 void MemoryShutdown() {
@@ -116,6 +117,7 @@ static MemoryArea memory_areas[] = {
 }
 
 void Init() {
+    Fastmem::Init();
     InitMemoryMap();
     LOG_DEBUG(HW_Memory, "initialized OK");
 }
@@ -124,16 +126,16 @@ void InitLegacyAddressSpace(Kernel::VMManager& address_space) {
     using namespace Kernel;
 
     for (MemoryArea& area : memory_areas) {
-        auto block = std::make_shared<std::vector<u8>>(area.size);
+        auto block = std::make_shared<MemoryBlock>(area.size);
         address_space.MapMemoryBlock(area.base, std::move(block), 0, area.size, MemoryState::Private).Unwrap();
     }
 
     auto cfg_mem_vma = address_space.MapBackingMemory(CONFIG_MEMORY_VADDR,
-            (u8*)&ConfigMem::config_mem, CONFIG_MEMORY_SIZE, MemoryState::Shared).MoveFrom();
+            (u8*)ConfigMem::config_mem.get(), CONFIG_MEMORY_SIZE, MemoryState::Shared).MoveFrom();
     address_space.Reprotect(cfg_mem_vma, VMAPermission::Read);
 
     auto shared_page_vma = address_space.MapBackingMemory(SHARED_PAGE_VADDR,
-            (u8*)&SharedPage::shared_page, SHARED_PAGE_SIZE, MemoryState::Shared).MoveFrom();
+            (u8*)SharedPage::shared_page.get(), SHARED_PAGE_SIZE, MemoryState::Shared).MoveFrom();
     address_space.Reprotect(shared_page_vma, VMAPermission::Read);
 
     AudioCore::AddAddressSpace(address_space);
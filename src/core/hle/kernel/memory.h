@@ -19,7 +19,7 @@ struct MemoryRegionInfo {
     u32 size;
     u32 used;
 
-    std::shared_ptr<std::vector<u8>> linear_heap_memory;
+    std::shared_ptr<MemoryBlock> linear_heap_memory;
 };
 
 void MemoryInit(u32 mem_type);
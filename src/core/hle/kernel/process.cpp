@@ -122,7 +122,7 @@ void Process::Run(s32 main_thread_priority, u32 stack_size) {
 
     // Allocate and map stack
     vm_manager.MapMemoryBlock(Memory::HEAP_VADDR_END - stack_size,
-            std::make_shared<std::vector<u8>>(stack_size, 0), 0, stack_size, MemoryState::Locked
+            std::make_shared<MemoryBlock>(stack_size, 0), 0, stack_size, MemoryState::Locked
             ).Unwrap();
     misc_memory_used += stack_size;
     memory_region->used += stack_size;
@@ -149,7 +149,7 @@ ResultVal<VAddr> Process::HeapAllocate(VAddr target, u32 size, VMAPermission per
 
     if (heap_memory == nullptr) {
         // Initialize heap
-        heap_memory = std::make_shared<std::vector<u8>>();
+        heap_memory = std::make_shared<MemoryBlock>();
         heap_start = heap_end = target;
     }
 
@@ -65,7 +65,7 @@ struct CodeSet final : public Object {
     /// Title ID corresponding to the process
     u64 program_id;
 
-    std::shared_ptr<std::vector<u8>> memory;
+    std::shared_ptr<MemoryBlock> memory;
 
     struct Segment {
         size_t offset = 0;
@@ -134,7 +134,7 @@ public:
     // the entire virtual address space extents that bound the allocations, including any holes.
     // This makes deallocation and reallocation of holes fast and keeps process memory contiguous
     // in the emulator address space, allowing Memory::GetPointer to be reasonably safe.
-    std::shared_ptr<std::vector<u8>> heap_memory;
+    std::shared_ptr<MemoryBlock> heap_memory;
     // The left/right bounds of the address space covered by heap_memory.
     VAddr heap_start = 0, heap_end = 0;
 
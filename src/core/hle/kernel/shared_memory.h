@@ -51,7 +51,7 @@ public:
      * @param other_permissions Permission restrictions applied to other processes mapping the block.
      * @param name Optional object name, used for debugging purposes.
      */
-    static SharedPtr<SharedMemory> CreateForApplet(std::shared_ptr<std::vector<u8>> heap_block, u32 offset, u32 size,
+    static SharedPtr<SharedMemory> CreateForApplet(std::shared_ptr<MemoryBlock> heap_block, u32 offset, u32 size,
                                                    MemoryPermission permissions, MemoryPermission other_permissions, std::string name = "Unknown Applet");
 
     std::string GetTypeName() const override { return "SharedMemory"; }
@@ -97,7 +97,7 @@ public:
     /// Physical address of the shared memory block in the linear heap if no address was specified during creation.
     PAddr linear_heap_phys_address;
     /// Backing memory for this shared memory block.
-    std::shared_ptr<std::vector<u8>> backing_block;
+    std::shared_ptr<MemoryBlock> backing_block;
     /// Offset into the backing block for this shared memory.
     u32 backing_block_offset;
     /// Size of the memory block. Page-aligned.
@@ -6,6 +6,8 @@
 
 #include "common/assert.h"
 
+#include "core/arm/arm_interface.h"
+#include "core/core.h"
 #include "core/hle/kernel/vm_manager.h"
 #include "core/memory.h"
 #include "core/memory_setup.h"
@@ -70,7 +72,7 @@ VMManager::VMAHandle VMManager::FindVMA(VAddr target) const {
 }
 
 ResultVal<VMManager::VMAHandle> VMManager::MapMemoryBlock(VAddr target,
-        std::shared_ptr<std::vector<u8>> block, size_t offset, u32 size, MemoryState state) {
+        std::shared_ptr<MemoryBlock> block, size_t offset, u32 size, MemoryState state) {
     ASSERT(block != nullptr);
     ASSERT(offset + size <= block->size());
 
@@ -168,16 +170,23 @@ ResultCode VMManager::ReprotectRange(VAddr target, u32 size, VMAPermission new_p
     VAddr target_end = target + size;
 
     VMAIter end = vma_map.end();
+    bool changed = false;
     // The comparison against the end of the range must be done using addresses since VMAs can be
     // merged during this process, causing invalidation of the iterators.
     while (vma != end && vma->second.base < target_end) {
+        changed |= vma->second.permissions != new_perms;
         vma = std::next(StripIterConstness(Reprotect(vma, new_perms)));
     }
 
+    // The JIT may rely on the previous permissions, e.g. by folding reads from read-only memory
+    if (changed && Core::g_app_core != nullptr) {
+        Core::g_app_core->InvalidateCacheRange(target, size);
+    }
+
     return RESULT_SUCCESS;
 }
 
-void VMManager::RefreshMemoryBlockMappings(const std::vector<u8>* block) {
+void VMManager::RefreshMemoryBlockMappings(const MemoryBlock* block) {
     // If this ever proves to have a noticeable performance impact, allow users of the function to
     // specify a specific range of addresses to limit the scan to.
     for (const auto& p : vma_map) {
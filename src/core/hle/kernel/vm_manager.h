@@ -10,11 +10,15 @@
 
 #include "common/common_types.h"
 
+#include "core/fastmem.h"
 #include "core/hle/result.h"
 #include "core/mmio.h"
 
 namespace Kernel {
 
+/// Host memory backing guest pages, allocated such that it can be mirrored into the fastmem arena
+using MemoryBlock = std::vector<u8, Memory::Fastmem::BackingAllocator<u8>>;
+
 const ResultCode ERR_INVALID_ADDRESS{ // 0xE0E01BF5
         ErrorDescription::InvalidAddress, ErrorModule::OS,
         ErrorSummary::InvalidArgument, ErrorLevel::Usage};
@@ -82,7 +86,7 @@ struct VirtualMemoryArea {
 
     // Settings for type = AllocatedMemoryBlock
     /// Memory block backing this VMA.
-    std::shared_ptr<std::vector<u8>> backing_block = nullptr;
+    std::shared_ptr<MemoryBlock> backing_block = nullptr;
     /// Offset into the backing_memory the mapping starts from.
     size_t offset = 0;
 
@@ -150,7 +154,7 @@ public:
      * @param size Size of the mapping.
      * @param state MemoryState tag to attach to the VMA.
      */
-    ResultVal<VMAHandle> MapMemoryBlock(VAddr target, std::shared_ptr<std::vector<u8>> block,
+    ResultVal<VMAHandle> MapMemoryBlock(VAddr target, std::shared_ptr<MemoryBlock> block,
             size_t offset, u32 size, MemoryState state);
 
     /**
@@ -187,7 +191,7 @@ public:
      * Scans all VMAs and updates the page table range of any that use the given vector as backing
      * memory. This should be called after any operation that causes reallocation of the vector.
      */
-    void RefreshMemoryBlockMappings(const std::vector<u8>* block);
+    void RefreshMemoryBlockMappings(const MemoryBlock* block);
 
     /// Dumps the address space layout to the log, for debugging
     void LogLayout(Log::Level log_level) const;
@@ -887,11 +887,11 @@ void IsStandardMemoryLayout(Service::Interface* self) {
     using ConfigMem::config_mem;
 
     if (is_new_3ds) {
-        if (config_mem.app_mem_type != 7) { // 7 for 178MB mode.
+        if (config_mem->app_mem_type != 7) { // 7 for 178MB mode.
             is_standard_memory_layout = 1;
         }
     } else {
-        if (config_mem.app_mem_type == 0) { // 0 for 64MB mode
+        if (config_mem->app_mem_type == 0) { // 0 for 64MB mode
             is_standard_memory_layout = 1;
         }
     }
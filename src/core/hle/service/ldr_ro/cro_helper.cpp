@@ -2,10 +2,14 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <set>
+
 #include "common/alignment.h"
 #include "common/logging/log.h"
 #include "common/scope_exit.h"
 
+#include "core/arm/arm_interface.h"
+#include "core/core.h"
 #include "core/hle/service/ldr_ro/cro_helper.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +51,23 @@ const std::array<CROHelper::HeaderField, 4> CROHelper::FIX_BARRIERS {{
     Fix3Barrier
 }};
 
+/// Pages written by relocations, see CROHelper::InvalidatePatchedCode
+static std::set<VAddr> patched_pages;
+
+void CROHelper::InvalidatePatchedCode() {
+    // Merge consecutive pages into a single range
+    auto page = patched_pages.begin();
+    while (page != patched_pages.end()) {
+        const VAddr start = *page;
+        VAddr end = start + Memory::PAGE_SIZE;
+        while (++page != patched_pages.end() && *page == end)
+            end += Memory::PAGE_SIZE;
+
+        Core::g_app_core->InvalidateCacheRange(start, end - start);
+    }
+    patched_pages.clear();
+}
+
 VAddr CROHelper::SegmentTagToAddress(SegmentTag segment_tag) const {
     u32 segment_num = GetField(SegmentNum);
 
@@ -65,6 +86,7 @@ VAddr CROHelper::SegmentTagToAddress(SegmentTag segment_tag) const {
 ResultCode CROHelper::ApplyRelocation(VAddr target_address, RelocationType relocation_type,
     u32 addend, u32 symbol_address, u32 target_future_address) {
 
+    patched_pages.insert(target_address & ~Memory::PAGE_MASK);
     switch (relocation_type) {
     case RelocationType::Nothing:
         break;
@@ -89,6 +111,7 @@ ResultCode CROHelper::ApplyRelocation(VAddr target_address, RelocationType reloc
 }
 
 ResultCode CROHelper::ClearRelocation(VAddr target_address, RelocationType relocation_type) {
+    patched_pages.insert(target_address & ~Memory::PAGE_MASK);
     switch (relocation_type) {
     case RelocationType::Nothing:
         break;
@@ -144,6 +144,12 @@ public:
      */
     std::tuple<VAddr, u32> GetExecutablePages() const;
 
+    /**
+     * Invalidates the translated code of the pages patched by relocations since the last call.
+     * Relocations may target any loaded module, including the static one.
+     */
+    static void InvalidatePatchedCode();
+
 private:
     const VAddr module_address; ///< the virtual address of this module
 
@@ -129,7 +129,7 @@ static void Initialize(Service::Interface* self) {
 
     if (crs_buffer_ptr != crs_address) {
         // TODO(wwylele): should be memory aliasing
-        std::shared_ptr<std::vector<u8>> crs_mem = std::make_shared<std::vector<u8>>(crs_size);
+        std::shared_ptr<Kernel::MemoryBlock> crs_mem = std::make_shared<Kernel::MemoryBlock>(crs_size);
         Memory::ReadBlock(crs_buffer_ptr, crs_mem->data(), crs_size);
         result = Kernel::g_current_process->vm_manager.MapMemoryBlock(crs_address, crs_mem, 0, crs_size, Kernel::MemoryState::Code).Code();
         if (result.IsError()) {
@@ -165,6 +165,7 @@ static void Initialize(Service::Interface* self) {
     }
 
     memory_synchronizer.SynchronizeOriginalMemory();
+    CROHelper::InvalidatePatchedCode();
 
     loaded_crs = crs_address;
 
@@ -347,7 +348,7 @@ static void LoadCRO(Service::Interface* self, bool link_on_load_bug_fix) {
 
     if (cro_buffer_ptr != cro_address) {
         // TODO(wwylele): should be memory aliasing
-        std::shared_ptr<std::vector<u8>> cro_mem = std::make_shared<std::vector<u8>>(cro_size);
+        std::shared_ptr<Kernel::MemoryBlock> cro_mem = std::make_shared<Kernel::MemoryBlock>(cro_size);
         Memory::ReadBlock(cro_buffer_ptr, cro_mem->data(), cro_size);
         result = Kernel::g_current_process->vm_manager.MapMemoryBlock(cro_address, cro_mem, 0, cro_size, Kernel::MemoryState::Code).Code();
         if (result.IsError()) {
@@ -435,7 +436,9 @@ static void LoadCRO(Service::Interface* self, bool link_on_load_bug_fix) {
         }
     }
 
-    Core::g_app_core->ClearInstructionCache();
+    // The module may be mapped where the code of an unloaded one used to be
+    Core::g_app_core->InvalidateCacheRange(cro_address, cro_size);
+    CROHelper::InvalidatePatchedCode();
 
     LOG_INFO(Service_LDR, "CRO \"%s\" loaded at 0x%08X, fixed_end=0x%08X",
         cro.ModuleName().data(), cro_address, cro_address+fix_size);
@@ -539,7 +542,8 @@ static void UnloadCRO(Service::Interface* self) {
         memory_synchronizer.RemoveMemoryBlock(cro_address, cro_buffer_ptr);
     }
 
-    Core::g_app_core->ClearInstructionCache();
+    Core::g_app_core->InvalidateCacheRange(cro_address, fixed_size);
+    CROHelper::InvalidatePatchedCode();
 
     cmd_buff[1] = result.raw;
 }
@@ -601,7 +605,7 @@ static void LinkCRO(Service::Interface* self) {
     }
 
     memory_synchronizer.SynchronizeOriginalMemory();
-    Core::g_app_core->ClearInstructionCache();
+    CROHelper::InvalidatePatchedCode();
 
     cmd_buff[1] = result.raw;
 }
@@ -663,7 +667,7 @@ static void UnlinkCRO(Service::Interface* self) {
     }
 
     memory_synchronizer.SynchronizeOriginalMemory();
-    Core::g_app_core->ClearInstructionCache();
+    CROHelper::InvalidatePatchedCode();
 
     cmd_buff[1] = result.raw;
 }
@@ -3,7 +3,6 @@
 // Refer to the license.txt file included.
 
 #include <chrono>
-#include <cstring>
 #include <ctime>
 
 #include "core/core_timing.h"
@@ -13,7 +12,7 @@
 
 namespace SharedPage {
 
-SharedPageDef shared_page;
+Memory::Fastmem::BackingPtr<SharedPageDef> shared_page;
 
 static int update_time_event;
 
@@ -52,30 +51,34 @@ static u64 GetSystemTime() {
 }
 
 static void UpdateTimeCallback(u64 userdata, int cycles_late) {
-    DateTime& date_time = shared_page.date_time_counter % 2 ?
-        shared_page.date_time_0 : shared_page.date_time_1;
+    DateTime& date_time = shared_page->date_time_counter % 2 ?
+        shared_page->date_time_0 : shared_page->date_time_1;
 
     date_time.date_time = GetSystemTime();
     date_time.update_tick = CoreTiming::GetTicks();
     date_time.tick_to_second_coefficient = g_clock_rate_arm11;
     date_time.tick_offset = 0;
 
-    ++shared_page.date_time_counter;
+    ++shared_page->date_time_counter;
 
     // system time is updated hourly
     CoreTiming::ScheduleEvent(msToCycles(60 * 60 * 1000) - cycles_late, update_time_event);
 }
 
 void Init() {
-    std::memset(&shared_page, 0, sizeof(shared_page));
+    shared_page = Memory::Fastmem::MakeBacking<SharedPageDef>();
 
-    shared_page.running_hw = 0x1; // product
+    shared_page->running_hw = 0x1; // product
 
     // Some games wait until this value becomes 0x1, before asking running_hw
-    shared_page.unknown_value = 0x1;
+    shared_page->unknown_value = 0x1;
 
     update_time_event = CoreTiming::RegisterEvent("SharedPage::UpdateTimeCallback", UpdateTimeCallback);
     CoreTiming::ScheduleEvent(0, update_time_event);
 }
 
+void Shutdown() {
+    shared_page = nullptr;
+}
+
 } // namespace
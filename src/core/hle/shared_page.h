@@ -14,6 +14,7 @@
 #include "common/common_types.h"
 #include "common/swap.h"
 
+#include "core/fastmem.h"
 #include "core/memory.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -54,8 +55,10 @@ struct SharedPageDef {
 };
 static_assert(sizeof(SharedPageDef) == Memory::SHARED_PAGE_SIZE, "Shared page structure size is wrong");
 
-extern SharedPageDef shared_page;
+/// Allocated in the fastmem backing pool, so that guest reads don't take the slow path
+extern Memory::Fastmem::BackingPtr<SharedPageDef> shared_page;
 
 void Init();
+void Shutdown();
 
 } // namespace
@@ -0,0 +1,653 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+#include "common/color.h"
+#include "common/common_types.h"
+#include "common/logging/log.h"
+#include "common/thread_pool.h"
+#include "common/vector_math.h"
+
+#include "core/hw/display_transfer.h"
+#include "core/hw/gpu.h"
+
+#include "video_core/utils.h"
+
+namespace HW {
+namespace DisplayTransfer {
+
+// Pixels are converted through 32-bit RGBA8 words, with red in the lowest byte. Images are
+// processed in bands of 8 rows, the height of a tile: first the input is decoded into a linear
+// buffer, then each output row is downscaled and flipped from that buffer and encoded. Since the
+// tiles of a band are stored contiguously, tiled images are converted as runs of pixels in memory
+// order, and only reordering the pixels of each tile depends on the layout. The kernels for each
+// step are looked up in tables once per transfer.
+
+using PixelFormat = GPU::Regs::PixelFormat;
+using Config = GPU::Regs::DisplayTransferConfig;
+
+static constexpr u32 TILE_SIZE = 8;
+static constexpr u32 PIXELS_PER_TILE = TILE_SIZE * TILE_SIZE;
+
+/// Transfers are only split across threads if each of them gets at least this many pixels
+static constexpr u32 MIN_PIXELS_PER_TASK = 16 * 1024;
+
+static std::unique_ptr<Common::ThreadPool> worker_pool;
+
+/// Linear image decoded from the input of the current transfer
+static std::vector<u32> decoded;
+
+/// Converts count pixels from memory to RGBA8 words
+using DecodeFunction = void (*)(const u8* src, u32* dest, size_t count);
+/// Converts count RGBA8 words to pixels in memory
+using EncodeFunction = void (*)(const u32* src, u8* dest, size_t count);
+/// Downscales two input rows (the second one is only used by ScaleXY) to count output pixels
+using ScaleFunction = void (*)(const u32* row0, const u32* row1, u32* dest, size_t count);
+
+static constexpr size_t BytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::RGBA8 ? 4 : format == PixelFormat::RGB8 ? 3 : 2;
+}
+
+/// Position (y * TILE_SIZE + x) of each pixel of a tile, indexed by its Morton offset
+static const std::array<u8, PIXELS_PER_TILE> morton_to_position = [] {
+    std::array<u8, PIXELS_PER_TILE> table;
+    for (u32 y = 0; y < TILE_SIZE; ++y) {
+        for (u32 x = 0; x < TILE_SIZE; ++x) {
+            table[VideoCore::MortonInterleave(x, y)] = static_cast<u8>(y * TILE_SIZE + x);
+        }
+    }
+    return table;
+}();
+
+static inline u32 PackRGBA(const Math::Vec4<u8>& color) {
+    return color.r() | color.g() << 8 | color.b() << 16 | static_cast<u32>(color.a()) << 24;
+}
+
+template <PixelFormat format>
+static u32 DecodePixel(const u8* src);
+
+template <>
+u32 DecodePixel<PixelFormat::RGBA8>(const u8* src) {
+    return src[3] | src[2] << 8 | src[1] << 16 | static_cast<u32>(src[0]) << 24;
+}
+
+template <>
+u32 DecodePixel<PixelFormat::RGB8>(const u8* src) {
+    return src[2] | src[1] << 8 | src[0] << 16 | 0xFF000000;
+}
+
+template <>
+u32 DecodePixel<PixelFormat::RGB565>(const u8* src) {
+    return PackRGBA(Color::DecodeRGB565(src));
+}
+
+template <>
+u32 DecodePixel<PixelFormat::RGB5A1>(const u8* src) {
+    return PackRGBA(Color::DecodeRGB5A1(src));
+}
+
+template <>
+u32 DecodePixel<PixelFormat::RGBA4>(const u8* src) {
+    return PackRGBA(Color::DecodeRGBA4(src));
+}
+
+// The encoders truncate the components like the Color::Encode* functions
+
+template <PixelFormat format>
+static void EncodePixel(u32 color, u8* dest);
+
+template <>
+void EncodePixel<PixelFormat::RGBA8>(u32 color, u8* dest) {
+    dest[0] = static_cast<u8>(color >> 24);
+    dest[1] = static_cast<u8>(color >> 16);
+    dest[2] = static_cast<u8>(color >> 8);
+    dest[3] = static_cast<u8>(color);
+}
+
+template <>
+void EncodePixel<PixelFormat::RGB8>(u32 color, u8* dest) {
+    dest[0] = static_cast<u8>(color >> 16);
+    dest[1] = static_cast<u8>(color >> 8);
+    dest[2] = static_cast<u8>(color);
+}
+
+template <>
+void EncodePixel<PixelFormat::RGB565>(u32 color, u8* dest) {
+    const u16 value = static_cast<u16>((color & 0xF8) << 8 | ((color >> 5) & 0x7E0) |
+                                       ((color >> 19) & 0x1F));
+    std::memcpy(dest, &value, sizeof(value));
+}
+
+template <>
+void EncodePixel<PixelFormat::RGB5A1>(u32 color, u8* dest) {
+    const u16 value = static_cast<u16>((color & 0xF8) << 8 | ((color >> 5) & 0x7C0) |
+                                       ((color >> 18) & 0x3E) | (color >> 31));
+    std::memcpy(dest, &value, sizeof(value));
+}
+
+template <>
+void EncodePixel<PixelFormat::RGBA4>(u32 color, u8* dest) {
+    const u16 value = static_cast<u16>((color & 0xF0) << 8 | ((color >> 4) & 0xF00) |
+                                       ((color >> 16) & 0xF0) | (color >> 28));
+    std::memcpy(dest, &value, sizeof(value));
+}
+
+/// Truncating average of each byte, as computed by the hardware box filter
+static inline u32 Average(u32 a, u32 b) {
+    return (a & b) + (((a ^ b) & 0xFEFEFEFE) >> 1);
+}
+
+static inline u32 Average(u32 a, u32 b, u32 c, u32 d) {
+    u32 result = 0;
+    for (unsigned shift = 0; shift < 32; shift += 8) {
+        const u32 sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) +
+                        ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= (sum / 4) << shift;
+    }
+    return result;
+}
+
+// The SIMD kernels return the number of pixels they processed, the scalar code handles the rest
+
+#ifdef ARCHITECTURE_x86_64
+
+template <PixelFormat format>
+static size_t DecodeSSE2(const u8* src, u32* dest, size_t count) {
+    return 0;
+}
+
+template <PixelFormat format>
+static size_t EncodeSSE2(const u32* src, u8* dest, size_t count) {
+    return 0;
+}
+
+static inline __m128i ReverseBytes32(__m128i value) {
+    value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+}
+
+template <>
+size_t DecodeSSE2<PixelFormat::RGBA8>(const u8* src, u32* dest, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), ReverseBytes32(pixels));
+    }
+    return i;
+}
+
+template <>
+size_t EncodeSSE2<PixelFormat::RGBA8>(const u32* src, u8* dest, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), ReverseBytes32(pixels));
+    }
+    return i;
+}
+
+static inline __m128i Expand5To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+static inline __m128i Expand4To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 4), value);
+}
+
+/// Decodes eight 16-bit pixels, given (r | g << 8) and (b | a << 8) of each in 16-bit lanes
+static inline void Store16BitPixels(__m128i rg, __m128i ba, u32* dest) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 4), _mm_unpackhi_epi16(rg, ba));
+}
+
+template <>
+size_t DecodeSSE2<PixelFormat::RGB565>(const u8* src, u32* dest, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        const __m128i r = Expand5To8(_mm_srli_epi16(pixels, 11));
+        const __m128i g6 = _mm_and_si128(_mm_srli_epi16(pixels, 5), _mm_set1_epi16(0x3F));
+        const __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+        const __m128i b = Expand5To8(_mm_and_si128(pixels, _mm_set1_epi16(0x1F)));
+        Store16BitPixels(_mm_or_si128(r, _mm_slli_epi16(g, 8)),
+                         _mm_or_si128(b, _mm_set1_epi16(static_cast<s16>(0xFF00))), dest + i);
+    }
+    return i;
+}
+
+template <>
+size_t DecodeSSE2<PixelFormat::RGB5A1>(const u8* src, u32* dest, size_t count) {
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        const __m128i r = Expand5To8(_mm_srli_epi16(pixels, 11));
+        const __m128i g = Expand5To8(_mm_and_si128(_mm_srli_epi16(pixels, 6), mask));
+        const __m128i b = Expand5To8(_mm_and_si128(_mm_srli_epi16(pixels, 1), mask));
+        // Broadcast the alpha bit to the whole lane
+        const __m128i a = _mm_srai_epi16(_mm_slli_epi16(pixels, 15), 15);
+        Store16BitPixels(_mm_or_si128(r, _mm_slli_epi16(g, 8)),
+                         _mm_or_si128(b, _mm_and_si128(a, _mm_set1_epi16(static_cast<s16>(0xFF00)))),
+                         dest + i);
+    }
+    return i;
+}
+
+template <>
+size_t DecodeSSE2<PixelFormat::RGBA4>(const u8* src, u32* dest, size_t count) {
+    const __m128i mask = _mm_set1_epi16(0xF);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        const __m128i r = Expand4To8(_mm_srli_epi16(pixels, 12));
+        const __m128i g = Expand4To8(_mm_and_si128(_mm_srli_epi16(pixels, 8), mask));
+        const __m128i b = Expand4To8(_mm_and_si128(_mm_srli_epi16(pixels, 4), mask));
+        const __m128i a = Expand4To8(_mm_and_si128(pixels, mask));
+        Store16BitPixels(_mm_or_si128(r, _mm_slli_epi16(g, 8)),
+                         _mm_or_si128(b, _mm_slli_epi16(a, 8)), dest + i);
+    }
+    return i;
+}
+
+/// Packs the lower 16 bits of each 32-bit lane of two registers into one register
+static inline __m128i Pack32To16(__m128i low, __m128i high) {
+    // Sign-extend the lower halves, so that the signed saturation of packs doesn't alter them
+    low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+    high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+    return _mm_packs_epi32(low, high);
+}
+
+/// Applies the same bit operations as EncodePixel to four pixels at a time
+template <PixelFormat format>
+static inline __m128i Encode16Bit(__m128i color);
+
+template <>
+inline __m128i Encode16Bit<PixelFormat::RGB565>(__m128i color) {
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(color, _mm_set1_epi32(0xF8)), 8);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(color, 5), _mm_set1_epi32(0x7E0));
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(color, 19), _mm_set1_epi32(0x1F));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+template <>
+inline __m128i Encode16Bit<PixelFormat::RGB5A1>(__m128i color) {
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(color, _mm_set1_epi32(0xF8)), 8);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(color, 5), _mm_set1_epi32(0x7C0));
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(color, 18), _mm_set1_epi32(0x3E));
+    const __m128i a = _mm_srli_epi32(color, 31);
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+}
+
+template <>
+inline __m128i Encode16Bit<PixelFormat::RGBA4>(__m128i color) {
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(color, _mm_set1_epi32(0xF0)), 8);
+    const __m128i g = _mm_and_si128(_mm_srli_epi32(color, 4), _mm_set1_epi32(0xF00));
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(color, 16), _mm_set1_epi32(0xF0));
+    const __m128i a = _mm_srli_epi32(color, 28);
+    return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, a));
+}
+
+template <PixelFormat format>
+static size_t Encode16BitSSE2(const u32* src, u8* dest, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 2),
+                         Pack32To16(Encode16Bit<format>(low), Encode16Bit<format>(high)));
+    }
+    return i;
+}
+
+template <>
+size_t EncodeSSE2<PixelFormat::RGB565>(const u32* src, u8* dest, size_t count) {
+    return Encode16BitSSE2<PixelFormat::RGB565>(src, dest, count);
+}
+
+template <>
+size_t EncodeSSE2<PixelFormat::RGB5A1>(const u32* src, u8* dest, size_t count) {
+    return Encode16BitSSE2<PixelFormat::RGB5A1>(src, dest, count);
+}
+
+template <>
+size_t EncodeSSE2<PixelFormat::RGBA4>(const u32* src, u8* dest, size_t count) {
+    return Encode16BitSSE2<PixelFormat::RGBA4>(src, dest, count);
+}
+
+/// Splits eight consecutive pixels into the even and the odd ones
+static inline void SplitEvenOdd(const u32* src, __m128i& even, __m128i& odd) {
+    const __m128i low = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)),
+                                          _MM_SHUFFLE(3, 1, 2, 0));
+    const __m128i high = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4)),
+                                           _MM_SHUFFLE(3, 1, 2, 0));
+    even = _mm_unpacklo_epi64(low, high);
+    odd = _mm_unpackhi_epi64(low, high);
+}
+
+static size_t ScaleXSSE2(const u32* row0, const u32* row1, u32* dest, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i even, odd;
+        SplitEvenOdd(row0 + i * 2, even, odd);
+        const __m128i half_difference = _mm_srli_epi16(
+            _mm_and_si128(_mm_xor_si128(even, odd), _mm_set1_epi8(static_cast<s8>(0xFE))), 1);
+        const __m128i average = _mm_add_epi8(_mm_and_si128(even, odd), half_difference);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), average);
+    }
+    return i;
+}
+
+static size_t ScaleXYSSE2(const u32* row0, const u32* row1, u32* dest, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i even0, odd0, even1, odd1;
+        SplitEvenOdd(row0 + i * 2, even0, odd0);
+        SplitEvenOdd(row1 + i * 2, even1, odd1);
+
+        // Sum the components in 16-bit lanes, which can't overflow
+        const __m128i sum_low = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpacklo_epi8(even0, zero), _mm_unpacklo_epi8(odd0, zero)),
+            _mm_add_epi16(_mm_unpacklo_epi8(even1, zero), _mm_unpacklo_epi8(odd1, zero)));
+        const __m128i sum_high = _mm_add_epi16(
+            _mm_add_epi16(_mm_unpackhi_epi8(even0, zero), _mm_unpackhi_epi8(odd0, zero)),
+            _mm_add_epi16(_mm_unpackhi_epi8(even1, zero), _mm_unpackhi_epi8(odd1, zero)));
+        const __m128i average = _mm_packus_epi16(_mm_srli_epi16(sum_low, 2), _mm_srli_epi16(sum_high, 2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), average);
+    }
+    return i;
+}
+
+#endif // ARCHITECTURE_x86_64
+
+template <PixelFormat format>
+static void DecodeRun(const u8* src, u32* dest, size_t count) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    i = DecodeSSE2<format>(src, dest, count);
+#endif
+    for (; i < count; ++i)
+        dest[i] = DecodePixel<format>(src + i * BytesPerPixel(format));
+}
+
+template <PixelFormat format>
+static void EncodeRun(const u32* src, u8* dest, size_t count) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    i = EncodeSSE2<format>(src, dest, count);
+#endif
+    for (; i < count; ++i)
+        EncodePixel<format>(src[i], dest + i * BytesPerPixel(format));
+}
+
+static void ScaleX(const u32* row0, const u32* row1, u32* dest, size_t count) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    i = ScaleXSSE2(row0, row1, dest, count);
+#endif
+    for (; i < count; ++i)
+        dest[i] = Average(row0[i * 2], row0[i * 2 + 1]);
+}
+
+static void ScaleXY(const u32* row0, const u32* row1, u32* dest, size_t count) {
+    size_t i = 0;
+#ifdef ARCHITECTURE_x86_64
+    i = ScaleXYSSE2(row0, row1, dest, count);
+#endif
+    for (; i < count; ++i)
+        dest[i] = Average(row0[i * 2], row0[i * 2 + 1], row1[i * 2], row1[i * 2 + 1]);
+}
+
+/// Kernels indexed by PixelFormat
+static const std::array<DecodeFunction, 5> decoders = {{
+    DecodeRun<PixelFormat::RGBA8>, DecodeRun<PixelFormat::RGB8>, DecodeRun<PixelFormat::RGB565>,
+    DecodeRun<PixelFormat::RGB5A1>, DecodeRun<PixelFormat::RGBA4>
+}};
+
+static const std::array<EncodeFunction, 5> encoders = {{
+    EncodeRun<PixelFormat::RGBA8>, EncodeRun<PixelFormat::RGB8>, EncodeRun<PixelFormat::RGB565>,
+    EncodeRun<PixelFormat::RGB5A1>, EncodeRun<PixelFormat::RGBA4>
+}};
+
+/// Kernels indexed by Config::ScalingMode
+static const std::array<ScaleFunction, 3> scalers = {{ nullptr, ScaleX, ScaleXY }};
+
+/**
+ * Reorders the pixels of consecutive tiles from Morton order into 8 rows
+ * @param tiles Pixels of the tiles, in memory order
+ * @param rows First of the 8 rows, each at least num_tiles * TILE_SIZE pixels wide
+ * @param stride Distance between the rows, in pixels
+ */
+static void UntileBand(const u32* tiles, u32* rows, size_t stride, u32 num_tiles) {
+    for (u32 tile = 0; tile < num_tiles; ++tile, tiles += PIXELS_PER_TILE, rows += TILE_SIZE) {
+#ifdef ARCHITECTURE_x86_64
+        // Each register holds a 2x2 block, two horizontally adjacent ones make up two rows
+        for (u32 subtile = 0; subtile < 4; ++subtile) {
+            const __m128i* src = reinterpret_cast<const __m128i*>(tiles + subtile * 16);
+            u32* dest = rows + (subtile / 2) * 4 * stride + (subtile % 2) * 4;
+            for (u32 pair = 0; pair < 2; ++pair, src += 2, dest += 2 * stride) {
+                const __m128i left = _mm_loadu_si128(src);
+                const __m128i right = _mm_loadu_si128(src + 1);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi64(left, right));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + stride), _mm_unpackhi_epi64(left, right));
+            }
+        }
+#else
+        for (u32 i = 0; i < PIXELS_PER_TILE; ++i) {
+            const u32 position = morton_to_position[i];
+            rows[(position / TILE_SIZE) * stride + position % TILE_SIZE] = tiles[i];
+        }
+#endif
+    }
+}
+
+/**
+ * Reorders 8 rows of pixels into consecutive tiles in Morton order, the inverse of UntileBand
+ * @param rows Pointers to the 8 rows, each at least num_tiles * TILE_SIZE pixels wide
+ * @param tiles Pixels of the tiles, in memory order
+ */
+static void TileBand(const std::array<const u32*, TILE_SIZE>& rows, u32* tiles, u32 num_tiles) {
+    for (u32 tile = 0; tile < num_tiles; ++tile, tiles += PIXELS_PER_TILE) {
+        const u32 x = tile * TILE_SIZE;
+#ifdef ARCHITECTURE_x86_64
+        for (u32 subtile = 0; subtile < 4; ++subtile) {
+            __m128i* dest = reinterpret_cast<__m128i*>(tiles + subtile * 16);
+            const u32 subtile_x = x + (subtile % 2) * 4;
+            for (u32 pair = 0; pair < 2; ++pair, dest += 2) {
+                const u32 y = (subtile / 2) * 4 + pair * 2;
+                const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[y] + subtile_x));
+                const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[y + 1] + subtile_x));
+                _mm_storeu_si128(dest, _mm_unpacklo_epi64(top, bottom));
+                _mm_storeu_si128(dest + 1, _mm_unpackhi_epi64(top, bottom));
+            }
+        }
+#else
+        for (u32 i = 0; i < PIXELS_PER_TILE; ++i) {
+            const u32 position = morton_to_position[i];
+            tiles[i] = rows[position / TILE_SIZE][x + position % TILE_SIZE];
+        }
+#endif
+    }
+}
+
+/// Calls function(first_band, last_band) to process all bands, split across the worker threads
+/// if the transfer is large enough
+template <typename Function>
+static void ForEachBand(u32 num_bands, u32 pixels_per_band, const Function& function) {
+    size_t num_tasks = 1;
+    if (worker_pool != nullptr) {
+        num_tasks = std::min<size_t>(worker_pool->NumThreads(),
+                                     num_bands * pixels_per_band / MIN_PIXELS_PER_TASK);
+    }
+
+    if (num_tasks <= 1) {
+        function(0, num_bands);
+        return;
+    }
+
+    for (size_t task = 0; task < num_tasks; ++task) {
+        const u32 first_band = static_cast<u32>(num_bands * task / num_tasks);
+        const u32 last_band = static_cast<u32>(num_bands * (task + 1) / num_tasks);
+        worker_pool->Push([&function, first_band, last_band] { function(first_band, last_band); });
+    }
+    worker_pool->WaitForIdle();
+}
+
+void PerformDisplayTransfer(const Config& config, const u8* src, u8* dst) {
+    const size_t input_format = static_cast<size_t>(config.input_format.Value());
+    const size_t output_format = static_cast<size_t>(config.output_format.Value());
+    if (input_format >= decoders.size() || output_format >= encoders.size()) {
+        LOG_ERROR(HW_GPU, "Unknown display transfer formats %zu -> %zu", input_format, output_format);
+        return;
+    }
+
+    const DecodeFunction decode = decoders[input_format];
+    const EncodeFunction encode = encoders[output_format];
+    const ScaleFunction scale = scalers[config.scaling];
+    const size_t input_bytes_per_pixel = BytesPerPixel(config.input_format);
+    const size_t output_bytes_per_pixel = BytesPerPixel(config.output_format);
+
+    const u32 horizontal_scale = config.scaling != Config::NoScale ? 1 : 0;
+    const u32 vertical_scale = config.scaling == Config::ScaleXY ? 1 : 0;
+    const u32 output_width = config.output_width >> horizontal_scale;
+    const u32 output_height = config.output_height >> vertical_scale;
+    const size_t output_stride = output_width * output_bytes_per_pixel;
+
+    // Only the part of the input covered by the output is decoded
+    const u32 input_width = output_width << horizontal_scale;
+    const u32 input_height = output_height << vertical_scale;
+    const size_t input_stride = config.input_width * input_bytes_per_pixel;
+
+    const bool input_tiled = !config.input_linear;
+    const bool output_tiled = config.input_linear != config.dont_swizzle;
+
+    const u32 decoded_stride = (input_width + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    const u32 input_bands = (input_height + TILE_SIZE - 1) / TILE_SIZE;
+    if (decoded.size() < decoded_stride * input_bands * TILE_SIZE)
+        decoded.resize(decoded_stride * input_bands * TILE_SIZE);
+
+    ForEachBand(input_bands, decoded_stride * TILE_SIZE, [&](u32 first_band, u32 last_band) {
+        std::vector<u32> tiles(input_tiled ? decoded_stride * TILE_SIZE : 0);
+        for (u32 band = first_band; band < last_band; ++band) {
+            const u8* band_src = src + band * TILE_SIZE * input_stride;
+            u32* rows = &decoded[band * TILE_SIZE * decoded_stride];
+            if (input_tiled) {
+                decode(band_src, tiles.data(), tiles.size());
+                UntileBand(tiles.data(), rows, decoded_stride, decoded_stride / TILE_SIZE);
+            } else {
+                const u32 num_rows = std::min(TILE_SIZE, input_height - band * TILE_SIZE);
+                for (u32 row = 0; row < num_rows; ++row)
+                    decode(band_src + row * input_stride, rows + row * decoded_stride, input_width);
+            }
+        }
+    });
+
+    const u32 output_bands = (output_height + TILE_SIZE - 1) / TILE_SIZE;
+    ForEachBand(output_bands, output_width * TILE_SIZE, [&](u32 first_band, u32 last_band) {
+        std::vector<u32> scaled(scale != nullptr ? output_width * TILE_SIZE : 0);
+        std::vector<u32> tiles(output_tiled ? output_width * TILE_SIZE : 0);
+        std::array<const u32*, TILE_SIZE> rows;
+
+        for (u32 band = first_band; band < last_band; ++band) {
+            const u32 first_row = band * TILE_SIZE;
+            const u32 num_rows = std::min(TILE_SIZE, output_height - first_row);
+
+            for (u32 row = 0; row < num_rows; ++row) {
+                const u32 y = first_row + row;
+                // Flipping is applied after the scaling, i.e. to output rows
+                const u32 source_row = (config.flip_vertically ? output_height - 1 - y : y) << vertical_scale;
+                const u32* line = &decoded[source_row * decoded_stride];
+                if (scale != nullptr) {
+                    u32* scaled_line = &scaled[row * output_width];
+                    scale(line, line + decoded_stride, scaled_line, output_width);
+                    line = scaled_line;
+                }
+                rows[row] = line;
+
+                if (!output_tiled)
+                    encode(line, dst + y * output_stride, output_width);
+            }
+
+            if (output_tiled) {
+                u8* band_dst = dst + first_row * output_stride;
+                const u32 full_tiles = num_rows == TILE_SIZE ? output_width / TILE_SIZE : 0;
+                TileBand(rows, tiles.data(), full_tiles);
+                encode(tiles.data(), band_dst, full_tiles * PIXELS_PER_TILE);
+
+                // Pixels of partial tiles are written one by one, leaving the rest of the tile
+                for (u32 row = 0; row < num_rows; ++row) {
+                    for (u32 x = full_tiles * TILE_SIZE; x < output_width; ++x) {
+                        encode(rows[row] + x,
+                               band_dst + VideoCore::GetMortonOffset(x, row, static_cast<u32>(output_bytes_per_pixel)), 1);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void PerformTextureCopy(const Config& config, const u8* src, u8* dst) {
+    u32 input_width = config.texture_copy.input_width * 16;
+    u32 input_gap = config.texture_copy.input_gap * 16;
+    u32 output_width = config.texture_copy.output_width * 16;
+    u32 output_gap = config.texture_copy.output_gap * 16;
+
+    if (input_width == 0) {
+        input_width = 1024 * 16;
+    }
+
+    if (output_width == 0) {
+        output_width = 1024 * 16;
+    }
+
+    u32 remaining_size = config.texture_copy.size;
+    u32 remaining_input = input_width;
+    u32 remaining_output = output_width;
+    while (remaining_size > 0) {
+        u32 copy_size = std::min({ remaining_input, remaining_output, remaining_size });
+
+        std::memcpy(dst, src, copy_size);
+        src += copy_size;
+        dst += copy_size;
+
+        remaining_input -= copy_size;
+        remaining_output -= copy_size;
+        remaining_size -= copy_size;
+
+        if (remaining_input == 0) {
+            remaining_input = input_width;
+            src += input_gap;
+        }
+        if (remaining_output == 0) {
+            remaining_output = output_width;
+            dst += output_gap;
+        }
+    }
+}
+
+void Init() {
+    const size_t num_threads = Common::ThreadPool::DefaultThreadCount();
+    if (num_threads > 1)
+        worker_pool = std::make_unique<Common::ThreadPool>(num_threads, "DisplayTransfer");
+}
+
+void Shutdown() {
+    worker_pool.reset();
+    decoded.clear();
+    decoded.shrink_to_fit();
+}
+
+} // namespace DisplayTransfer
+} // namespace HW
@@ -0,0 +1,40 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "core/hw/gpu.h"
+
+namespace HW {
+namespace DisplayTransfer {
+
+/// Starts the worker threads used to split large transfers
+void Init();
+
+/// Stops the worker threads
+void Shutdown();
+
+/**
+ * Performs a display transfer (format conversion, tiling or untiling and downscaling) in
+ * software. The caller is responsible for validating the scaling mode and flushing the rasterizer
+ * caches.
+ * @param config Transfer configuration, which must not be a texture copy
+ * @param src Pointer to the input image
+ * @param dst Pointer to the output image
+ */
+void PerformDisplayTransfer(const GPU::Regs::DisplayTransferConfig& config, const u8* src, u8* dst);
+
+/**
+ * Performs a texture copy, copying lines of bytes while skipping the gaps between them in the
+ * input and the output. The caller is responsible for flushing the rasterizer caches.
+ * @param config Transfer configuration, which must be a texture copy
+ * @param src Pointer to the input data
+ * @param dst Pointer to the output data
+ */
+void PerformTextureCopy(const GPU::Regs::DisplayTransferConfig& config, const u8* src, u8* dst);
+
+} // namespace DisplayTransfer
+} // namespace HW
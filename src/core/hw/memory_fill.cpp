@@ -0,0 +1,76 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+#include "common/common_types.h"
+
+#include "core/hw/gpu.h"
+#include "core/hw/memory_fill.h"
+
+namespace HW {
+namespace MemoryFill {
+
+/// Length of the repeated pattern, the smallest multiple of 16 bytes holding whole 24-bit values
+static constexpr size_t PATTERN_SIZE = 48;
+using Pattern = std::array<u8, PATTERN_SIZE>;
+
+/// Repeats the pattern over the given number of bytes, the last copy may be partial
+static void FillPattern(u8* dest, size_t size, const Pattern& pattern) {
+    size_t offset = 0;
+#ifdef ARCHITECTURE_x86_64
+    const __m128i pattern0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data()));
+    const __m128i pattern1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data() + 16));
+    const __m128i pattern2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.data() + 32));
+    for (; offset + PATTERN_SIZE <= size; offset += PATTERN_SIZE) {
+        __m128i* chunk = reinterpret_cast<__m128i*>(dest + offset);
+        _mm_storeu_si128(chunk, pattern0);
+        _mm_storeu_si128(chunk + 1, pattern1);
+        _mm_storeu_si128(chunk + 2, pattern2);
+    }
+#else
+    for (; offset + PATTERN_SIZE <= size; offset += PATTERN_SIZE)
+        std::memcpy(dest + offset, pattern.data(), PATTERN_SIZE);
+#endif
+    std::memcpy(dest + offset, pattern.data(), size - offset);
+}
+
+void PerformMemoryFill(const GPU::Regs::MemoryFillConfig& config, u8* start, u8* end) {
+    if (end <= start)
+        return;
+
+    const size_t length = end - start;
+    Pattern pattern;
+    size_t size;
+
+    if (config.fill_24bit) {
+        for (size_t i = 0; i < PATTERN_SIZE; i += 3) {
+            pattern[i] = config.value_24bit_r;
+            pattern[i + 1] = config.value_24bit_g;
+            pattern[i + 2] = config.value_24bit_b;
+        }
+        size = (length + 2) / 3 * 3;
+    } else if (config.fill_32bit) {
+        const u32 value = config.value_32bit;
+        for (size_t i = 0; i < PATTERN_SIZE; i += sizeof(u32))
+            std::memcpy(&pattern[i], &value, sizeof(u32));
+        size = length / sizeof(u32) * sizeof(u32);
+    } else {
+        const u16 value = config.value_16bit;
+        for (size_t i = 0; i < PATTERN_SIZE; i += sizeof(u16))
+            std::memcpy(&pattern[i], &value, sizeof(u16));
+        size = (length + 1) / sizeof(u16) * sizeof(u16);
+    }
+
+    FillPattern(start, size, pattern);
+}
+
+} // namespace MemoryFill
+} // namespace HW
@@ -0,0 +1,25 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "common/common_types.h"
+
+#include "core/hw/gpu.h"
+
+namespace HW {
+namespace MemoryFill {
+
+/**
+ * Performs a memory fill in software. The caller is responsible for flushing the rasterizer
+ * caches.
+ * @param config Fill configuration, selecting the value and its width
+ * @param start Pointer to the start of the filled region
+ * @param end Pointer to the end of the filled region. 16-bit and 24-bit fills write the last
+ *            value entirely, even if it extends past the end.
+ */
+void PerformMemoryFill(const GPU::Regs::MemoryFillConfig& config, u8* start, u8* end);
+
+} // namespace MemoryFill
+} // namespace HW
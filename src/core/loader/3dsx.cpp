@@ -221,7 +221,7 @@ static THREEDSX_Error Load3DSXFile(FileUtil::IOFile& file, u32 base_addr, Shared
     code_set->data.size   = loadinfo.seg_sizes[2];
 
     code_set->entrypoint = code_set->code.addr;
-    code_set->memory = std::make_shared<std::vector<u8>>(std::move(program_image));
+    code_set->memory = std::make_shared<Kernel::MemoryBlock>(program_image.begin(), program_image.end());
 
     LOG_DEBUG(Loader, "code size:   0x%X", loadinfo.seg_sizes[0]);
     LOG_DEBUG(Loader, "rodata size: 0x%X", loadinfo.seg_sizes[1]);
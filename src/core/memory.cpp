@@ -2,14 +2,19 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #include "common/assert.h"
 #include "common/common_types.h"
 #include "common/logging/log.h"
 #include "common/swap.h"
 
+#include "core/fastmem.h"
 #include "core/hle/kernel/process.h"
 #include "core/memory.h"
 #include "core/memory_setup.h"
@@ -54,11 +59,24 @@ struct PageTable {
      */
     std::array<u8*, NUM_ENTRIES> pointers;
 
+    /**
+     * Array of memory pointers backing each page, regardless of rasterizer caching. Unlike
+     * `pointers`, an entry stays valid while the page is of type `RasterizerCachedMemory`, so that
+     * the slow path doesn't need to search the VMAs of the current process.
+     */
+    std::array<u8*, NUM_ENTRIES> backing_pointers;
+
     /**
      * Contains MMIO handlers that back memory regions whose entries in the `attribute` array is of type `Special`.
      */
     std::vector<SpecialRegion> special_regions;
 
+    /**
+     * Array of indices into `special_regions` plus one for each page, or 0 if the page isn't
+     * mapped to an I/O region.
+     */
+    std::array<u16, NUM_ENTRIES> special_region_indices;
+
     /**
      * Array of fine grained page attributes. If it is set to any value other than `Memory`, then
      * the corresponding entry in `pointers` MUST be set to null.
@@ -77,9 +95,25 @@ static PageTable main_page_table;
 /// Currently active page table
 static PageTable* current_page_table = &main_page_table;
 
-static void MapPages(u32 base, u32 size, u8* memory, PageType type) {
+/**
+ * Pages of type `RasterizerCachedMemory` whose cached resources were flushed to memory by a CPU
+ * access since the rasterizer last ran. Further accesses to them don't need to flush again, as
+ * the cached resources can't become dirty until the rasterizer runs.
+ */
+static std::bitset<PageTable::NUM_ENTRIES> flushed_pages;
+static std::vector<u32> flushed_page_list;
+
+/**
+ * Physical regions written by the CPU whose cached resources still have to be invalidated, as
+ * coalesced [start, end) ranges. See RasterizerInvalidatePendingWrites.
+ */
+static std::vector<std::pair<PAddr, PAddr>> pending_writes;
+
+static void MapPages(u32 base, u32 size, u8* memory, PageType type, u16 special_region_index = 0) {
     LOG_DEBUG(HW_Memory, "Mapping %p onto %08X-%08X", memory, base * PAGE_SIZE, (base + size) * PAGE_SIZE);
 
+    Fastmem::MapRegion(base * PAGE_SIZE, size * PAGE_SIZE, type == PageType::Memory ? memory : nullptr);
+
     u32 end = base + size;
 
     while (base != end) {
@@ -93,6 +127,8 @@ static void MapPages(u32 base, u32 size, u8* memory, PageType type) {
 
         current_page_table->attributes[base] = type;
         current_page_table->pointers[base] = memory;
+        current_page_table->backing_pointers[base] = memory;
+        current_page_table->special_region_indices[base] = special_region_index;
         current_page_table->cached_res_count[base] = 0;
 
         base += 1;
@@ -103,6 +139,8 @@ static void MapPages(u32 base, u32 size, u8* memory, PageType type) {
 
 void InitMemoryMap() {
     main_page_table.pointers.fill(nullptr);
+    main_page_table.backing_pointers.fill(nullptr);
+    main_page_table.special_region_indices.fill(0);
     main_page_table.attributes.fill(PageType::Unmapped);
     main_page_table.cached_res_count.fill(0);
 }
@@ -116,9 +154,13 @@ void MapMemoryRegion(VAddr base, u32 size, u8* target) {
 void MapIoRegion(VAddr base, u32 size, MMIORegionPointer mmio_handler) {
     ASSERT_MSG((size & PAGE_MASK) == 0, "non-page aligned size: %08X", size);
     ASSERT_MSG((base & PAGE_MASK) == 0, "non-page aligned base: %08X", base);
-    MapPages(base / PAGE_SIZE, size / PAGE_SIZE, nullptr, PageType::Special);
 
-    current_page_table->special_regions.emplace_back(SpecialRegion{base, size, mmio_handler});
+    auto& special_regions = current_page_table->special_regions;
+    ASSERT_MSG(special_regions.size() < UINT16_MAX, "too many I/O regions");
+    special_regions.emplace_back(SpecialRegion{base, size, mmio_handler});
+
+    MapPages(base / PAGE_SIZE, size / PAGE_SIZE, nullptr, PageType::Special,
+             static_cast<u16>(special_regions.size()));
 }
 
 void UnmapRegion(VAddr base, u32 size) {
@@ -128,38 +170,65 @@ void UnmapRegion(VAddr base, u32 size) {
 }
 
 /**
- * Gets a pointer to the exact memory at the virtual address (i.e. not page aligned)
- * using a VMA from the current process
+ * Gets a pointer to the exact memory at the virtual address (i.e. not page aligned), bypassing the
+ * rasterizer cache checks
  */
-static u8* GetPointerFromVMA(VAddr vaddr) {
-    u8* direct_pointer = nullptr;
+static u8* GetBackingPointer(VAddr vaddr) {
+    u8* page_pointer = current_page_table->backing_pointers[vaddr >> PAGE_BITS];
+    ASSERT_MSG(page_pointer, "Cached memory page without a backing pointer @ %08X", vaddr);
+    return page_pointer + (vaddr & PAGE_MASK);
+}
 
-    auto& vma = Kernel::g_current_process->vm_manager.FindVMA(vaddr)->second;
-    switch (vma.type) {
-    case Kernel::VMAType::AllocatedMemoryBlock:
-        direct_pointer = vma.backing_block->data() + vma.offset;
-        break;
-    case Kernel::VMAType::BackingMemory:
-        direct_pointer = vma.backing_memory;
-        break;
-    default:
-        UNREACHABLE();
+/**
+ * This function should only be called for virtual addreses with attribute `PageType::Special`.
+ */
+static MMIORegionPointer GetMMIOHandler(VAddr vaddr) {
+    u16 index = current_page_table->special_region_indices[vaddr >> PAGE_BITS];
+    if (index == 0) {
+        ASSERT_MSG(false, "Mapped IO page without a handler @ %08X", vaddr);
+        return nullptr; // Should never happen
     }
+    return current_page_table->special_regions[index - 1].handler;
+}
+
+/**
+ * Flushes the cached resources touching the page at the given virtual address, unless the page
+ * has already been flushed since the rasterizer last ran.
+ */
+static void FlushCachedPage(VAddr vaddr) {
+    const u32 page = vaddr >> PAGE_BITS;
+    if (flushed_pages[page])
+        return;
 
-    return direct_pointer + (vaddr - vma.base);
+    flushed_pages[page] = true;
+    flushed_page_list.push_back(page);
+
+    if (VideoCore::g_renderer != nullptr) {
+        VideoCore::g_renderer->Rasterizer()->FlushRegion(VirtualToPhysicalAddress(vaddr & ~PAGE_MASK), PAGE_SIZE);
+    }
 }
 
 /**
- * This function should only be called for virtual addreses with attribute `PageType::Special`.
+ * Prepares a CPU write to a page of type `RasterizerCachedMemory`. Instead of flushing and
+ * invalidating the cached resources on every store, the page is flushed once and the written
+ * range is recorded, to be invalidated in bulk before the rasterizer runs again.
  */
-static MMIORegionPointer GetMMIOHandler(VAddr vaddr) {
-    for (const auto& region : current_page_table->special_regions) {
-        if (vaddr >= region.base && vaddr < (region.base + region.size)) {
-            return region.handler;
+static void TrackCachedWrite(VAddr vaddr, u32 size) {
+    FlushCachedPage(vaddr);
+
+    const PAddr start = VirtualToPhysicalAddress(vaddr);
+    const PAddr end = start + size;
+
+    // CPU loops mostly write sequentially, so it's usually enough to extend the last range
+    if (!pending_writes.empty()) {
+        auto& last = pending_writes.back();
+        if (start <= last.second && end >= last.first) {
+            last.first = std::min(last.first, start);
+            last.second = std::max(last.second, end);
+            return;
         }
     }
-    ASSERT_MSG(false, "Mapped IO page without a handler @ %08X", vaddr);
-    return nullptr; // Should never happen
+    pending_writes.emplace_back(start, end);
 }
 
 template<typename T>
@@ -185,10 +254,10 @@ T Read(const VAddr vaddr) {
         break;
     case PageType::RasterizerCachedMemory:
     {
-        RasterizerFlushRegion(VirtualToPhysicalAddress(vaddr), sizeof(T));
+        FlushCachedPage(vaddr);
 
         T value;
-        std::memcpy(&value, GetPointerFromVMA(vaddr), sizeof(T));
+        std::memcpy(&value, GetBackingPointer(vaddr), sizeof(T));
         return value;
     }
     case PageType::Special:
@@ -226,9 +295,9 @@ void Write(const VAddr vaddr, const T data) {
         break;
     case PageType::RasterizerCachedMemory:
     {
-        RasterizerFlushAndInvalidateRegion(VirtualToPhysicalAddress(vaddr), sizeof(T));
+        TrackCachedWrite(vaddr, sizeof(T));
 
-        std::memcpy(GetPointerFromVMA(vaddr), &data, sizeof(T));
+        std::memcpy(GetBackingPointer(vaddr), &data, sizeof(T));
         break;
     }
     case PageType::Special:
@@ -273,7 +342,7 @@ u8* GetPointer(const VAddr vaddr) {
     }
 
     if (current_page_table->attributes[vaddr >> PAGE_BITS] == PageType::RasterizerCachedMemory) {
-        return GetPointerFromVMA(vaddr);
+        return GetBackingPointer(vaddr);
     }
 
     LOG_ERROR(HW_Memory, "unknown GetPointer @ 0x%08x", vaddr);
@@ -320,6 +389,7 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
             case PageType::Memory:
                 page_type = PageType::RasterizerCachedMemory;
                 current_page_table->pointers[vaddr >> PAGE_BITS] = nullptr;
+                Fastmem::MapRegion(vaddr & ~PAGE_MASK, PAGE_SIZE, nullptr);
                 break;
             case PageType::Special:
                 page_type = PageType::RasterizerCachedSpecial;
@@ -337,7 +407,9 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
             switch (page_type) {
             case PageType::RasterizerCachedMemory:
                 page_type = PageType::Memory;
-                current_page_table->pointers[vaddr >> PAGE_BITS] = GetPointerFromVMA(vaddr & ~PAGE_MASK);
+                current_page_table->pointers[vaddr >> PAGE_BITS] =
+                    current_page_table->backing_pointers[vaddr >> PAGE_BITS];
+                Fastmem::MapRegion(vaddr & ~PAGE_MASK, PAGE_SIZE, current_page_table->pointers[vaddr >> PAGE_BITS]);
                 break;
             case PageType::RasterizerCachedSpecial:
                 page_type = PageType::Special;
@@ -351,17 +423,58 @@ void RasterizerMarkRegionCached(PAddr start, u32 size, int count_delta) {
 }
 
 void RasterizerFlushRegion(PAddr start, u32 size) {
+    RasterizerInvalidatePendingWrites();
+
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushRegion(start, size);
     }
 }
 
 void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size) {
+    RasterizerInvalidatePendingWrites();
+
     if (VideoCore::g_renderer != nullptr) {
         VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(start, size);
     }
 }
 
+void RasterizerInvalidatePendingWrites() {
+    for (u32 page : flushed_page_list) {
+        flushed_pages[page] = false;
+    }
+    flushed_page_list.clear();
+
+    if (pending_writes.empty())
+        return;
+
+    // Invalidating may re-enter the memory subsystem, so take ownership of the list first
+    std::vector<std::pair<PAddr, PAddr>> writes;
+    writes.swap(pending_writes);
+
+    std::sort(writes.begin(), writes.end());
+    auto merged_end = writes.begin();
+    for (auto it = writes.begin() + 1; it != writes.end(); ++it) {
+        if (it->first <= merged_end->second) {
+            merged_end->second = std::max(merged_end->second, it->second);
+        } else {
+            *++merged_end = *it;
+        }
+    }
+    writes.erase(merged_end + 1, writes.end());
+
+    if (VideoCore::g_renderer != nullptr) {
+        for (const auto& range : writes) {
+            VideoCore::g_renderer->Rasterizer()->FlushAndInvalidateRegion(range.first, range.second - range.first);
+        }
+    }
+
+    // Reuse the allocation for the next batch of writes
+    if (pending_writes.empty()) {
+        writes.clear();
+        pending_writes.swap(writes);
+    }
+}
+
 u8 Read8(const VAddr addr) {
     return Read<u8>(addr);
 }
@@ -407,9 +520,9 @@ void ReadBlock(const VAddr src_addr, void* dest_buffer, const size_t size) {
             break;
         }
         case PageType::RasterizerCachedMemory: {
-            RasterizerFlushRegion(VirtualToPhysicalAddress(current_vaddr), copy_amount);
+            FlushCachedPage(current_vaddr);
 
-            std::memcpy(dest_buffer, GetPointerFromVMA(current_vaddr), copy_amount);
+            std::memcpy(dest_buffer, GetBackingPointer(current_vaddr), copy_amount);
             break;
         }
         case PageType::RasterizerCachedSpecial: {
@@ -475,9 +588,9 @@ void WriteBlock(const VAddr dest_addr, const void* src_buffer, const size_t size
             break;
         }
         case PageType::RasterizerCachedMemory: {
-            RasterizerFlushAndInvalidateRegion(VirtualToPhysicalAddress(current_vaddr), copy_amount);
+            TrackCachedWrite(current_vaddr, static_cast<u32>(copy_amount));
 
-            std::memcpy(GetPointerFromVMA(current_vaddr), src_buffer, copy_amount);
+            std::memcpy(GetBackingPointer(current_vaddr), src_buffer, copy_amount);
             break;
         }
         case PageType::RasterizerCachedSpecial: {
@@ -529,9 +642,9 @@ void ZeroBlock(const VAddr dest_addr, const size_t size) {
             break;
         }
         case PageType::RasterizerCachedMemory: {
-            RasterizerFlushAndInvalidateRegion(VirtualToPhysicalAddress(current_vaddr), copy_amount);
+            TrackCachedWrite(current_vaddr, static_cast<u32>(copy_amount));
 
-            std::memset(GetPointerFromVMA(current_vaddr), 0, copy_amount);
+            std::memset(GetBackingPointer(current_vaddr), 0, copy_amount);
             break;
         }
         case PageType::RasterizerCachedSpecial: {
@@ -582,9 +695,9 @@ void CopyBlock(VAddr dest_addr, VAddr src_addr, const size_t size) {
             break;
         }
         case PageType::RasterizerCachedMemory: {
-            RasterizerFlushRegion(VirtualToPhysicalAddress(current_vaddr), copy_amount);
+            FlushCachedPage(current_vaddr);
 
-            WriteBlock(dest_addr, GetPointerFromVMA(current_vaddr), copy_amount);
+            WriteBlock(dest_addr, GetBackingPointer(current_vaddr), copy_amount);
             break;
         }
         case PageType::RasterizerCachedSpecial: {
@@ -167,4 +167,11 @@ void RasterizerFlushRegion(PAddr start, u32 size);
  */
 void RasterizerFlushAndInvalidateRegion(PAddr start, u32 size);
 
+/**
+ * Invalidates any externally cached rasterizer resources touching regions written by the CPU
+ * since the last call. CPU writes to cached memory only flush the cached resources, so this
+ * must be called before the rasterizer uses them again.
+ */
+void RasterizerInvalidatePendingWrites();
+
 }
@@ -21,7 +21,13 @@ void Apply() {
 
     VideoCore::g_hw_renderer_enabled = values.use_hw_renderer;
     VideoCore::g_shader_jit_enabled = values.use_shader_jit;
+    VideoCore::g_shader_jit_disk_cache_enabled = values.use_shader_jit_disk_cache;
+    VideoCore::g_shader_jit_async_enabled = values.use_shader_jit_async;
+    VideoCore::g_shader_jit_batch_enabled = values.use_shader_jit_batch;
     VideoCore::g_scaled_resolution_enabled = values.use_scaled_resolution;
+    VideoCore::g_sw_rasterizer_threads = values.sw_rasterizer_threads;
+    VideoCore::g_vertex_shader_threads = values.vertex_shader_threads;
+    VideoCore::g_surface_cache_size = values.surface_cache_size;
 
     AudioCore::SelectSink(values.sink_id);
     AudioCore::EnableStretching(values.enable_audio_stretching);
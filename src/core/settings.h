@@ -61,6 +61,8 @@ struct Values {
 
     // Core
     bool use_cpu_jit;
+    bool use_interpreter_block_cache;
+    bool use_fastmem;
     int frame_skip;
 
     // Data Storage
@@ -72,14 +74,22 @@ struct Values {
     // Renderer
     bool use_hw_renderer;
     bool use_shader_jit;
+    bool use_shader_jit_disk_cache;
+    bool use_shader_jit_async;
+    bool use_shader_jit_batch;
     bool use_scaled_resolution;
     bool use_vsync;
+    int sw_rasterizer_threads;
+    int vertex_shader_threads;
+    int surface_cache_size;
+    bool use_null_renderer; ///< Not read from the configuration, set by headless frontends
 
     float bg_red;
     float bg_green;
     float bg_blue;
 
     std::string log_filter;
+    bool use_binary_log;
 
     // Audio
     std::string sink_id;
@@ -88,6 +98,7 @@ struct Values {
     // Debugging
     bool use_gdbstub;
     u16 gdbstub_port;
+    bool use_guest_profiler;
 } extern values;
 
 void Apply();
@@ -7,6 +7,8 @@
 #include "core/cheat_core.h"
 #include "core/core.h"
 #include "core/core_timing.h"
+#include "core/fastmem.h"
+#include "core/guest_profiler.h"
 #include "core/system.h"
 #include "core/gdbstub/gdbstub.h"
 #include "core/hw/hw.h"
@@ -20,9 +22,10 @@ namespace System {
 static bool is_powered_on{ false };
 
 Result Init(EmuWindow* emu_window) {
+    // Set up memory first, the CPU cores pick their memory accessors depending on fastmem
+    Memory::Init();
     Core::Init();
     CoreTiming::Init();
-    Memory::Init();
     HW::Init();
     Kernel::Init();
     HLE::Init();
@@ -32,6 +35,7 @@ Result Init(EmuWindow* emu_window) {
     AudioCore::Init();
     CheatCore::Init();
     GDBStub::Init();
+    GuestProfiler::Init();
 
     is_powered_on = true;
 
@@ -43,12 +47,14 @@ bool IsPoweredOn() {
 }
 
 void Shutdown() {
+    GuestProfiler::Shutdown();
     GDBStub::Shutdown();
     CheatCore::Shutdown();
     AudioCore::Shutdown();
     VideoCore::Shutdown();
     HLE::Shutdown();
     Kernel::Shutdown();
+    Memory::Fastmem::Shutdown();
     HW::Shutdown();
     CoreTiming::Shutdown();
     Core::Shutdown();
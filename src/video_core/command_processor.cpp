@@ -2,14 +2,18 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 
 #include "core/hle/service/gsp_gpu.h"
@@ -46,6 +50,187 @@ static const u32 expand_bits_to_bytes[] = {
 };
 
 MICROPROFILE_DEFINE(GPU_Drawing, "GPU", "Drawing", MP_RGB(50, 50, 240));
+MICROPROFILE_DEFINE(GPU_VertexBatch, "GPU", "Vertex Batch", MP_RGB(50, 50, 200));
+
+/// Minimum number of vertices shaded by a single task of a batched draw
+static const size_t VERTEX_BATCH_MIN_CHUNK_SIZE = 64;
+
+static std::unique_ptr<Common::ThreadPool> vertex_shader_pool;
+
+/// Returns the number of threads requested for vertex shading, resolving the "automatic" setting
+static size_t GetNumVertexShaderThreads() {
+    const int setting = VideoCore::g_vertex_shader_threads;
+    if (setting <= 0)
+        return Common::ThreadPool::DefaultThreadCount();
+    return static_cast<size_t>(setting);
+}
+
+/**
+ * Post-transform cache for the shaded vertices of an indexed draw. Entries are direct-mapped by
+ * the vertex id relative to the smallest index of the draw, with the table sized to cover the
+ * whole index range if possible. In that case every vertex is shaded exactly once; otherwise
+ * vertices mapping to the same slot evict each other.
+ */
+class VertexCache final {
+public:
+    /// Invalidates all entries and resizes the table for a draw referencing the given index range
+    void Reset(u32 min_vertex, u32 max_vertex) {
+        const u32 range = max_vertex - min_vertex + 1;
+
+        size_t size = 1;
+        while (size < range && size < MAX_SIZE)
+            size <<= 1;
+
+        base_vertex = min_vertex;
+        mask = static_cast<u32>(size - 1);
+        tags.assign(size, INVALID_TAG);
+        if (entries.size() < size)
+            entries.resize(size);
+    }
+
+    /// Returns the cached shader outputs of the given vertex, or nullptr if it is not cached
+    const Shader::OutputRegisters* Lookup(u32 vertex) const {
+        const u32 slot = (vertex - base_vertex) & mask;
+        return (tags[slot] == vertex) ? &entries[slot] : nullptr;
+    }
+
+    void Insert(u32 vertex, const Shader::OutputRegisters& output_registers) {
+        const u32 slot = (vertex - base_vertex) & mask;
+        tags[slot] = vertex;
+        entries[slot] = output_registers;
+    }
+
+private:
+    /// Upper bound on the number of entries, chosen to keep the table around 1 MiB
+    static const size_t MAX_SIZE = 4096;
+    static const u32 INVALID_TAG = 0xFFFFFFFF;
+
+    std::vector<u32> tags;
+    std::vector<Shader::OutputRegisters> entries;
+    u32 base_vertex = 0;
+    u32 mask = 0;
+};
+
+static VertexCache vertex_cache;
+
+/**
+ * Shades all vertices of a draw call in parallel and afterwards submits them to the primitive
+ * assembler in their original order.
+ *
+ * The vertex indices are resolved first so that every unique vertex is loaded and shaded exactly
+ * once. The unique vertices are then split into chunks which are processed on the worker threads,
+ * each of which uses its own copy of the shader unit state.
+ */
+static void ProcessVertexBatch(VertexLoader& loader, u32 base_address, bool is_indexed,
+                               const u8* index_address_8, bool index_u16, size_t num_threads) {
+    MICROPROFILE_SCOPE(GPU_VertexBatch);
+
+    const auto& regs = g_state.regs;
+    const u16* index_address_16 = reinterpret_cast<const u16*>(index_address_8);
+    const u32 num_indices = regs.num_vertices;
+
+    // For each index of the draw, the slot of its vertex in the list of unique vertices
+    std::vector<u32> vertex_slots(num_indices);
+    // Vertex ids to shade and the first index referencing them (only used for logging)
+    std::vector<u32> unique_vertices;
+    std::vector<u32> unique_vertex_indices;
+
+    if (is_indexed) {
+        std::vector<u32> vertex_ids(num_indices);
+        for (u32 index = 0; index < num_indices; ++index) {
+            vertex_ids[index] = index_u16 ? index_address_16[index] : index_address_8[index];
+            // -1 is a common special value used for primitive restart, see the serial path
+            ASSERT(vertex_ids[index] != -1);
+        }
+
+        const auto minmax = std::minmax_element(vertex_ids.begin(), vertex_ids.end());
+        const u32 min_vertex = (num_indices != 0) ? *minmax.first : 0;
+        const u32 max_vertex = (num_indices != 0) ? *minmax.second : 0;
+
+        const u32 invalid_slot = std::numeric_limits<u32>::max();
+        std::vector<u32> slot_of_vertex(max_vertex - min_vertex + 1, invalid_slot);
+
+        for (u32 index = 0; index < num_indices; ++index) {
+            u32& slot = slot_of_vertex[vertex_ids[index] - min_vertex];
+            if (slot == invalid_slot) {
+                slot = static_cast<u32>(unique_vertices.size());
+                unique_vertices.push_back(vertex_ids[index]);
+                unique_vertex_indices.push_back(index);
+            }
+            vertex_slots[index] = slot;
+        }
+
+        MICROPROFILE_META_CPU("Vertex Cache Hits", num_indices - unique_vertices.size());
+        MICROPROFILE_META_CPU("Vertex Cache Misses", unique_vertices.size());
+    } else {
+        // Indexed rendering doesn't use the start offset
+        unique_vertices.resize(num_indices);
+        unique_vertex_indices.resize(num_indices);
+        for (u32 index = 0; index < num_indices; ++index) {
+            unique_vertices[index] = index + regs.vertex_offset;
+            ASSERT(unique_vertices[index] != -1);
+            unique_vertex_indices[index] = index;
+            vertex_slots[index] = index;
+        }
+    }
+
+    std::vector<Shader::OutputVertex> output_vertices(unique_vertices.size());
+
+    // The shader unit state is copied so that each worker starts off with the same register
+    // contents the serial path would use.
+    const Shader::UnitState<false>& vs_shader_unit = Shader::GetShaderUnit(false);
+
+    auto ShadeVertices = [&](size_t begin, size_t end) {
+        Shader::UnitState<false> shader_unit = vs_shader_unit;
+        Shader::BatchUnitState batch_unit;
+        batch_unit.Initialize(shader_unit);
+        DebugUtils::MemoryAccessTracker memory_accesses;
+
+        for (size_t i = begin; i < end; i += Shader::SHADER_BATCH_SIZE) {
+            const unsigned count = static_cast<unsigned>(std::min<size_t>(Shader::SHADER_BATCH_SIZE, end - i));
+
+            Shader::InputVertex inputs[Shader::SHADER_BATCH_SIZE];
+            Shader::OutputRegisters outputs[Shader::SHADER_BATCH_SIZE];
+            for (unsigned lane = 0; lane < count; ++lane) {
+                loader.LoadVertex(base_address, unique_vertex_indices[i + lane], unique_vertices[i + lane],
+                                  inputs[lane], memory_accesses);
+            }
+
+            g_state.vs.RunBatch(shader_unit, batch_unit, inputs, count, loader.GetNumTotalAttributes(),
+                                regs.vs, outputs);
+
+            for (unsigned lane = 0; lane < count; ++lane)
+                output_vertices[i + lane] = outputs[lane].ToVertex(regs.vs);
+        }
+    };
+
+    const size_t num_unique = unique_vertices.size();
+    const size_t chunk_size = std::max(VERTEX_BATCH_MIN_CHUNK_SIZE, (num_unique + num_threads - 1) / num_threads);
+
+    if (num_unique <= chunk_size) {
+        // Not worth waking up the worker threads
+        ShadeVertices(0, num_unique);
+    } else {
+        if (!vertex_shader_pool || vertex_shader_pool->NumThreads() != num_threads)
+            vertex_shader_pool = std::make_unique<Common::ThreadPool>(num_threads, "VertexShader");
+
+        for (size_t begin = 0; begin < num_unique; begin += chunk_size) {
+            const size_t end = std::min(begin + chunk_size, num_unique);
+            vertex_shader_pool->Push([&ShadeVertices, begin, end] { ShadeVertices(begin, end); });
+        }
+        vertex_shader_pool->WaitForIdle();
+    }
+
+    // Primitive assembly depends on the vertex order, hence it is done serially
+    using Pica::Shader::OutputVertex;
+    auto AddTriangle = [](const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+        VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+    };
+
+    for (u32 slot : vertex_slots) {
+        g_state.primitive_assembler.SubmitVertex(output_vertices[slot], AddTriangle);
+    }
+}
 
 static void WritePicaReg(u32 id, u32 value, u32 mask) {
     auto& regs = g_state.regs;
@@ -227,116 +412,131 @@ static void WritePicaReg(u32 id, u32 value, u32 mask) {
 
             DebugUtils::MemoryAccessTracker memory_accesses;
 
-            // Simple circular-replacement vertex cache
-            // The size has been tuned for optimal balance between hit-rate and the cost of lookup
-            const size_t VERTEX_CACHE_SIZE = 32;
-            std::array<u16, VERTEX_CACHE_SIZE> vertex_cache_ids;
-            std::array<Shader::OutputRegisters, VERTEX_CACHE_SIZE> vertex_cache;
+            // Vertices can only be shaded out of order if nothing observes the individual shader
+            // invocations and no geometry shader consumes the vertex shader outputs in sequence.
+            const size_t num_vertex_shader_threads = GetNumVertexShaderThreads();
+            if (num_vertex_shader_threads > 1 && !g_debug_context && !Shader::UseGS()) {
+                g_state.vs.Setup();
+                ProcessVertexBatch(loader, base_address, is_indexed, index_address_8, index_u16,
+                                   num_vertex_shader_threads);
+            } else {
+                if (is_indexed) {
+                    u32 min_vertex = std::numeric_limits<u32>::max();
+                    u32 max_vertex = 0;
+                    for (unsigned int index = 0; index < regs.num_vertices; ++index) {
+                        const u32 vertex = index_u16 ? index_address_16[index] : index_address_8[index];
+                        min_vertex = std::min(min_vertex, vertex);
+                        max_vertex = std::max(max_vertex, vertex);
+                    }
+                    if (regs.num_vertices != 0)
+                        vertex_cache.Reset(min_vertex, max_vertex);
+                }
 
-            unsigned int vertex_cache_pos = 0;
-            vertex_cache_ids.fill(-1);
+                u32 vertex_cache_hits = 0;
+                u32 vertex_cache_misses = 0;
 
-            auto& vs_shader_unit = Shader::GetShaderUnit(false);
-            g_state.vs.Setup();
+                auto& vs_shader_unit = Shader::GetShaderUnit(false);
+                g_state.vs.Setup();
 
-            auto& gs_unit_state = Shader::GetShaderUnit(true);
-            g_state.gs.Setup();
+                auto& gs_unit_state = Shader::GetShaderUnit(true);
+                g_state.gs.Setup();
 
-            for (unsigned int index = 0; index < regs.num_vertices; ++index)
-            {
-                // Indexed rendering doesn't use the start offset
-                unsigned int vertex = is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index]) : (index + regs.vertex_offset);
+                for (unsigned int index = 0; index < regs.num_vertices; ++index)
+                {
+                    // Indexed rendering doesn't use the start offset
+                    unsigned int vertex = is_indexed ? (index_u16 ? index_address_16[index] : index_address_8[index]) : (index + regs.vertex_offset);
 
-                // -1 is a common special value used for primitive restart. Since it's unknown if
-                // the PICA supports it, and it would mess up the caching, guard against it here.
-                ASSERT(vertex != -1);
+                    // -1 is a common special value used for primitive restart. Since it's unknown if
+                    // the PICA supports it, and it would mess up the caching, guard against it here.
+                    ASSERT(vertex != -1);
 
-                bool vertex_cache_hit = false;
-                Shader::OutputRegisters output_registers;
+                    bool vertex_cache_hit = false;
+                    Shader::OutputRegisters output_registers;
 
-                if (is_indexed) {
-                    if (g_debug_context && Pica::g_debug_context->recorder) {
-                        int size = index_u16 ? 2 : 1;
-                        memory_accesses.AddAccess(base_address + index_info.offset + size * index, size);
-                    }
+                    if (is_indexed) {
+                        if (g_debug_context && Pica::g_debug_context->recorder) {
+                            int size = index_u16 ? 2 : 1;
+                            memory_accesses.AddAccess(base_address + index_info.offset + size * index, size);
+                        }
 
-                    for (unsigned int i = 0; i < VERTEX_CACHE_SIZE; ++i) {
-                        if (vertex == vertex_cache_ids[i]) {
-                            output_registers = vertex_cache[i];
+                        if (const Shader::OutputRegisters* cached = vertex_cache.Lookup(vertex)) {
+                            output_registers = *cached;
                             vertex_cache_hit = true;
-                            break;
+                            ++vertex_cache_hits;
+                        } else {
+                            ++vertex_cache_misses;
                         }
                     }
-                }
 
-                if (!vertex_cache_hit) {
-                    // Initialize data for the current vertex
-                    Shader::InputVertex input;
-                    loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
+                    if (!vertex_cache_hit) {
+                        // Initialize data for the current vertex
+                        Shader::InputVertex input;
+                        loader.LoadVertex(base_address, index, vertex, input, memory_accesses);
 
-                    // Send to vertex shader
-                    if (g_debug_context)
-                        g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation, (void*)&input);
-                    g_state.vs.Run(vs_shader_unit, input, loader.GetNumTotalAttributes(), regs.vs);
-                    output_registers = vs_shader_unit.output_registers;
+                        // Send to vertex shader
+                        if (g_debug_context)
+                            g_debug_context->OnEvent(DebugContext::Event::VertexShaderInvocation, (void*)&input);
+                        g_state.vs.Run(vs_shader_unit, input, loader.GetNumTotalAttributes(), regs.vs);
+                        output_registers = vs_shader_unit.output_registers;
 
-                    if (is_indexed) {
-                        vertex_cache[vertex_cache_pos] = output_registers;
-                        vertex_cache_ids[vertex_cache_pos] = vertex;
-                        vertex_cache_pos = (vertex_cache_pos + 1) % VERTEX_CACHE_SIZE;
+                        if (is_indexed)
+                            vertex_cache.Insert(vertex, output_registers);
                     }
-                }
 
-                // Helper to send triangle to renderer
-                using Pica::Shader::OutputVertex;
-                auto AddTriangle = [](
-                        const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
-                    VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
-                };
-
-                if (Shader::UseGS()) {
-
-                    auto& regs = g_state.regs;
-                    auto& gs_regs = g_state.regs.gs;
-                    auto& gs_buf = g_state.gs_input_buffer;
-
-                    // Vertex Shader Outputs are converted into Geometry Shader inputs by filling up a buffer
-                    // For example, if we have a geoshader that takes 6 inputs, and the vertex shader outputs 2 attributes
-                    // It would take 3 vertices to fill up the Geometry Shader buffer
-                    unsigned int gs_input_count = gs_regs.num_input_attributes + 1;
-                    unsigned int vs_output_count = regs.vs_outmap_total2 + 1;
-                    ASSERT_MSG(regs.vs_outmap_total1 == regs.vs_outmap_total2, "VS_OUTMAP_TOTAL1 and VS_OUTMAP_TOTAL2 don't match!");
-                    // copy into the geoshader buffer
-                    for (unsigned int i = 0; i < vs_output_count; i++) {
-                        if (gs_buf.index >= gs_input_count) {
-                            // TODO(ds84182): LOG_ERROR()
-                            ASSERT_MSG(false, "Number of GS inputs (%d) is not divisible by number of VS outputs (%d)",
-                                        gs_input_count, vs_output_count);
-                            continue;
+                    // Helper to send triangle to renderer
+                    using Pica::Shader::OutputVertex;
+                    auto AddTriangle = [](
+                            const OutputVertex& v0, const OutputVertex& v1, const OutputVertex& v2) {
+                        VideoCore::g_renderer->Rasterizer()->AddTriangle(v0, v1, v2);
+                    };
+
+                    if (Shader::UseGS()) {
+
+                        auto& regs = g_state.regs;
+                        auto& gs_regs = g_state.regs.gs;
+                        auto& gs_buf = g_state.gs_input_buffer;
+
+                        // Vertex Shader Outputs are converted into Geometry Shader inputs by filling up a buffer
+                        // For example, if we have a geoshader that takes 6 inputs, and the vertex shader outputs 2 attributes
+                        // It would take 3 vertices to fill up the Geometry Shader buffer
+                        unsigned int gs_input_count = gs_regs.num_input_attributes + 1;
+                        unsigned int vs_output_count = regs.vs_outmap_total2 + 1;
+                        ASSERT_MSG(regs.vs_outmap_total1 == regs.vs_outmap_total2, "VS_OUTMAP_TOTAL1 and VS_OUTMAP_TOTAL2 don't match!");
+                        // copy into the geoshader buffer
+                        for (unsigned int i = 0; i < vs_output_count; i++) {
+                            if (gs_buf.index >= gs_input_count) {
+                                // TODO(ds84182): LOG_ERROR()
+                                ASSERT_MSG(false, "Number of GS inputs (%d) is not divisible by number of VS outputs (%d)",
+                                            gs_input_count, vs_output_count);
+                                continue;
+                            }
+                            gs_buf.buffer.attr[gs_buf.index++] = output_registers.value[i];
                         }
-                        gs_buf.buffer.attr[gs_buf.index++] = output_registers.value[i];
-                    }
 
-                    if (gs_buf.index >= gs_input_count) {
+                        if (gs_buf.index >= gs_input_count) {
 
-                        // b15 will be false when a new primitive starts and then switch to true at some point
-                        //TODO: Test how this works exactly on hardware
-                        g_state.gs.uniforms.b[15] |= (index > 0);
+                            // b15 will be false when a new primitive starts and then switch to true at some point
+                            //TODO: Test how this works exactly on hardware
+                            g_state.gs.uniforms.b[15] |= (index > 0);
 
-                        // Process Geometry Shader
-                        if (g_debug_context)
-                            g_debug_context->OnEvent(DebugContext::Event::GeometryShaderInvocation, static_cast<void*>(&gs_buf.buffer));
-                        gs_unit_state.emit_triangle_callback = AddTriangle;
-                        g_state.gs.Run(gs_unit_state, gs_buf.buffer, gs_input_count, regs.gs);
-                        gs_unit_state.emit_triangle_callback = nullptr;
+                            // Process Geometry Shader
+                            if (g_debug_context)
+                                g_debug_context->OnEvent(DebugContext::Event::GeometryShaderInvocation, static_cast<void*>(&gs_buf.buffer));
+                            gs_unit_state.emit_triangle_callback = AddTriangle;
+                            g_state.gs.Run(gs_unit_state, gs_buf.buffer, gs_input_count, regs.gs);
+                            gs_unit_state.emit_triangle_callback = nullptr;
 
-                        gs_buf.index = 0;
+                            gs_buf.index = 0;
+                        }
+                    } else {
+                        Shader::OutputVertex output_vertex = output_registers.ToVertex(regs.vs);
+                        primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
                     }
-                } else {
-                    Shader::OutputVertex output_vertex = output_registers.ToVertex(regs.vs);
-                    primitive_assembler.SubmitVertex(output_vertex, AddTriangle);
+
                 }
 
+                MICROPROFILE_META_CPU("Vertex Cache Hits", vertex_cache_hits);
+                MICROPROFILE_META_CPU("Vertex Cache Misses", vertex_cache_misses);
             }
 
             for (auto& range : memory_accesses.ranges) {
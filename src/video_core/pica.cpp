@@ -10,7 +10,9 @@
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
 #include "video_core/primitive_assembly.h"
+#include "video_core/rasterizer.h"
 #include "video_core/shader/shader.h"
+#include "video_core/vertex_loader.h"
 
 namespace Pica {
 
@@ -500,7 +502,9 @@ void Init() {
 }
 
 void Shutdown() {
+    Rasterizer::Shutdown();
     Shader::ClearCache();
+    VertexLoader::ClearCache();
 }
 
 template <typename T>
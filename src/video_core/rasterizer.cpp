@@ -4,7 +4,15 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cmath>
+#include <memory>
+#include <vector>
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
 
 #include "common/assert.h"
 #include "common/bit_field.h"
@@ -13,7 +21,11 @@
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
+#ifdef ARCHITECTURE_x86_64
+#include "common/x64/cpu_detect.h"
+#endif
 
 #include "core/memory.h"
 #include "core/hw/gpu.h"
@@ -23,7 +35,9 @@
 #include "video_core/pica_state.h"
 #include "video_core/pica_types.h"
 #include "video_core/rasterizer.h"
+#include "video_core/texture_decoder.h"
 #include "video_core/utils.h"
+#include "video_core/video_core.h"
 #include "video_core/shader/shader.h"
 
 namespace Pica {
@@ -276,15 +290,160 @@ static int SignedArea (const Math::Vec2<Fix12P4>& vtx1,
     return Math::Cross(vec1, vec2).z;
 };
 
+// NOTE: Assuming that rasterizer coordinates are signed 12.4 fixed-point values.
+//       This type is what PSP uses, we haven't tested what the 3DS uses.
+
+static Fix12P4 FloatToFix(float24 flt) {
+    // TODO: Rounding in Fix12P4::FromFloat is necessary to prevent garbage pixels at
+    //       triangle borders. Is it that the correct solution, though?
+    return Fix12P4::FromFloat(flt.ToFloat32());
+}
+
+static Math::Vec3<Fix12P4> ScreenToRasterizerCoordinates(const Math::Vec3<float24>& vec) {
+    return Math::Vec3<Fix12P4>{FloatToFix(vec.x), FloatToFix(vec.y), FloatToFix(vec.z)};
+}
+
+/// Returns the rectangle covering the whole render target, in pixels
+static MathUtil::Rectangle<int> GetFramebufferBounds() {
+    const auto& framebuffer = g_state.regs.framebuffer;
+    return {0, 0, static_cast<int>(framebuffer.GetWidth()), static_cast<int>(framebuffer.GetHeight())};
+}
+
+// Span evaluation:
+// The edge functions used to compute the barycentric coordinates are linear in x, so along a row
+// they can be evaluated incrementally for several consecutive pixels at once. Pixel coverage and
+// the interpolated z/w value are computed for spans of SPAN_SIZE pixels up-front, which allows
+// skipping uncovered pixels in bulk and lets the coverage/depth setup use SIMD instructions.
+// All arithmetic matches the per-pixel formulas exactly, including the order of floating point
+// operations, so every implementation produces identical results.
+
+/// Number of horizontally adjacent pixels evaluated at once
+static constexpr int SPAN_SIZE = 8;
+
+/// Input to the span evaluation functions
+struct SpanSetup {
+    /// Edge function values (including fill rule bias) at the first pixel of the span
+    std::array<int, 3> w;
+    /// Increment of each edge function when moving one pixel to the right
+    std::array<int, 3> step;
+    /// Screen-space z of the three triangle vertices
+    std::array<float, 3> z;
+};
+
+/// Per-pixel values of a span, as computed by the span evaluation functions
+struct SpanData {
+    /// Barycentric coordinates (edge function values) of each pixel
+    alignas(32) std::array<std::array<int, SPAN_SIZE>, 3> w;
+    /// Linearly interpolated z/w of each pixel
+    alignas(32) std::array<float, SPAN_SIZE> z_over_w;
+    /// Bit i is set if pixel i is covered by the triangle
+    u32 coverage;
+};
+
+using SpanFunction = void (*)(const SpanSetup& setup, SpanData& span);
+
+static void EvaluateSpanScalar(const SpanSetup& setup, SpanData& span) {
+    span.coverage = 0;
+    for (int i = 0; i < SPAN_SIZE; ++i) {
+        const int w0 = span.w[0][i] = setup.w[0] + i * setup.step[0];
+        const int w1 = span.w[1][i] = setup.w[1] + i * setup.step[1];
+        const int w2 = span.w[2][i] = setup.w[2] + i * setup.step[2];
+        const int wsum = w0 + w1 + w2;
+
+        span.z_over_w[i] = (setup.z[0] * w0 + setup.z[1] * w1 + setup.z[2] * w2) / wsum;
+
+        if (w0 >= 0 && w1 >= 0 && w2 >= 0)
+            span.coverage |= 1 << i;
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+static void EvaluateSpanSSE2(const SpanSetup& setup, SpanData& span) {
+    int outside_mask = 0;
+
+    for (int half = 0; half < SPAN_SIZE / 4; ++half) {
+        const int first = half * 4;
+
+        __m128i w[3];
+        for (int edge = 0; edge < 3; ++edge) {
+            const int step = setup.step[edge];
+            const __m128i offsets = _mm_setr_epi32(first * step, (first + 1) * step,
+                                                   (first + 2) * step, (first + 3) * step);
+            w[edge] = _mm_add_epi32(_mm_set1_epi32(setup.w[edge]), offsets);
+            _mm_store_si128(reinterpret_cast<__m128i*>(&span.w[edge][first]), w[edge]);
+        }
+
+        const __m128i wsum = _mm_add_epi32(_mm_add_epi32(w[0], w[1]), w[2]);
+        const __m128 z_sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(setup.z[0]), _mm_cvtepi32_ps(w[0])),
+                                                   _mm_mul_ps(_mm_set1_ps(setup.z[1]), _mm_cvtepi32_ps(w[1]))),
+                                        _mm_mul_ps(_mm_set1_ps(setup.z[2]), _mm_cvtepi32_ps(w[2])));
+        _mm_store_ps(&span.z_over_w[first], _mm_div_ps(z_sum, _mm_cvtepi32_ps(wsum)));
+
+        // A pixel is outside the triangle if any of its edge functions is negative
+        const __m128i sign = _mm_or_si128(_mm_or_si128(w[0], w[1]), w[2]);
+        outside_mask |= _mm_movemask_ps(_mm_castsi128_ps(sign)) << first;
+    }
+
+    span.coverage = ~outside_mask & ((1 << SPAN_SIZE) - 1);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+static void EvaluateSpanAVX2(const SpanSetup& setup, SpanData& span) {
+    static_assert(SPAN_SIZE == 8, "AVX2 span evaluation assumes 8 pixels per span");
+
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256i w[3];
+    for (int edge = 0; edge < 3; ++edge) {
+        const __m256i offsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(setup.step[edge]));
+        w[edge] = _mm256_add_epi32(_mm256_set1_epi32(setup.w[edge]), offsets);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(span.w[edge].data()), w[edge]);
+    }
+
+    const __m256i wsum = _mm256_add_epi32(_mm256_add_epi32(w[0], w[1]), w[2]);
+    const __m256 z_sum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.z[0]), _mm256_cvtepi32_ps(w[0])),
+                                                     _mm256_mul_ps(_mm256_set1_ps(setup.z[1]), _mm256_cvtepi32_ps(w[1]))),
+                                       _mm256_mul_ps(_mm256_set1_ps(setup.z[2]), _mm256_cvtepi32_ps(w[2])));
+    _mm256_store_ps(span.z_over_w.data(), _mm256_div_ps(z_sum, _mm256_cvtepi32_ps(wsum)));
+
+    // A pixel is outside the triangle if any of its edge functions is negative
+    const __m256i sign = _mm256_or_si256(_mm256_or_si256(w[0], w[1]), w[2]);
+    span.coverage = ~_mm256_movemask_ps(_mm256_castsi256_ps(sign)) & 0xFF;
+}
+
+#endif // ARCHITECTURE_x86_64
+
+/// Selects the fastest span evaluation function supported by the host CPU
+static SpanFunction GetSpanFunction() {
+#ifdef ARCHITECTURE_x86_64
+    if (Common::GetCPUCaps().avx2)
+        return EvaluateSpanAVX2;
+    return EvaluateSpanSSE2;
+#else
+    return EvaluateSpanScalar;
+#endif
+}
+
 MICROPROFILE_DEFINE(GPU_Rasterization, "GPU", "Rasterization", MP_RGB(50, 50, 240));
 
+/// Incremented on every flush, since texture memory may only be modified in between flushes
+static u32 texture_generation = 0;
+
 /**
  * Helper function for ProcessTriangle with the "reversed" flag to allow for implementing
  * culling via recursion.
+ * @param bounds Rectangle (in pixels, right/bottom exclusive) to restrict rasterization to. Must
+ *               lie within the framebuffer.
+ * @param tile_cache Cache of decoded texture tiles, exclusive to the calling thread
  */
 static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
                                     const Shader::OutputVertex& v1,
                                     const Shader::OutputVertex& v2,
+                                    const MathUtil::Rectangle<int>& bounds,
+                                    TextureDecoder::TileCache& tile_cache,
                                     bool reversed = false)
 {
     const auto& regs = g_state.regs;
@@ -292,19 +451,7 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
     const auto& output_merger = regs.output_merger;
     MICROPROFILE_SCOPE(GPU_Rasterization);
 
-    // NOTE: Assuming that rasterizer coordinates are signed 12.4 fixed-point values.
-    //       This type is what PSP uses, we haven't tested what the 3DS uses.
-
     // vertex positions in rasterizer coordinates
-    static auto FloatToFix = [](float24 flt) {
-        // TODO: Rounding in Fix12P4::FromFloat is necessary to prevent garbage pixels at
-        //       triangle borders. Is it that the correct solution, though?
-        return Fix12P4::FromFloat(flt.ToFloat32());
-    };
-    static auto ScreenToRasterizerCoordinates = [](const Math::Vec3<float24>& vec) {
-        return Math::Vec3<Fix12P4>{FloatToFix(vec.x), FloatToFix(vec.y), FloatToFix(vec.z)};
-    };
-
     Math::Vec3<Fix12P4> vtxpos[3]{ ScreenToRasterizerCoordinates(v0.screenpos),
                                    ScreenToRasterizerCoordinates(v1.screenpos),
                                    ScreenToRasterizerCoordinates(v2.screenpos) };
@@ -312,13 +459,13 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
     if (regs.cull_mode == Regs::CullMode::KeepAll) {
         // Make sure we always end up with a triangle wound counter-clockwise
         if (!reversed && SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), vtxpos[2].xy()) <= 0) {
-            ProcessTriangleInternal(v0, v2, v1, true);
+            ProcessTriangleInternal(v0, v2, v1, bounds, tile_cache, true);
             return;
         }
     } else {
         if (!reversed && regs.cull_mode == Regs::CullMode::KeepClockWise) {
             // Reverse vertex order and use the CCW code path.
-            ProcessTriangleInternal(v0, v2, v1, true);
+            ProcessTriangleInternal(v0, v2, v1, bounds, tile_cache, true);
             return;
         }
 
@@ -340,11 +487,11 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
     max_x = max_x.Ceil();
     max_y = max_y.Ceil();
 
-    // Keep pixels inside framebuffer
-    min_x = std::max(min_x, Fix12P4::Zero());
-    min_y = std::max(min_y, Fix12P4::Zero());
-    max_x = std::min(max_x, Fix12P4::FromInt(framebuffer.GetWidth()));
-    max_y = std::min(max_y, Fix12P4::FromInt(framebuffer.GetHeight()));
+    // Keep pixels inside framebuffer (or inside the current tile when rasterizing tiled)
+    min_x = std::max(min_x, Fix12P4::FromInt(bounds.left));
+    min_y = std::max(min_y, Fix12P4::FromInt(bounds.top));
+    max_x = std::min(max_x, Fix12P4::FromInt(bounds.right));
+    max_y = std::min(max_y, Fix12P4::FromInt(bounds.bottom));
 
     // Triangle filling rules: Pixels on the right-sided edge or on flat bottom edges are not
     // drawn. Pixels on any other triangle border are drawn. This is implemented with three bias
@@ -376,40 +523,82 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
     auto textures = regs.GetTextures();
     auto tev_stages = regs.GetTevStages();
 
+    // Texture locations and layouts are constant across the triangle
+    std::array<u8*, 3> texture_data{};
+    std::array<DebugUtils::TextureInfo, 3> texture_info{};
+    for (int i = 0; i < 3; ++i) {
+        if (!textures[i].enabled)
+            continue;
+
+        texture_data[i] = Memory::GetPhysicalPointer(textures[i].config.GetPhysicalAddress());
+        texture_info[i] = DebugUtils::TextureInfo::FromPicaRegister(textures[i].config, textures[i].format);
+    }
+
+    // Not fully accurate. About 3 bits in precision are missing.
+    // Z-Buffer (z / w * scale + offset)
+    const float depth_scale = float24::FromRaw(regs.viewport_depth_range).ToFloat32();
+    const float depth_offset = float24::FromRaw(regs.viewport_depth_near_plane).ToFloat32();
+
     bool stencil_action_enable = output_merger.stencil_test.enable && framebuffer.depth_format == Regs::DepthFormat::D24S8;
     const auto stencil_test = output_merger.stencil_test;
 
+    static const SpanFunction evaluate_span = GetSpanFunction();
+
+    // Change of the edge functions when moving one pixel (16 units in 12.4 fixed point) to the right
+    SpanSetup span_setup;
+    span_setup.step = {{ -16 * (static_cast<s16>(vtxpos[2].y) - static_cast<s16>(vtxpos[1].y)),
+                         -16 * (static_cast<s16>(vtxpos[0].y) - static_cast<s16>(vtxpos[2].y)),
+                         -16 * (static_cast<s16>(vtxpos[1].y) - static_cast<s16>(vtxpos[0].y)) }};
+    span_setup.z = {{ v0.screenpos[2].ToFloat32(), v1.screenpos[2].ToFloat32(), v2.screenpos[2].ToFloat32() }};
+    SpanData span;
+
     // Enter rasterization loop, starting at the center of the topleft bounding box corner.
     // TODO: Not sure if looping through x first might be faster
     Fix12P4 pixel = Fix12P4::FromInt(1);
     Fix12P4 half_pixel = pixel / Fix12P4::FromInt(2);
+    const Fix12P4 start_x = min_x + half_pixel;
+    const int num_pixels_x = std::max(0, max_x.Int() - min_x.Int());
     for (Fix12P4 y = min_y + half_pixel; y < max_y; y += pixel) {
-        for (Fix12P4 x = min_x + half_pixel; x < max_x; x += pixel) {
-
-            // Calculate the barycentric coordinates w0, w1 and w2
-            int w0 = bias0 + SignedArea(vtxpos[1].xy(), vtxpos[2].xy(), {x, y});
-            int w1 = bias1 + SignedArea(vtxpos[2].xy(), vtxpos[0].xy(), {x, y});
-            int w2 = bias2 + SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), {x, y});
-            int wsum = w0 + w1 + w2;
+        // Edge function values at the first pixel of the row
+        span_setup.w = {{ bias0 + SignedArea(vtxpos[1].xy(), vtxpos[2].xy(), {start_x, y}),
+                          bias1 + SignedArea(vtxpos[2].xy(), vtxpos[0].xy(), {start_x, y}),
+                          bias2 + SignedArea(vtxpos[0].xy(), vtxpos[1].xy(), {start_x, y}) }};
+
+        for (int pixel_index = 0; pixel_index < num_pixels_x; ++pixel_index) {
+            const int span_index = pixel_index % SPAN_SIZE;
+            if (span_index == 0) {
+                evaluate_span(span_setup, span);
+                for (int edge = 0; edge < 3; ++edge)
+                    span_setup.w[edge] += SPAN_SIZE * span_setup.step[edge];
+
+                // Skip spans which don't cover any pixels at once
+                if (span.coverage == 0) {
+                    pixel_index += SPAN_SIZE - 1;
+                    continue;
+                }
+            }
 
             // If current pixel is not covered by the current primitive
-            if (w0 < 0 || w1 < 0 || w2 < 0)
+            if ((span.coverage & (1 << span_index)) == 0)
                 continue;
 
+            const Fix12P4 x = start_x + Fix12P4::FromInt(pixel_index);
+
+            // The barycentric coordinates w0, w1 and w2
+            int w0 = span.w[0][span_index];
+            int w1 = span.w[1][span_index];
+            int w2 = span.w[2][span_index];
+            int wsum = w0 + w1 + w2;
+
             auto baricentric_coordinates = Math::MakeVec(float24::FromFloat32(static_cast<float>(w0)),
                                                 float24::FromFloat32(static_cast<float>(w1)),
                                                 float24::FromFloat32(static_cast<float>(w2)));
             float24 interpolated_w_inverse = float24::FromFloat32(1.0f) / Math::Dot(w_inverse, baricentric_coordinates);
 
             // interpolated_z = z / w
-            float interpolated_z_over_w = (v0.screenpos[2].ToFloat32() * w0 +
-                                           v1.screenpos[2].ToFloat32() * w1 +
-                                           v2.screenpos[2].ToFloat32() * w2) / wsum;
+            float interpolated_z_over_w = span.z_over_w[span_index];
 
-            // Not fully accurate. About 3 bits in precision are missing.
             // Z-Buffer (z / w * scale + offset)
-            float depth_scale = float24::FromRaw(regs.viewport_depth_range).ToFloat32();
-            float depth_offset = float24::FromRaw(regs.viewport_depth_near_plane).ToFloat32();
             float depth = interpolated_z_over_w * depth_scale + depth_offset;
 
             // Potentially switch to W-Buffer
@@ -531,13 +720,11 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
                     s = GetWrappedTexCoord(texture.config.wrap_s, s, texture.config.width);
                     t = texture.config.height - 1 - GetWrappedTexCoord(texture.config.wrap_t, t, texture.config.height);
 
-                    u8* texture_data = Memory::GetPhysicalPointer(texture.config.GetPhysicalAddress());
-                    auto info = DebugUtils::TextureInfo::FromPicaRegister(texture.config, texture.format);
-
                     // TODO: Apply the min and mag filters to the texture
-                    texture_color[i] = DebugUtils::LookupTexture(texture_data, s, t, info);
+                    texture_color[i] = tile_cache.LookupTexel(texture_data[i], s, t, texture_info[i],
+                                                              texture_generation);
 #if PICA_DUMP_TEXTURES
-                    DebugUtils::DumpTexture(texture.config, texture_data);
+                    DebugUtils::DumpTexture(texture.config, texture_data[i]);
 #endif
                 }
             }
@@ -1206,10 +1393,170 @@ static void ProcessTriangleInternal(const Shader::OutputVertex& v0,
     }
 }
 
+// Tiled rasterization:
+// Instead of rasterizing each triangle right away, triangles are sorted into bins of fixed-size
+// screen tiles based on their bounding box. On flush, each non-empty tile is shaded on a worker
+// thread, processing its triangles in submission order while only touching pixels inside of the
+// tile. Since different tiles never share color, depth or stencil pixels and the per-pixel
+// operations within a tile happen in the original order, the result is identical to rasterizing
+// all triangles serially.
+
+/// Edge length of the square screen tiles triangles are binned into, in pixels
+static constexpr int TILE_SIZE = 32;
+
+MICROPROFILE_DEFINE(GPU_RasterizerBinning, "GPU", "Rasterizer Binning", MP_RGB(50, 50, 180));
+
+static std::unique_ptr<Common::ThreadPool> worker_pool;
+
+/// Triangles submitted since the last flush, in submission order
+static std::vector<std::array<Shader::OutputVertex, 3>> binned_triangles;
+
+/// Indices into binned_triangles of all triangles overlapping each tile, in submission order
+static std::vector<std::vector<u32>> tile_bins;
+
+/// Indices into tile_bins of the tiles being rasterized by the current flush
+static std::vector<int> pending_tiles;
+
+static int num_tiles_x = 0;
+static int num_tiles_y = 0;
+
+/// Caches of decoded texture tiles, one per worker so that they don't need to be synchronized
+static std::vector<std::unique_ptr<TextureDecoder::TileCache>> tile_caches;
+
+/// Returns the number of threads requested for rasterization, resolving the "automatic" setting
+static size_t GetNumRasterizerThreads() {
+    const int setting = VideoCore::g_sw_rasterizer_threads;
+    if (setting <= 0)
+        return Common::ThreadPool::DefaultThreadCount();
+    return static_cast<size_t>(setting);
+}
+
+static void BinTriangle(const Shader::OutputVertex& v0,
+                        const Shader::OutputVertex& v1,
+                        const Shader::OutputVertex& v2) {
+    MICROPROFILE_SCOPE(GPU_RasterizerBinning);
+
+    const MathUtil::Rectangle<int> framebuffer_bounds = GetFramebufferBounds();
+    const int tiles_x = (framebuffer_bounds.right + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles_y = (framebuffer_bounds.bottom + TILE_SIZE - 1) / TILE_SIZE;
+
+    // The framebuffer configuration can't change while triangles are pending, since any register
+    // write flushes the bins first.
+    if (binned_triangles.empty()) {
+        num_tiles_x = tiles_x;
+        num_tiles_y = tiles_y;
+        tile_bins.resize(tiles_x * tiles_y);
+    }
+    DEBUG_ASSERT(num_tiles_x == tiles_x && num_tiles_y == tiles_y);
+
+    // Use the same bounding box computation as ProcessTriangleInternal to find the covered tiles
+    const Math::Vec3<Fix12P4> vtxpos[3]{ ScreenToRasterizerCoordinates(v0.screenpos),
+                                         ScreenToRasterizerCoordinates(v1.screenpos),
+                                         ScreenToRasterizerCoordinates(v2.screenpos) };
+
+    const int min_x = std::max<int>(std::min({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x}).Floor().Int(),
+                                    framebuffer_bounds.left);
+    const int min_y = std::max<int>(std::min({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y}).Floor().Int(),
+                                    framebuffer_bounds.top);
+    const int max_x = std::min<int>(std::max({vtxpos[0].x, vtxpos[1].x, vtxpos[2].x}).Ceil().Int(),
+                                    framebuffer_bounds.right);
+    const int max_y = std::min<int>(std::max({vtxpos[0].y, vtxpos[1].y, vtxpos[2].y}).Ceil().Int(),
+                                    framebuffer_bounds.bottom);
+
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
+    const u32 triangle_index = static_cast<u32>(binned_triangles.size());
+    binned_triangles.push_back({{ v0, v1, v2 }});
+
+    for (int tile_y = min_y / TILE_SIZE; tile_y <= (max_y - 1) / TILE_SIZE; ++tile_y) {
+        for (int tile_x = min_x / TILE_SIZE; tile_x <= (max_x - 1) / TILE_SIZE; ++tile_x) {
+            tile_bins[tile_y * num_tiles_x + tile_x].push_back(triangle_index);
+        }
+    }
+}
+
+static void RasterizeTile(int tile_x, int tile_y, TextureDecoder::TileCache& tile_cache) {
+    const MathUtil::Rectangle<int> framebuffer_bounds = GetFramebufferBounds();
+    const MathUtil::Rectangle<int> tile_bounds{
+        tile_x * TILE_SIZE,
+        tile_y * TILE_SIZE,
+        std::min((tile_x + 1) * TILE_SIZE, framebuffer_bounds.right),
+        std::min((tile_y + 1) * TILE_SIZE, framebuffer_bounds.bottom)
+    };
+
+    auto& bin = tile_bins[tile_y * num_tiles_x + tile_x];
+    for (u32 triangle_index : bin) {
+        const auto& triangle = binned_triangles[triangle_index];
+        ProcessTriangleInternal(triangle[0], triangle[1], triangle[2], tile_bounds, tile_cache);
+    }
+    bin.clear();
+}
+
+/// Returns the tile cache for the given worker, where the emulation thread itself is worker 0
+static TextureDecoder::TileCache& GetTileCache(size_t worker) {
+    if (worker >= tile_caches.size())
+        tile_caches.resize(worker + 1);
+    if (!tile_caches[worker])
+        tile_caches[worker] = std::make_unique<TextureDecoder::TileCache>();
+    return *tile_caches[worker];
+}
+
 void ProcessTriangle(const Shader::OutputVertex& v0,
                      const Shader::OutputVertex& v1,
                      const Shader::OutputVertex& v2) {
-    ProcessTriangleInternal(v0, v1, v2);
+    // Only reconfigure the worker threads in between batches
+    if (binned_triangles.empty()) {
+        const size_t num_threads = GetNumRasterizerThreads();
+        if (num_threads <= 1) {
+            worker_pool.reset();
+            ProcessTriangleInternal(v0, v1, v2, GetFramebufferBounds(), GetTileCache(0));
+            return;
+        }
+
+        if (!worker_pool || worker_pool->NumThreads() != num_threads)
+            worker_pool = std::make_unique<Common::ThreadPool>(num_threads, "SwRasterizer");
+    }
+
+    BinTriangle(v0, v1, v2);
+}
+
+void FlushBinnedTriangles() {
+    ++texture_generation;
+
+    if (binned_triangles.empty())
+        return;
+
+    pending_tiles.clear();
+    for (int tile_index = 0; tile_index < num_tiles_x * num_tiles_y; ++tile_index) {
+        if (!tile_bins[tile_index].empty())
+            pending_tiles.push_back(tile_index);
+    }
+
+    // Each worker keeps taking the next pending tile, so that all of them stay busy even if the
+    // triangles are concentrated in a few tiles, while each one uses its own tile cache.
+    std::atomic<size_t> next_tile{0};
+    const size_t num_workers = std::min(worker_pool->NumThreads(), pending_tiles.size());
+    for (size_t worker = 0; worker < num_workers; ++worker) {
+        TextureDecoder::TileCache& tile_cache = GetTileCache(worker);
+        worker_pool->Push([&next_tile, &tile_cache] {
+            for (size_t i = next_tile++; i < pending_tiles.size(); i = next_tile++) {
+                const int tile_index = pending_tiles[i];
+                RasterizeTile(tile_index % num_tiles_x, tile_index / num_tiles_x, tile_cache);
+            }
+        });
+    }
+    worker_pool->WaitForIdle();
+
+    binned_triangles.clear();
+}
+
+void Shutdown() {
+    FlushBinnedTriangles();
+    worker_pool.reset();
+    binned_triangles.shrink_to_fit();
+    tile_bins.clear();
+    tile_caches.clear();
 }
 
 } // namespace Rasterizer
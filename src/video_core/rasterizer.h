@@ -12,10 +12,25 @@ namespace Shader {
 
 namespace Rasterizer {
 
+/**
+ * Rasterizes the given triangle. If the software rasterizer is configured to use multiple
+ * threads, the triangle is binned into screen tiles instead and only gets drawn by the next call
+ * to FlushBinnedTriangles.
+ */
 void ProcessTriangle(const Shader::OutputVertex& v0,
                      const Shader::OutputVertex& v1,
                      const Shader::OutputVertex& v2);
 
+/**
+ * Rasterizes all triangles binned since the last flush, blocking until they have been drawn.
+ * This must be called before modifying any state the rasterizer depends on (PICA registers,
+ * framebuffer or texture memory).
+ */
+void FlushBinnedTriangles();
+
+/// Flushes any pending triangles and releases the rasterizer worker threads
+void Shutdown();
+
 } // namespace Rasterizer
 
 } // namespace Pica
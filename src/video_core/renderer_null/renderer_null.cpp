@@ -0,0 +1,35 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <memory>
+
+#include "common/emu_window.h"
+
+#include "core/tracer/recorder.h"
+
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/swrasterizer.h"
+#include "video_core/renderer_null/renderer_null.h"
+
+void RendererNull::SwapBuffers() {
+    render_window->PollEvents();
+    m_current_frame++;
+
+    if (Pica::g_debug_context && Pica::g_debug_context->recorder) {
+        Pica::g_debug_context->recorder->FrameFinished();
+    }
+}
+
+void RendererNull::SetWindow(EmuWindow* window) {
+    render_window = window;
+}
+
+bool RendererNull::Init() {
+    // The hardware rasterizer setting is ignored, there is no OpenGL context to draw with
+    rasterizer = std::make_unique<VideoCore::SWRasterizer>();
+    return true;
+}
+
+void RendererNull::ShutDown() {
+}
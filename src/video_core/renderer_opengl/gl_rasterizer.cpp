@@ -169,6 +169,9 @@ void RasterizerOpenGL::DrawTriangles() {
 
     const auto& regs = Pica::g_state.regs;
 
+    // No surfaces from previous operations are held anymore, so the cache can shrink to its budget
+    res_cache.EvictSurfaces();
+
     // Sync and bind the framebuffer surfaces
     CachedSurface* color_surface;
     CachedSurface* depth_surface;
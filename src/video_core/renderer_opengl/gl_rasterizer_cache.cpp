@@ -3,20 +3,26 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstddef>
 #include <cstring>
 #include <iterator>
-#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <glad/glad.h>
 
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
 #include "common/bit_field.h"
 #include "common/emu_window.h"
 #include "common/logging/log.h"
 #include "common/math_util.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
 #include "common/vector_math.h"
 
 #include "core/memory.h"
@@ -25,6 +31,7 @@
 #include "video_core/pica_state.h"
 #include "video_core/renderer_opengl/gl_rasterizer_cache.h"
 #include "video_core/renderer_opengl/gl_state.h"
+#include "video_core/texture_decoder.h"
 #include "video_core/utils.h"
 #include "video_core/video_core.h"
 
@@ -49,16 +56,249 @@ static const std::array<FormatTuple, 4> depth_format_tuples = {{
     { GL_DEPTH24_STENCIL8,  GL_DEPTH_STENCIL,   GL_UNSIGNED_INT_24_8 }, // D24S8
 }};
 
+/**
+ * Key of a surface in the exact-match index. Surfaces are at most 1024 pixels wide and high, so the
+ * dimensions only get truncated for bogus configurations, and the key is just used to narrow down
+ * the candidates anyway.
+ */
+static u64 GetSurfaceKey(PAddr addr, u32 width, u32 height, CachedSurface::PixelFormat pixel_format) {
+    return (u64)addr | ((u64)(width & 0x7FF) << 32) | ((u64)(height & 0x7FF) << 43) | ((u64)pixel_format << 54);
+}
+
+/// Estimated size of the texture of a surface in host memory
+static u64 GetHostSize(const CachedSurface& surface) {
+    // Textures are decoded to RGBA8, and drivers tend to pad the other formats to 32 bits per pixel
+    return (u64)surface.GetScaledWidth() * surface.GetScaledHeight() * 4;
+}
+
 RasterizerCacheOpenGL::RasterizerCacheOpenGL() {
+    dirty_lru_tail = lru_list.end();
+
     transfer_framebuffers[0].Create();
     transfer_framebuffers[1].Create();
+
+    const size_t num_threads = Common::ThreadPool::DefaultThreadCount();
+    if (num_threads > 1) {
+        worker_pool = std::make_unique<Common::ThreadPool>(num_threads, "SurfaceCopy");
+    }
 }
 
 RasterizerCacheOpenGL::~RasterizerCacheOpenGL() {
     FlushAll();
 }
 
-static void MortonCopyPixels(CachedSurface::PixelFormat pixel_format, u32 width, u32 height, u32 bytes_per_pixel, u32 gl_bytes_per_pixel, u8* morton_data, u8* gl_data, bool morton_to_gl) {
+template <typename Func>
+void RasterizerCacheOpenGL::ForEachSurfaceInRegion(PAddr addr, u32 size, Func func) {
+    if (size == 0) {
+        return;
+    }
+
+    std::vector<CachedSurface*> overlapping;
+    auto range = surfaces_by_interval.equal_range(SurfaceInterval::right_open(addr, addr + size));
+    for (auto it = range.first; it != range.second; ++it) {
+        overlapping.insert(overlapping.end(), it->second.begin(), it->second.end());
+    }
+    if (overlapping.empty()) {
+        return;
+    }
+
+    // A surface spanning several intervals is found once per interval
+    std::sort(overlapping.begin(), overlapping.end());
+    overlapping.erase(std::unique(overlapping.begin(), overlapping.end()), overlapping.end());
+
+    // Visit the surfaces through their owners, in order of address and then of registration
+    std::vector<PAddr> start_addresses;
+    for (const CachedSurface* surface : overlapping) {
+        start_addresses.push_back(surface->addr);
+    }
+    std::sort(start_addresses.begin(), start_addresses.end());
+    start_addresses.erase(std::unique(start_addresses.begin(), start_addresses.end()), start_addresses.end());
+
+    for (PAddr start : start_addresses) {
+        auto owners = surfaces_by_addr.equal_range(start);
+        for (auto it = owners.first; it != owners.second; ++it) {
+            if (std::binary_search(overlapping.begin(), overlapping.end(), it->second.get())) {
+                func(it->second);
+            }
+        }
+    }
+}
+
+/// Width and height of the tiles of tiled surfaces, in pixels
+static constexpr u32 TILE_SIZE = 8;
+
+/// Surfaces smaller than this many pixels per worker thread are not split across threads
+static constexpr u32 MIN_PIXELS_PER_TASK = 16 * 1024;
+
+/// Position (y * TILE_SIZE + x) of the pixels of a tile, indexed by their Morton offset
+static const std::array<u8, TILE_SIZE * TILE_SIZE> morton_to_position = [] {
+    std::array<u8, TILE_SIZE * TILE_SIZE> table;
+    for (u32 y = 0; y < TILE_SIZE; ++y) {
+        for (u32 x = 0; x < TILE_SIZE; ++x) {
+            table[VideoCore::MortonInterleave(x, y)] = static_cast<u8>(y * TILE_SIZE + x);
+        }
+    }
+    return table;
+}();
+
+/// Size of a pixel in 3DS memory, for the formats that have tile kernels
+static constexpr u32 GetBytesPerPixel(CachedSurface::PixelFormat format) {
+    using PixelFormat = CachedSurface::PixelFormat;
+    return (format == PixelFormat::RGBA8 || format == PixelFormat::D24S8) ? 4 :
+           (format == PixelFormat::RGB8 || format == PixelFormat::D24) ? 3 : 2;
+}
+
+/// Size of a pixel in the buffers exchanged with OpenGL, which pad D24 to 32 bits
+static constexpr u32 GetGLBytesPerPixel(CachedSurface::PixelFormat format) {
+    return format == CachedSurface::PixelFormat::D24 ? 4 : GetBytesPerPixel(format);
+}
+
+/// Converts a D24S8 value between the 3DS layout (stencil in the top byte) and the OpenGL one (stencil in the bottom byte)
+template <bool morton_to_gl>
+static inline u32 SwapDepthStencil(u32 value) {
+    return morton_to_gl ? (value << 8) | (value >> 24) : (value << 24) | (value >> 8);
+}
+
+/**
+ * Copies the pixels of an 8x8 tile between 3DS memory and an OpenGL buffer.
+ * @param tile Pixels of the tile in 3DS memory, in Morton order
+ * @param gl_tile Top-left pixel of the tile in the OpenGL buffer
+ * @param gl_pitch Offset in bytes from a row of the tile to the next one in the OpenGL buffer, negative since OpenGL stores the rows bottom to top
+ */
+using MortonCopyTileFunc = void (*)(u8* tile, u8* gl_tile, ptrdiff_t gl_pitch);
+
+template <CachedSurface::PixelFormat format, bool morton_to_gl>
+static void MortonCopyTileScalar(u8* tile, u8* gl_tile, ptrdiff_t gl_pitch) {
+    constexpr u32 bytes_per_pixel = GetBytesPerPixel(format);
+    constexpr u32 gl_bytes_per_pixel = GetGLBytesPerPixel(format);
+
+    for (u32 i = 0; i < TILE_SIZE * TILE_SIZE; ++i) {
+        const u32 position = morton_to_position[i];
+        u8* morton_pixel = tile + i * bytes_per_pixel;
+        u8* gl_pixel = gl_tile + (position / TILE_SIZE) * gl_pitch + (position % TILE_SIZE) * gl_bytes_per_pixel;
+
+        u8* dst = morton_to_gl ? gl_pixel : morton_pixel;
+        const u8* src = morton_to_gl ? morton_pixel : gl_pixel;
+        if (format == CachedSurface::PixelFormat::D24S8) {
+            u32 depth_stencil;
+            memcpy(&depth_stencil, src, sizeof(u32));
+            depth_stencil = SwapDepthStencil<morton_to_gl>(depth_stencil);
+            memcpy(dst, &depth_stencil, sizeof(u32));
+        } else {
+            memcpy(dst, src, bytes_per_pixel);
+        }
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+// A 2x2 block of pixels is stored as two consecutive pixels of its bottom row followed by the two of
+// its top row, and horizontally adjacent blocks are consecutive within each 4x4 subtile. The SSE2
+// kernels thus always handle two rows at a time, interleaving or deinterleaving them 32 or 64 bits
+// at a time.
+
+template <CachedSurface::PixelFormat format, bool morton_to_gl>
+static inline __m128i ConvertPixels32SSE2(__m128i pixels) {
+    if (format != CachedSurface::PixelFormat::D24S8) {
+        return pixels;
+    }
+    if (morton_to_gl) {
+        return _mm_or_si128(_mm_slli_epi32(pixels, 8), _mm_srli_epi32(pixels, 24));
+    }
+    return _mm_or_si128(_mm_slli_epi32(pixels, 24), _mm_srli_epi32(pixels, 8));
+}
+
+template <CachedSurface::PixelFormat format, bool morton_to_gl>
+static void MortonCopyTile32SSE2(u8* tile, u8* gl_tile, ptrdiff_t gl_pitch) {
+    for (u32 y = 0; y < TILE_SIZE; y += 2) {
+        u8* gl_row0 = gl_tile + y * gl_pitch;
+        u8* gl_row1 = gl_row0 + gl_pitch;
+
+        for (u32 x = 0; x < TILE_SIZE; x += 4) {
+            // Two adjacent 2x2 blocks, i.e. four pixels of two rows
+            u8* blocks = tile + VideoCore::MortonInterleave(x, y) * 4;
+
+            if (morton_to_gl) {
+                __m128i block0 = ConvertPixels32SSE2<format, true>(_mm_loadu_si128((const __m128i*)blocks));
+                __m128i block1 = ConvertPixels32SSE2<format, true>(_mm_loadu_si128((const __m128i*)(blocks + 16)));
+                _mm_storeu_si128((__m128i*)(gl_row0 + x * 4), _mm_unpacklo_epi64(block0, block1));
+                _mm_storeu_si128((__m128i*)(gl_row1 + x * 4), _mm_unpackhi_epi64(block0, block1));
+            } else {
+                __m128i row0 = ConvertPixels32SSE2<format, false>(_mm_loadu_si128((const __m128i*)(gl_row0 + x * 4)));
+                __m128i row1 = ConvertPixels32SSE2<format, false>(_mm_loadu_si128((const __m128i*)(gl_row1 + x * 4)));
+                _mm_storeu_si128((__m128i*)blocks, _mm_unpacklo_epi64(row0, row1));
+                _mm_storeu_si128((__m128i*)(blocks + 16), _mm_unpackhi_epi64(row0, row1));
+            }
+        }
+    }
+}
+
+template <bool morton_to_gl>
+static void MortonCopyTile16SSE2(u8* tile, u8* gl_tile, ptrdiff_t gl_pitch) {
+    for (u32 y = 0; y < TILE_SIZE; y += 2) {
+        u8* gl_row0 = gl_tile + y * gl_pitch;
+        u8* gl_row1 = gl_row0 + gl_pitch;
+
+        // Each half holds two adjacent 2x2 blocks, i.e. four pixels of two rows. Swapping the middle
+        // two pixel pairs converts between the row pairs of the blocks and whole rows, either way.
+        u8* left_blocks = tile + VideoCore::MortonInterleave(0, y) * 2;
+        u8* right_blocks = tile + VideoCore::MortonInterleave(4, y) * 2;
+
+        if (morton_to_gl) {
+            __m128i left = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)left_blocks), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i right = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)right_blocks), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i*)gl_row0, _mm_unpacklo_epi64(left, right));
+            _mm_storeu_si128((__m128i*)gl_row1, _mm_unpackhi_epi64(left, right));
+        } else {
+            __m128i row0 = _mm_loadu_si128((const __m128i*)gl_row0);
+            __m128i row1 = _mm_loadu_si128((const __m128i*)gl_row1);
+            _mm_storeu_si128((__m128i*)left_blocks, _mm_shuffle_epi32(_mm_unpacklo_epi64(row0, row1), _MM_SHUFFLE(3, 1, 2, 0)));
+            _mm_storeu_si128((__m128i*)right_blocks, _mm_shuffle_epi32(_mm_unpackhi_epi64(row0, row1), _MM_SHUFFLE(3, 1, 2, 0)));
+        }
+    }
+}
+
+#endif // ARCHITECTURE_x86_64
+
+/// Returns the tile kernel for the format, or nullptr if it has none
+template <bool morton_to_gl>
+static MortonCopyTileFunc GetMortonCopyTileFunc(CachedSurface::PixelFormat format) {
+    using PixelFormat = CachedSurface::PixelFormat;
+
+    switch (format) {
+#ifdef ARCHITECTURE_x86_64
+    case PixelFormat::RGBA8:
+        return MortonCopyTile32SSE2<PixelFormat::RGBA8, morton_to_gl>;
+    case PixelFormat::D24S8:
+        return MortonCopyTile32SSE2<PixelFormat::D24S8, morton_to_gl>;
+    case PixelFormat::RGB5A1:
+    case PixelFormat::RGB565:
+    case PixelFormat::RGBA4:
+    case PixelFormat::D16:
+        return MortonCopyTile16SSE2<morton_to_gl>;
+#else
+    case PixelFormat::RGBA8:
+        return MortonCopyTileScalar<PixelFormat::RGBA8, morton_to_gl>;
+    case PixelFormat::D24S8:
+        return MortonCopyTileScalar<PixelFormat::D24S8, morton_to_gl>;
+    case PixelFormat::RGB5A1:
+    case PixelFormat::RGB565:
+    case PixelFormat::RGBA4:
+    case PixelFormat::D16:
+        // None of the 16-bit formats need any conversion
+        return MortonCopyTileScalar<PixelFormat::D16, morton_to_gl>;
+#endif
+    case PixelFormat::RGB8:
+        return MortonCopyTileScalar<PixelFormat::RGB8, morton_to_gl>;
+    case PixelFormat::D24:
+        return MortonCopyTileScalar<PixelFormat::D24, morton_to_gl>;
+    default:
+        return nullptr;
+    }
+}
+
+/// Copies pixels one at a time, which works for any surface size
+static void MortonCopyPixelsGeneric(CachedSurface::PixelFormat pixel_format, u32 width, u32 height, u32 bytes_per_pixel, u32 gl_bytes_per_pixel, u8* morton_data, u8* gl_data, bool morton_to_gl) {
     using PixelFormat = CachedSurface::PixelFormat;
 
     u8* data_ptrs[2];
@@ -102,6 +342,52 @@ static void MortonCopyPixels(CachedSurface::PixelFormat pixel_format, u32 width,
     }
 }
 
+/**
+ * Converts a surface between the tiled layout of 3DS memory and the linear, bottom to top layout of
+ * OpenGL, splitting large surfaces into bands of tile rows processed by the worker threads.
+ */
+static void MortonCopyPixels(Common::ThreadPool* worker_pool, CachedSurface::PixelFormat pixel_format, u32 width, u32 height, u32 bytes_per_pixel, u32 gl_bytes_per_pixel, u8* morton_data, u8* gl_data, bool morton_to_gl) {
+    MortonCopyTileFunc copy_tile = morton_to_gl ? GetMortonCopyTileFunc<true>(pixel_format) : GetMortonCopyTileFunc<false>(pixel_format);
+    if (copy_tile == nullptr || width % TILE_SIZE != 0 || height % TILE_SIZE != 0) {
+        MortonCopyPixelsGeneric(pixel_format, width, height, bytes_per_pixel, gl_bytes_per_pixel, morton_data, gl_data, morton_to_gl);
+        return;
+    }
+
+    const u32 tiles_per_row = width / TILE_SIZE;
+    const u32 tile_rows = height / TILE_SIZE;
+    const u32 bytes_per_tile = TILE_SIZE * TILE_SIZE * bytes_per_pixel;
+    const ptrdiff_t gl_pitch = -(ptrdiff_t)(width * gl_bytes_per_pixel);
+
+    auto copy_tile_rows = [=](u32 first_tile_row, u32 last_tile_row) {
+        for (u32 tile_row = first_tile_row; tile_row < last_tile_row; ++tile_row) {
+            u8* tile = morton_data + tile_row * tiles_per_row * bytes_per_tile;
+            u8* gl_tile = gl_data + (height - 1 - tile_row * TILE_SIZE) * width * gl_bytes_per_pixel;
+            for (u32 x = 0; x < tiles_per_row; ++x) {
+                copy_tile(tile, gl_tile, gl_pitch);
+                tile += bytes_per_tile;
+                gl_tile += TILE_SIZE * gl_bytes_per_pixel;
+            }
+        }
+    };
+
+    size_t num_tasks = 1;
+    if (worker_pool != nullptr) {
+        num_tasks = std::min<size_t>({ worker_pool->NumThreads(), tile_rows, width * height / MIN_PIXELS_PER_TASK });
+    }
+
+    if (num_tasks <= 1) {
+        copy_tile_rows(0, tile_rows);
+        return;
+    }
+
+    for (size_t task = 0; task < num_tasks; ++task) {
+        const u32 first_tile_row = static_cast<u32>(tile_rows * task / num_tasks);
+        const u32 last_tile_row = static_cast<u32>(tile_rows * (task + 1) / num_tasks);
+        worker_pool->Push([&copy_tile_rows, first_tile_row, last_tile_row] { copy_tile_rows(first_tile_row, last_tile_row); });
+    }
+    worker_pool->WaitForIdle();
+}
+
 bool RasterizerCacheOpenGL::BlitTextures(GLuint src_tex, GLuint dst_tex, CachedSurface::SurfaceType type, const MathUtil::Rectangle<int>& src_rect, const MathUtil::Rectangle<int>& dst_rect) {
     using SurfaceType = CachedSurface::SurfaceType;
 
@@ -231,27 +517,24 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
     CachedSurface* best_exact_surface = nullptr;
     float exact_surface_goodness = -1.f;
 
-    auto surface_interval = boost::icl::interval<PAddr>::right_open(params.addr, params.addr + params_size);
-    auto range = surface_cache.equal_range(surface_interval);
+    auto range = surfaces_by_params.equal_range(GetSurfaceKey(params.addr, params.width, params.height, params.pixel_format));
     for (auto it = range.first; it != range.second; ++it) {
-        for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-            CachedSurface* surface = it2->get();
-
-            // Check if the request matches the surface exactly
-            if (params.addr == surface->addr &&
-                params.width == surface->width && params.height == surface->height &&
-                params.pixel_format == surface->pixel_format)
-            {
-                // Make sure optional param-matching criteria are fulfilled
-                bool tiling_match = (params.is_tiled == surface->is_tiled);
-                bool res_scale_match = (params.res_scale_width == surface->res_scale_width && params.res_scale_height == surface->res_scale_height);
-                if (!match_res_scale || res_scale_match) {
-                    // Prioritize same-tiling and highest resolution surfaces
-                    float match_goodness = (float)tiling_match + surface->res_scale_width * surface->res_scale_height;
-                    if (match_goodness > exact_surface_goodness || surface->dirty) {
-                        exact_surface_goodness = match_goodness;
-                        best_exact_surface = surface;
-                    }
+        CachedSurface* surface = it->second;
+
+        // Check if the request matches the surface exactly
+        if (params.addr == surface->addr &&
+            params.width == surface->width && params.height == surface->height &&
+            params.pixel_format == surface->pixel_format)
+        {
+            // Make sure optional param-matching criteria are fulfilled
+            bool tiling_match = (params.is_tiled == surface->is_tiled);
+            bool res_scale_match = (params.res_scale_width == surface->res_scale_width && params.res_scale_height == surface->res_scale_height);
+            if (!match_res_scale || res_scale_match) {
+                // Prioritize same-tiling and highest resolution surfaces
+                float match_goodness = (float)tiling_match + surface->res_scale_width * surface->res_scale_height;
+                if (match_goodness > exact_surface_goodness || surface->dirty) {
+                    exact_surface_goodness = match_goodness;
+                    best_exact_surface = surface;
                 }
             }
         }
@@ -259,6 +542,7 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
 
     // Return the best exact surface if found
     if (best_exact_surface != nullptr) {
+        TouchSurface(best_exact_surface);
         return best_exact_surface;
     }
 
@@ -330,11 +614,7 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
                 tex_info.format = (Pica::Regs::TextureFormat)params.pixel_format;
                 tex_info.physical_address = params.addr;
 
-                for (unsigned y = 0; y < params.height; ++y) {
-                    for (unsigned x = 0; x < params.width; ++x) {
-                        tex_buffer[x + params.width * y] = Pica::DebugUtils::LookupTexture(texture_src_data, x, params.height - 1 - y, tex_info);
-                    }
-                }
+                Pica::TextureDecoder::DecodeTexture(tex_info, texture_src_data, tex_buffer.data(), true);
 
                 glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width, params.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_buffer.data());
             } else {
@@ -354,7 +634,7 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
 
                 u8* temp_fb_depth_buffer_ptr = use_4bpp ? temp_fb_depth_buffer.data() + 1 : temp_fb_depth_buffer.data();
 
-                MortonCopyPixels(params.pixel_format, params.width, params.height, bytes_per_pixel, gl_bytes_per_pixel, texture_src_data, temp_fb_depth_buffer_ptr, true);
+                MortonCopyPixels(worker_pool.get(), params.pixel_format, params.width, params.height, bytes_per_pixel, gl_bytes_per_pixel, texture_src_data, temp_fb_depth_buffer_ptr, true);
 
                 glTexImage2D(GL_TEXTURE_2D, 0, tuple.internal_format, params.width, params.height, 0,
                              tuple.format, tuple.type, temp_fb_depth_buffer.data());
@@ -388,9 +668,9 @@ CachedSurface* RasterizerCacheOpenGL::GetSurface(const CachedSurface& params, bo
         cur_state.Apply();
     }
 
-    Memory::RasterizerMarkRegionCached(new_surface->addr, new_surface->size, 1);
-    surface_cache.add(std::make_pair(boost::icl::interval<PAddr>::right_open(new_surface->addr, new_surface->addr + new_surface->size), std::set<std::shared_ptr<CachedSurface>>({ new_surface })));
-    return new_surface.get();
+    CachedSurface* surface = new_surface.get();
+    RegisterSurface(std::move(new_surface));
+    return surface;
 }
 
 CachedSurface* RasterizerCacheOpenGL::GetSurfaceRect(const CachedSurface& params, bool match_res_scale, bool load_if_create, MathUtil::Rectangle<int>& out_rect) {
@@ -405,34 +685,32 @@ CachedSurface* RasterizerCacheOpenGL::GetSurfaceRect(const CachedSurface& params
     CachedSurface* best_subrect_surface = nullptr;
     float subrect_surface_goodness = -1.f;
 
-    auto surface_interval = boost::icl::interval<PAddr>::right_open(params.addr, params.addr + params_size);
-    auto cache_upper_bound = surface_cache.upper_bound(surface_interval);
-    for (auto it = surface_cache.lower_bound(surface_interval); it != cache_upper_bound; ++it) {
-        for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-            CachedSurface* surface = it2->get();
-
-            // Check if the request is contained in the surface
-            if (params.addr >= surface->addr &&
-                params.addr + params_size - 1 <= surface->addr + surface->size - 1 &&
-                params.pixel_format == surface->pixel_format)
-            {
-                // Make sure optional param-matching criteria are fulfilled
-                bool tiling_match = (params.is_tiled == surface->is_tiled);
-                bool res_scale_match = (params.res_scale_width == surface->res_scale_width && params.res_scale_height == surface->res_scale_height);
-                if (!match_res_scale || res_scale_match) {
-                    // Prioritize same-tiling and highest resolution surfaces
-                    float match_goodness = (float)tiling_match + surface->res_scale_width * surface->res_scale_height;
-                    if (match_goodness > subrect_surface_goodness || surface->dirty) {
-                        subrect_surface_goodness = match_goodness;
-                        best_subrect_surface = surface;
-                    }
+    ForEachSurfaceInRegion(params.addr, params_size, [&](const std::shared_ptr<CachedSurface>& cached_surface) {
+        CachedSurface* surface = cached_surface.get();
+
+        // Check if the request is contained in the surface
+        if (params.addr >= surface->addr &&
+            params.addr + params_size - 1 <= surface->addr + surface->size - 1 &&
+            params.pixel_format == surface->pixel_format)
+        {
+            // Make sure optional param-matching criteria are fulfilled
+            bool tiling_match = (params.is_tiled == surface->is_tiled);
+            bool res_scale_match = (params.res_scale_width == surface->res_scale_width && params.res_scale_height == surface->res_scale_height);
+            if (!match_res_scale || res_scale_match) {
+                // Prioritize same-tiling and highest resolution surfaces
+                float match_goodness = (float)tiling_match + surface->res_scale_width * surface->res_scale_height;
+                if (match_goodness > subrect_surface_goodness || surface->dirty) {
+                    subrect_surface_goodness = match_goodness;
+                    best_subrect_surface = surface;
                 }
             }
         }
-    }
+    });
 
     // Return the best subrect surface if found
     if (best_subrect_surface != nullptr) {
+        TouchSurface(best_subrect_surface);
+
         unsigned int bytes_per_pixel = (CachedSurface::GetFormatBpp(best_subrect_surface->pixel_format) / 8);
 
         int x0, y0;
@@ -564,27 +842,28 @@ std::tuple<CachedSurface*, CachedSurface*, MathUtil::Rectangle<int>> RasterizerC
 }
 
 CachedSurface* RasterizerCacheOpenGL::TryGetFillSurface(const GPU::Regs::MemoryFillConfig& config) {
-    auto surface_interval = boost::icl::interval<PAddr>::right_open(config.GetStartAddress(), config.GetEndAddress());
-    auto range = surface_cache.equal_range(surface_interval);
-    for (auto it = range.first; it != range.second; ++it) {
-        for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-            int bits_per_value = 0;
-            if (config.fill_24bit) {
-                bits_per_value = 24;
-            } else if (config.fill_32bit) {
-                bits_per_value = 32;
-            } else {
-                bits_per_value = 16;
-            }
+    if (config.GetEndAddress() <= config.GetStartAddress()) {
+        return nullptr;
+    }
 
-            CachedSurface* surface = it2->get();
+    int bits_per_value = 0;
+    if (config.fill_24bit) {
+        bits_per_value = 24;
+    } else if (config.fill_32bit) {
+        bits_per_value = 32;
+    } else {
+        bits_per_value = 16;
+    }
 
-            if (surface->addr == config.GetStartAddress() &&
-                CachedSurface::GetFormatBpp(surface->pixel_format) == bits_per_value &&
-                (surface->width * surface->height * CachedSurface::GetFormatBpp(surface->pixel_format) / 8) == (config.GetEndAddress() - config.GetStartAddress()))
-            {
-                return surface;
-            }
+    auto range = surfaces_by_addr.equal_range(config.GetStartAddress());
+    for (auto it = range.first; it != range.second; ++it) {
+        CachedSurface* surface = it->second.get();
+
+        if (CachedSurface::GetFormatBpp(surface->pixel_format) == bits_per_value &&
+            (surface->width * surface->height * CachedSurface::GetFormatBpp(surface->pixel_format) / 8) == (config.GetEndAddress() - config.GetStartAddress()))
+        {
+            TouchSurface(surface);
+            return surface;
         }
     }
 
@@ -649,7 +928,7 @@ void RasterizerCacheOpenGL::FlushSurface(CachedSurface* surface) {
             glGetTexImage(GL_TEXTURE_2D, 0, tuple.format, tuple.type, temp_gl_buffer.data());
 
             // Directly copy pixels. Internal OpenGL color formats are consistent so no conversion is necessary.
-            MortonCopyPixels(surface->pixel_format, surface->width, surface->height, bytes_per_pixel, bytes_per_pixel, dst_buffer, temp_gl_buffer.data(), false);
+            MortonCopyPixels(worker_pool.get(), surface->pixel_format, surface->width, surface->height, bytes_per_pixel, bytes_per_pixel, dst_buffer, temp_gl_buffer.data(), false);
         } else {
             // Depth/Stencil formats need special treatment since they aren't sampleable using LookupTexture and can't use RGBA format
             size_t tuple_idx = (size_t)surface->pixel_format - 14;
@@ -669,12 +948,14 @@ void RasterizerCacheOpenGL::FlushSurface(CachedSurface* surface) {
 
             u8* temp_gl_buffer_ptr = use_4bpp ? temp_gl_buffer.data() + 1 : temp_gl_buffer.data();
 
-            MortonCopyPixels(surface->pixel_format, surface->width, surface->height, bytes_per_pixel, gl_bytes_per_pixel, dst_buffer, temp_gl_buffer_ptr, false);
+            MortonCopyPixels(worker_pool.get(), surface->pixel_format, surface->width, surface->height, bytes_per_pixel, gl_bytes_per_pixel, dst_buffer, temp_gl_buffer_ptr, false);
         }
     }
     glPixelStorei(GL_PACK_ROW_LENGTH, 0);
 
     surface->dirty = false;
+    // The surface may be in the dirty tail of the LRU list, which has to be walked again
+    dirty_lru_tail = lru_list.end();
 
     cur_state.texture_units[0].texture_2d = old_tex;
     cur_state.Apply();
@@ -685,30 +966,100 @@ void RasterizerCacheOpenGL::FlushRegion(PAddr addr, u32 size, const CachedSurfac
         return;
     }
 
-    // Gather up unique surfaces that touch the region
-    std::unordered_set<std::shared_ptr<CachedSurface>> touching_surfaces;
-
-    auto surface_interval = boost::icl::interval<PAddr>::right_open(addr, addr + size);
-    auto cache_upper_bound = surface_cache.upper_bound(surface_interval);
-    for (auto it = surface_cache.lower_bound(surface_interval); it != cache_upper_bound; ++it) {
-        std::copy_if(it->second.begin(), it->second.end(), std::inserter(touching_surfaces, touching_surfaces.end()),
-            [skip_surface](std::shared_ptr<CachedSurface> surface) { return (surface.get() != skip_surface); });
-    }
+    // Gather up the surfaces that touch the region first, since invalidating them modifies the index
+    std::vector<std::shared_ptr<CachedSurface>> touching_surfaces;
+    ForEachSurfaceInRegion(addr, size, [&](const std::shared_ptr<CachedSurface>& surface) {
+        if (surface.get() != skip_surface) {
+            touching_surfaces.push_back(surface);
+        }
+    });
 
     // Flush and invalidate surfaces
-    for (auto surface : touching_surfaces) {
+    for (const auto& surface : touching_surfaces) {
         FlushSurface(surface.get());
         if (invalidate) {
-            Memory::RasterizerMarkRegionCached(surface->addr, surface->size, -1);
-            surface_cache.subtract(std::make_pair(boost::icl::interval<PAddr>::right_open(surface->addr, surface->addr + surface->size), std::set<std::shared_ptr<CachedSurface>>({ surface })));
+            UnregisterSurface(surface.get());
         }
     }
 }
 
 void RasterizerCacheOpenGL::FlushAll() {
-    for (auto& surfaces : surface_cache) {
-        for (auto& surface : surfaces.second) {
-            FlushSurface(surface.get());
+    for (auto& entry : surfaces_by_addr) {
+        FlushSurface(entry.second.get());
+    }
+}
+
+void RasterizerCacheOpenGL::EvictSurfaces() {
+    const int budget_mib = VideoCore::g_surface_cache_size;
+    if (budget_mib <= 0) {
+        return;
+    }
+
+    const u64 budget = (u64)budget_mib * 1024 * 1024;
+
+    // Dirty surfaces hold the only up-to-date copy of their data, so they stay until flushed. The
+    // dirty surfaces found at the end of the list are remembered, so that they aren't walked again
+    // on every draw while they can't be evicted.
+    auto it = dirty_lru_tail;
+    while (cached_bytes > budget && it != lru_list.begin()) {
+        auto candidate = std::prev(it);
+        if ((*candidate)->dirty) {
+            it = candidate;
+        } else {
+            UnregisterSurface(*candidate);
+        }
+    }
+    dirty_lru_tail = it;
+}
+
+void RasterizerCacheOpenGL::RegisterSurface(std::shared_ptr<CachedSurface> surface) {
+    Memory::RasterizerMarkRegionCached(surface->addr, surface->size, 1);
+
+    cached_bytes += GetHostSize(*surface);
+
+    lru_list.push_front(surface.get());
+    surface->lru_position = lru_list.begin();
+
+    surfaces_by_params.emplace(GetSurfaceKey(surface->addr, surface->width, surface->height, surface->pixel_format), surface.get());
+    surfaces_by_interval.add(std::make_pair(SurfaceInterval::right_open(surface->addr, surface->addr + surface->size),
+                                            std::set<CachedSurface*>{ surface.get() }));
+    surfaces_by_addr.emplace(surface->addr, std::move(surface));
+}
+
+void RasterizerCacheOpenGL::UnregisterSurface(CachedSurface* surface) {
+    Memory::RasterizerMarkRegionCached(surface->addr, surface->size, -1);
+
+    cached_bytes -= GetHostSize(*surface);
+    // The surfaces after this one in the dirty tail are still dirty
+    if (surface->lru_position == dirty_lru_tail) {
+        ++dirty_lru_tail;
+    }
+    lru_list.erase(surface->lru_position);
+
+    surfaces_by_interval.subtract(std::make_pair(SurfaceInterval::right_open(surface->addr, surface->addr + surface->size),
+                                                 std::set<CachedSurface*>{ surface }));
+
+    auto params_range = surfaces_by_params.equal_range(GetSurfaceKey(surface->addr, surface->width, surface->height, surface->pixel_format));
+    for (auto it = params_range.first; it != params_range.second; ++it) {
+        if (it->second == surface) {
+            surfaces_by_params.erase(it);
+            break;
+        }
+    }
+
+    // Erased last, as this drops the cache's reference to the surface
+    auto addr_range = surfaces_by_addr.equal_range(surface->addr);
+    for (auto it = addr_range.first; it != addr_range.second; ++it) {
+        if (it->second.get() == surface) {
+            surfaces_by_addr.erase(it);
+            break;
         }
     }
 }
+
+void RasterizerCacheOpenGL::TouchSurface(CachedSurface* surface) {
+    if (surface->lru_position == dirty_lru_tail) {
+        ++dirty_lru_tail;
+    }
+    lru_list.splice(lru_list.begin(), lru_list, surface->lru_position);
+}
@@ -5,9 +5,12 @@
 #pragma once
 
 #include <array>
+#include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <tuple>
+#include <unordered_map>
 
 #include <boost/icl/interval_map.hpp>
 #include <glad/glad.h>
@@ -21,14 +24,14 @@
 #include "video_core/pica.h"
 #include "video_core/renderer_opengl/gl_resource_manager.h"
 
+namespace Common {
+class ThreadPool;
+}
+
 namespace MathUtil {
 template <class T> struct Rectangle;
 }
 
-struct CachedSurface;
-
-using SurfaceCache = boost::icl::interval_map<PAddr, std::set<std::shared_ptr<CachedSurface>>>;
-
 struct CachedSurface {
     enum class PixelFormat {
         // First 5 formats are shared between textures and color buffers
@@ -179,6 +182,9 @@ struct CachedSurface {
     bool is_tiled;
     PixelFormat pixel_format;
     bool dirty;
+
+    /// Position of the surface in the cache's LRU list
+    std::list<CachedSurface*>::iterator lru_position;
 };
 
 class RasterizerCacheOpenGL : NonCopyable {
@@ -216,7 +222,45 @@ public:
     /// Flush all cached resources tracked by this cache manager
     void FlushAll();
 
+    /**
+     * Evicts the least recently used clean surfaces until the cache fits in its memory budget. Must
+     * only be called when none of the surfaces returned by the cache are in use anymore.
+     */
+    void EvictSurfaces();
+
 private:
-    SurfaceCache surface_cache;
+    /// Adds a new surface to the cache
+    void RegisterSurface(std::shared_ptr<CachedSurface> surface);
+
+    /// Removes a surface from the cache, destroying it unless it is referenced elsewhere
+    void UnregisterSurface(CachedSurface* surface);
+
+    /// Marks a surface as the most recently used one
+    void TouchSurface(CachedSurface* surface);
+
+    /// Calls func on each cached surface overlapping the region, in order of address
+    template <typename Func>
+    void ForEachSurfaceInRegion(PAddr addr, u32 size, Func func);
+
+    using SurfaceIntervalMap = boost::icl::interval_map<PAddr, std::set<CachedSurface*>>;
+    using SurfaceInterval = SurfaceIntervalMap::interval_type;
+
+    /// Surfaces sorted by start address, which own the cached surfaces
+    std::multimap<PAddr, std::shared_ptr<CachedSurface>> surfaces_by_addr;
+    /// Surfaces covering each address range, for looking up the surfaces overlapping a region
+    SurfaceIntervalMap surfaces_by_interval;
+    /// Surfaces by address, size and format, for exact matches
+    std::unordered_multimap<u64, CachedSurface*> surfaces_by_params;
+    /// Surfaces from most to least recently used
+    std::list<CachedSurface*> lru_list;
+    /// Start of the least recently used surfaces that were all dirty when last considered for
+    /// eviction, lru_list.end() if unknown. Flushing a surface resets it.
+    std::list<CachedSurface*>::iterator dirty_lru_tail;
+    /// Estimated host memory used by the textures of the cached surfaces, in bytes
+    u64 cached_bytes = 0;
+
     OGLFramebuffer transfer_framebuffers[2];
+
+    /// Threads converting large surfaces between the tiled and linear layouts, if worthwhile
+    std::unique_ptr<Common::ThreadPool> worker_pool;
 };
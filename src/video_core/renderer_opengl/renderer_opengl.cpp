@@ -112,6 +112,9 @@ void RendererOpenGL::SwapBuffers() {
     OpenGLState prev_state = OpenGLState::GetCurState();
     state.Apply();
 
+    // The framebuffers may be displayed from cached surfaces, which must reflect CPU writes
+    Memory::RasterizerInvalidatePendingWrites();
+
     for (int i : {0, 1}) {
         const auto& framebuffer = GPU::g_regs.framebuffer_config[i];
 
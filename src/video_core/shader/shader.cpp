@@ -2,9 +2,15 @@
 // Licensed under GPLv2 or any later version
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <atomic>
+#include <cinttypes>
+#include <chrono>
 #include <cmath>
 #include <cstring>
+#include <future>
+#include <list>
+#include <memory>
 #include <unordered_map>
 #include <utility>
 
@@ -14,6 +20,9 @@
 #include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/microprofile.h"
+#include "common/thread_pool.h"
+
+#include "core/hle/kernel/process.h"
 
 #include "video_core/pica.h"
 #include "video_core/pica_state.h"
@@ -21,7 +30,9 @@
 #include "video_core/shader/shader_interpreter.h"
 
 #ifdef ARCHITECTURE_x86_64
+#include "video_core/shader/shader_jit_disk_cache.h"
 #include "video_core/shader/shader_jit_x64.h"
+#include "video_core/shader/shader_jit_x64_batch.h"
 #endif // ARCHITECTURE_x86_64
 
 #include "video_core/video_core.h"
@@ -82,13 +93,269 @@ OutputVertex OutputRegisters::ToVertex(const Regs::ShaderConfig& config) {
     return ret;
 }
 
+void BatchUnitState::Initialize(const UnitState<false>& state) {
+    for (unsigned reg = 0; reg < 16; ++reg) {
+        for (unsigned comp = 0; comp < 4; ++comp) {
+            for (unsigned lane = 0; lane < SHADER_BATCH_SIZE; ++lane) {
+                registers.input[reg].comp[comp][lane] = state.registers.input[reg][comp];
+                registers.temporary[reg].comp[comp][lane] = state.registers.temporary[reg][comp];
+                registers.output[reg].comp[comp][lane] = state.output_registers.value[reg][comp];
+            }
+        }
+    }
+}
+
+void BatchUnitState::LoadInput(unsigned lane, const InputVertex& input, int num_attributes, const Regs::ShaderConfig& config) {
+    const auto& attribute_register_map = config.input_register_map;
+
+    for (int i = 0; i < num_attributes; i++) {
+        Register& reg = registers.input[attribute_register_map.GetRegisterForAttribute(i)];
+        for (unsigned comp = 0; comp < 4; ++comp)
+            reg.comp[comp][lane] = input.attr[i][comp];
+    }
+}
+
+void BatchUnitState::StoreOutput(unsigned lane, OutputRegisters& output) const {
+    for (unsigned reg = 0; reg < 16; ++reg) {
+        for (unsigned comp = 0; comp < 4; ++comp)
+            output.value[reg][comp] = registers.output[reg].comp[comp][lane];
+    }
+}
+
 #ifdef ARCHITECTURE_x86_64
-static std::unordered_map<u64, std::shared_ptr<JitShader>> shader_map;
+MICROPROFILE_DEFINE(GPU_ShaderCompile, "GPU", "Shader Compile", MP_RGB(50, 50, 160));
+
+/**
+ * Compiled shaders by cache key, evicting the least recently used ones once the size of their code
+ * exceeds the given budget. Evicted shaders are freed as soon as they are no longer being run.
+ */
+template <typename T>
+class JitShaderCache {
+public:
+    explicit JitShaderCache(size_t max_code_size) : max_code_size(max_code_size) {}
+
+    /**
+     * Looks up a shader, marking it as the most recently used one
+     * @return False if the cache has no entry for the key
+     */
+    bool Find(u64 key, std::shared_ptr<T>& shader) {
+        auto iter = entries.find(key);
+        if (iter == entries.end()) {
+            ++stats.misses;
+            return false;
+        }
+
+        ++stats.hits;
+        lru.splice(lru.begin(), lru, iter->second.lru_position);
+        shader = iter->second.shader;
+        return true;
+    }
+
+    /// Adds a shader, which may be nullptr to remember that a program can't be compiled
+    void Insert(u64 key, std::shared_ptr<T> shader) {
+        const size_t code_size = shader ? shader->GetCodeSize() : 0;
+
+        auto iter = entries.find(key);
+        if (iter != entries.end()) {
+            stats.code_size -= iter->second.code_size;
+            lru.erase(iter->second.lru_position);
+            entries.erase(iter);
+        }
+
+        lru.push_front(key);
+        entries.emplace(key, Entry{ std::move(shader), code_size, lru.begin() });
+        stats.code_size += code_size;
+
+        // The new entry is kept even if it exceeds the budget on its own
+        while (stats.code_size > max_code_size && lru.size() > 1) {
+            auto victim = entries.find(lru.back());
+            stats.code_size -= victim->second.code_size;
+            entries.erase(victim);
+            lru.pop_back();
+            ++stats.evictions;
+        }
+
+        stats.num_entries = entries.size();
+    }
+
+    void Clear() {
+        entries.clear();
+        lru.clear();
+        stats.code_size = 0;
+        stats.num_entries = 0;
+    }
+
+    const ShaderCacheStats& GetStats() const {
+        return stats;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<T> shader;
+        size_t code_size;
+        std::list<u64>::iterator lru_position;
+    };
+
+    size_t max_code_size;
+    std::unordered_map<u64, Entry> entries;
+    std::list<u64> lru; ///< Keys ordered from the most to the least recently used one
+    ShaderCacheStats stats;
+};
+
+/// Budget for the compiled code of each shader cache (32MiB)
+constexpr size_t MAX_SHADER_CACHE_CODE_SIZE = 32 * 1024 * 1024;
+
+static JitShaderCache<JitShader> shader_map(MAX_SHADER_CACHE_CODE_SIZE);
+static std::unique_ptr<ShaderDiskCache> disk_cache;
+
+/// Batch shaders by cache key, set to nullptr for programs that can't be run as a batch
+static JitShaderCache<BatchJitShader> batch_shader_map(MAX_SHADER_CACHE_CODE_SIZE);
+
+/// Shaders currently being compiled in the background, by cache key
+static std::unordered_map<u64, std::future<std::shared_ptr<JitShader>>> pending_shaders;
+static std::unordered_map<u64, std::future<std::shared_ptr<BatchJitShader>>> pending_batch_shaders;
+static std::unique_ptr<Common::ThreadPool> compile_pool;
+
+/// Returns the disk cache of the running title, (re)opening it if the title changed
+static ShaderDiskCache& GetDiskCache() {
+    const u64 title_id = Kernel::g_current_process ? Kernel::g_current_process->codeset->program_id : 0;
+    if (!disk_cache || disk_cache->GetTitleId() != title_id)
+        disk_cache = std::make_unique<ShaderDiskCache>(title_id);
+    return *disk_cache;
+}
+
+static std::shared_ptr<JitShader> CompileJitShader(const ShaderSetup& setup) {
+    MICROPROFILE_SCOPE(GPU_ShaderCompile);
+    auto shader = std::make_shared<JitShader>();
+    shader->Compile(setup);
+    return shader;
+}
+
+static std::shared_ptr<BatchJitShader> CompileBatchJitShader(const ShaderSetup& setup) {
+    MICROPROFILE_SCOPE(GPU_ShaderCompile);
+    auto shader = std::make_shared<BatchJitShader>();
+    if (!shader->Compile(setup))
+        return nullptr;
+    return shader;
+}
+
+/// Queues compilation of the given shader program on the background compiler thread
+template <typename T>
+static std::future<std::shared_ptr<T>> CompileAsync(const ShaderSetup& setup,
+                                                    std::shared_ptr<T> (*compile)(const ShaderSetup&)) {
+    if (!compile_pool)
+        compile_pool = std::make_unique<Common::ThreadPool>(1, "ShaderCompiler");
+
+    // The program may be overwritten by the time the job runs, so the job works on a copy
+    auto setup_copy = std::make_shared<ShaderSetup>(setup);
+    auto task = std::make_shared<std::packaged_task<std::shared_ptr<T>()>>([setup_copy, compile] {
+        return compile(*setup_copy);
+    });
+
+    auto result = task->get_future();
+    compile_pool->Push([task] { (*task)(); });
+    return result;
+}
+
+/**
+ * Looks up the compiled shader for the given program, loading or compiling it if necessary.
+ * @return The compiled shader, or nullptr if it is still being compiled in the background
+ */
+static std::shared_ptr<JitShader> GetJitShader(u64 cache_key, const ShaderSetup& setup) {
+    std::shared_ptr<JitShader> shader;
+    if (shader_map.Find(cache_key, shader))
+        return shader;
+
+    const bool use_disk_cache = VideoCore::g_shader_jit_disk_cache_enabled;
+
+    auto pending = pending_shaders.find(cache_key);
+    if (pending != pending_shaders.end()) {
+        if (pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return nullptr;
+
+        shader = pending->second.get();
+        pending_shaders.erase(pending);
+    } else {
+        if (use_disk_cache) {
+            shader = GetDiskCache().Load(cache_key);
+            if (shader) {
+                shader_map.Insert(cache_key, shader);
+                return shader;
+            }
+        }
+
+        if (VideoCore::g_shader_jit_async_enabled) {
+            pending_shaders.emplace(cache_key, CompileAsync(setup, CompileJitShader));
+            return nullptr;
+        }
+
+        shader = CompileJitShader(setup);
+    }
+
+    if (use_disk_cache)
+        GetDiskCache().Store(cache_key, *shader);
+
+    shader_map.Insert(cache_key, shader);
+    return shader;
+}
+
+/**
+ * Looks up the batch shader for the given program, compiling it if necessary.
+ * @return The compiled shader, or nullptr if it is still being compiled in the background or the
+ *         program can't be run as a batch
+ */
+static std::shared_ptr<BatchJitShader> GetBatchJitShader(u64 cache_key, const ShaderSetup& setup) {
+    std::shared_ptr<BatchJitShader> shader;
+    if (batch_shader_map.Find(cache_key, shader))
+        return shader;
+
+    auto pending = pending_batch_shaders.find(cache_key);
+    if (pending != pending_batch_shaders.end()) {
+        if (pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return nullptr;
+
+        shader = pending->second.get();
+        pending_batch_shaders.erase(pending);
+    } else if (VideoCore::g_shader_jit_async_enabled) {
+        pending_batch_shaders.emplace(cache_key, CompileAsync(setup, CompileBatchJitShader));
+        return nullptr;
+    } else {
+        shader = CompileBatchJitShader(setup);
+    }
+
+    batch_shader_map.Insert(cache_key, shader);
+    return shader;
+}
+
+static void LogCacheStats(const char* name, const ShaderCacheStats& stats) {
+    LOG_DEBUG(HW_GPU, "%s: %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions, "
+              "%zu shaders using %zu bytes", name, stats.hits, stats.misses, stats.evictions,
+              stats.num_entries, stats.code_size);
+}
 #endif // ARCHITECTURE_x86_64
 
 void ClearCache() {
 #ifdef ARCHITECTURE_x86_64
-    shader_map.clear();
+    // Let outstanding jobs finish, as they may still reference their code regions
+    if (compile_pool)
+        compile_pool->WaitForIdle();
+    pending_shaders.clear();
+    pending_batch_shaders.clear();
+
+    LogCacheStats("Shader cache", shader_map.GetStats());
+    LogCacheStats("Batch shader cache", batch_shader_map.GetStats());
+
+    shader_map.Clear();
+    batch_shader_map.Clear();
+    disk_cache.reset();
+#endif // ARCHITECTURE_x86_64
+}
+
+ShaderCacheStats GetCacheStats(bool batch) {
+#ifdef ARCHITECTURE_x86_64
+    return batch ? batch_shader_map.GetStats() : shader_map.GetStats();
+#else
+    return {};
 #endif // ARCHITECTURE_x86_64
 }
 
@@ -98,17 +365,17 @@ void ShaderSetup::Setup() {
         u64 cache_key = (Common::ComputeHash64(&program_code, sizeof(program_code)) ^
             Common::ComputeHash64(&swizzle_data, sizeof(swizzle_data)));
 
-        auto iter = shader_map.find(cache_key);
-        if (iter != shader_map.end()) {
-            jit_shader = iter->second;
+        // While the shader is compiled in the background, Run falls back to the interpreter
+        jit_shader = GetJitShader(cache_key, *this);
+
+        if (VideoCore::g_shader_jit_batch_enabled) {
+            batch_jit_shader = GetBatchJitShader(cache_key, *this);
         } else {
-            auto shader = std::make_shared<JitShader>();
-            shader->Compile(*this);
-            jit_shader = shader;
-            shader_map[cache_key] = std::move(shader);
+            batch_jit_shader.reset();
         }
     } else {
         jit_shader.reset();
+        batch_jit_shader.reset();
     }
 #endif // ARCHITECTURE_x86_64
 }
@@ -142,6 +409,35 @@ void ShaderSetup::Run(UnitState<false>& state, const InputVertex& input, int num
 
 }
 
+void ShaderSetup::RunBatch(UnitState<false>& state, BatchUnitState& batch_state, const InputVertex* inputs,
+                           unsigned count, int num_attributes, const Regs::ShaderConfig& config,
+                           OutputRegisters* outputs) {
+    ASSERT(count >= 1 && count <= SHADER_BATCH_SIZE);
+
+#ifdef ARCHITECTURE_x86_64
+    if (auto shader = batch_jit_shader.lock()) {
+        MICROPROFILE_SCOPE(GPU_Shader);
+
+        // Unused lanes shade copies of the last vertex
+        for (unsigned lane = 0; lane < SHADER_BATCH_SIZE; ++lane)
+            batch_state.LoadInput(lane, inputs[std::min(lane, count - 1)], num_attributes, config);
+
+        if (shader->Run(*this, batch_state, config.main_offset)) {
+            for (unsigned lane = 0; lane < count; ++lane)
+                batch_state.StoreOutput(lane, outputs[lane]);
+            return;
+        }
+
+        // The vertices took different paths through the program, shade them one by one instead
+    }
+#endif // ARCHITECTURE_x86_64
+
+    for (unsigned i = 0; i < count; ++i) {
+        Run(state, inputs[i], num_attributes, config);
+        outputs[i] = state.output_registers;
+    }
+}
+
 DebugData<true> ShaderSetup::ProduceDebugInfo(const InputVertex& input, int num_attributes, const Regs::ShaderConfig& config) {
     UnitState<true> state;
 
@@ -34,6 +34,7 @@ namespace Shader {
 #ifdef ARCHITECTURE_x86_64
 // Forward declare JitShader because shader_jit_x64.h requires ShaderSetup (which uses JitShader) from this file
 class JitShader;
+class BatchJitShader;
 #endif // ARCHITECTURE_x86_64
 
 struct InputVertex {
@@ -340,9 +341,87 @@ struct UnitState {
     }
 };
 
+/// Number of vertices shaded at once by ShaderSetup::RunBatch
+constexpr unsigned SHADER_BATCH_SIZE = 4;
+
+/**
+ * Shader unit state used to shade SHADER_BATCH_SIZE vertices at once. The registers are stored in
+ * structure-of-arrays layout: each component of a register holds its value for all vertices of the
+ * batch, so that every SIMD lane works on a different vertex.
+ */
+struct BatchUnitState {
+    struct Register {
+        alignas(16) float24 comp[4][SHADER_BATCH_SIZE];
+    };
+
+    struct Registers {
+        Register input[16];
+        Register temporary[16];
+        Register output[16];
+    } registers;
+
+    /// Results of the last CMP instruction as lane masks, either all ones (true) or all zeros
+    alignas(16) u32 conditional_code[2][SHADER_BATCH_SIZE];
+
+    /// The two address registers, premultiplied by the size of a register for relative addressing
+    alignas(16) s32 address_offsets[2][SHADER_BATCH_SIZE];
+
+    /// Scratch memory used by the compiled code, e.g. for relatively addressed source operands
+    Register scratch[3];
+
+    /// Sets the registers of all vertices to the contents of the given shader unit state
+    void Initialize(const UnitState<false>& state);
+
+    /// Sets the input registers of the vertex at `lane`, see ShaderSetup::Run
+    void LoadInput(unsigned lane, const InputVertex& input, int num_attributes, const Regs::ShaderConfig& config);
+
+    /// Copies the output registers of the vertex at `lane`
+    void StoreOutput(unsigned lane, OutputRegisters& output) const;
+
+    static size_t InputOffset(const SourceRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Input:
+            return offsetof(BatchUnitState, registers.input) + reg.GetIndex()*sizeof(Register);
+
+        case RegisterType::Temporary:
+            return offsetof(BatchUnitState, registers.temporary) + reg.GetIndex()*sizeof(Register);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+
+    static size_t OutputOffset(const DestRegister& reg) {
+        switch (reg.GetRegisterType()) {
+        case RegisterType::Output:
+            return offsetof(BatchUnitState, registers.output) + reg.GetIndex()*sizeof(Register);
+
+        case RegisterType::Temporary:
+            return offsetof(BatchUnitState, registers.temporary) + reg.GetIndex()*sizeof(Register);
+
+        default:
+            UNREACHABLE();
+            return 0;
+        }
+    }
+};
+
+/// Statistics of one of the caches of compiled shader programs
+struct ShaderCacheStats {
+    u64 hits = 0;
+    u64 misses = 0;
+    u64 evictions = 0;
+    size_t num_entries = 0;
+    size_t code_size = 0; ///< Total size of the compiled code of all cached shaders, in bytes
+};
+
 /// Clears the shader cache
 void ClearCache();
 
+/// Returns the statistics of the cache of scalar or batch JIT shaders respectively
+ShaderCacheStats GetCacheStats(bool batch);
+
 struct ShaderSetup {
 
     struct {
@@ -379,6 +458,7 @@ struct ShaderSetup {
 
 #ifdef ARCHITECTURE_x86_64
     std::weak_ptr<const JitShader> jit_shader;
+    std::weak_ptr<const BatchJitShader> batch_jit_shader;
 #endif
 
     /**
@@ -396,6 +476,21 @@ struct ShaderSetup {
      */
     void Run(UnitState<false>& state, const InputVertex& input, int num_attributes, const Regs::ShaderConfig& config);
 
+    /**
+     * Runs the currently setup shader for up to SHADER_BATCH_SIZE vertices at once. If the shader
+     * can't be run as a batch, the vertices are shaded one after another using `Run`.
+     * @param state Shader unit state, used when shading vertices one at a time
+     * @param batch_state Batch shader unit state, must be initialized once per shader and per thread
+     * @param inputs Input vertices into the shader
+     * @param count Number of input vertices, at least one and at most SHADER_BATCH_SIZE
+     * @param num_attributes The number of vertex shader attributes
+     * @param config Configuration object for the shader pipeline
+     * @param outputs Receives the output registers of each vertex
+     */
+    void RunBatch(UnitState<false>& state, BatchUnitState& batch_state, const InputVertex* inputs,
+                  unsigned count, int num_attributes, const Regs::ShaderConfig& config,
+                  OutputRegisters* outputs);
+
     /**
      * Produce debug information based on the given shader and input vertex
      * @param input Input vertex into the shader
@@ -0,0 +1,139 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "common/file_util.h"
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/scm_rev.h"
+#include "common/string_util.h"
+#include "common/x64/cpu_detect.h"
+
+#include "video_core/shader/shader_jit_disk_cache.h"
+#include "video_core/shader/shader_jit_x64.h"
+
+namespace Pica {
+
+namespace Shader {
+
+static const u32 CACHE_MAGIC = 0x4A534350; // "PCSJ"
+/// Needs to be incremented whenever the file format or the code emitted by JitShader changes
+static const u32 CACHE_VERSION = 1;
+/// Upper bound on the size of a single entry, used to reject corrupted files
+static const u32 MAX_ENTRY_SIZE = 1024 * 1024;
+
+struct CacheFileHeader {
+    u32 magic;
+    u32 version;
+    u64 build_hash;
+    u32 cpu_features;
+    u32 reserved;
+};
+
+struct CacheEntryHeader {
+    u64 key;
+    u32 size;
+    u32 reserved;
+};
+
+static CacheFileHeader GetExpectedHeader() {
+    const std::string build = std::string(Common::g_scm_rev) + Common::g_scm_desc;
+
+    CacheFileHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.build_hash = Common::ComputeHash64(build.data(), static_cast<int>(build.size()));
+    // The emitted code only depends on SSE4.1 support
+    header.cpu_features = Common::GetCPUCaps().sse4_1 ? 1 : 0;
+    return header;
+}
+
+ShaderDiskCache::ShaderDiskCache(u64 title_id) : title_id(title_id) {
+    const std::string dir = FileUtil::GetUserPath(D_SHADERCACHE_IDX);
+    const std::string path = dir + Common::StringFromFormat("%016" PRIX64 ".bin", title_id);
+
+    if (!FileUtil::CreateFullPath(dir)) {
+        LOG_ERROR(HW_GPU, "Failed to create shader cache directory %s", dir.c_str());
+        return;
+    }
+
+    if (!file.Open(path, FileUtil::Exists(path) ? "r+b" : "w+b")) {
+        LOG_ERROR(HW_GPU, "Failed to open shader cache %s", path.c_str());
+        return;
+    }
+
+    ReadEntries();
+    LOG_INFO(HW_GPU, "Loaded %zu cached shaders from %s", entries.size(), path.c_str());
+}
+
+void ShaderDiskCache::ReadEntries() {
+    const CacheFileHeader expected = GetExpectedHeader();
+
+    CacheFileHeader header;
+    if (file.ReadBytes(&header, sizeof(header)) != sizeof(header) ||
+        std::memcmp(&header, &expected, sizeof(header)) != 0) {
+        // Missing or outdated cache, start over
+        file.Clear();
+        file.Resize(0);
+        file.Seek(0, SEEK_SET);
+        file.WriteBytes(&expected, sizeof(expected));
+        file.Flush();
+        return;
+    }
+
+    u64 valid_size = file.Tell();
+    CacheEntryHeader entry;
+    while (file.ReadBytes(&entry, sizeof(entry)) == sizeof(entry) && entry.size <= MAX_ENTRY_SIZE) {
+        std::vector<u8> data(entry.size);
+        if (file.ReadBytes(data.data(), data.size()) != data.size())
+            break;
+
+        entries[entry.key] = std::move(data);
+        valid_size = file.Tell();
+    }
+
+    // Drop a partially written entry at the end of the file, so that new ones can be appended
+    file.Clear();
+    file.Resize(valid_size);
+    file.Seek(valid_size, SEEK_SET);
+}
+
+std::shared_ptr<JitShader> ShaderDiskCache::Load(u64 key) {
+    auto iter = entries.find(key);
+    if (iter == entries.end())
+        return nullptr;
+
+    auto shader = std::make_shared<JitShader>();
+    if (!shader->Deserialize(iter->second.data(), iter->second.size())) {
+        LOG_ERROR(HW_GPU, "Discarding invalid cached shader %016" PRIX64, key);
+        entries.erase(iter);
+        return nullptr;
+    }
+    return shader;
+}
+
+void ShaderDiskCache::Store(u64 key, const JitShader& shader) {
+    if (!file.IsOpen())
+        return;
+
+    std::vector<u8> data;
+    shader.Serialize(data);
+
+    CacheEntryHeader entry{};
+    entry.key = key;
+    entry.size = static_cast<u32>(data.size());
+
+    file.WriteBytes(&entry, sizeof(entry));
+    file.WriteBytes(data.data(), data.size());
+    file.Flush();
+
+    entries[key] = std::move(data);
+}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,56 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/file_util.h"
+
+namespace Pica {
+
+namespace Shader {
+
+class JitShader;
+
+/**
+ * Persistent cache of compiled shader programs of a single title, stored in the shader cache
+ * directory of the user path. Entries are keyed by the same program hash used for the in-memory
+ * shader cache. The cache file is discarded whenever it was written by a different emulator build
+ * or on a host with different CPU features, since the compiled code depends on both.
+ */
+class ShaderDiskCache final {
+public:
+    explicit ShaderDiskCache(u64 title_id);
+
+    u64 GetTitleId() const {
+        return title_id;
+    }
+
+    /**
+     * Loads a compiled shader from the cache
+     * @param key Hash of the shader program
+     * @return The loaded shader, or nullptr if the cache contains no valid entry for the key
+     */
+    std::shared_ptr<JitShader> Load(u64 key);
+
+    /// Adds a compiled shader to the cache, writing it to disk right away
+    void Store(u64 key, const JitShader& shader);
+
+private:
+    /// Reads all entries of the cache file, or resets the file if it is not usable
+    void ReadEntries();
+
+    u64 title_id;
+    FileUtil::IOFile file;
+    std::unordered_map<u64, std::vector<u8>> entries;
+};
+
+} // namespace Shader
+
+} // namespace Pica
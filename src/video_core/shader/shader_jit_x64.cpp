@@ -3,13 +3,18 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
 #include <xmmintrin.h>
 
 #include <nihstro/shader_bytecode.h>
 
 #include "common/assert.h"
+#include "common/common_funcs.h"
 #include "common/logging/log.h"
 #include "common/vector_math.h"
 #include "common/x64/abi.h"
@@ -150,9 +155,56 @@ static void LogCritical(const char* msg) {
     LOG_CRITICAL(HW_GPU, "%s", msg);
 }
 
+static void Handle_EMIT(void* param1) {
+    UnitState<false>& state = *static_cast<UnitState<false>*>(param1);
+    Shader::HandleEMIT(state);
+};
+
+/// Used to set a register to one
+alignas(16) static const float const_one[4] = { 1.f, 1.f, 1.f, 1.f };
+/// Used to negate registers
+alignas(16) static const float const_neg[4] = { -0.f, -0.f, -0.f, -0.f };
+
+static const char msg_backwards_if[] = "Backwards if-statements not supported";
+static const char msg_backwards_loop[] = "Backwards loops not supported";
+static const char msg_nested_loop[] = "Nested loops not supported";
+
+/**
+ * Addresses outside of the code region which compiled shaders may reference. They are only ever
+ * emitted by Compile_LoadExternal, which records a relocation so that compiled programs can be
+ * moved to a different code region (or process) later on. Entries must only ever be appended.
+ */
+static const void* const external_symbols[] = {
+    const_one,
+    const_neg,
+    reinterpret_cast<const void*>(LogCritical),
+    reinterpret_cast<const void*>(Handle_EMIT),
+    reinterpret_cast<const void*>(exp2f),
+    reinterpret_cast<const void*>(log2f),
+    msg_backwards_if,
+    msg_backwards_loop,
+    msg_nested_loop,
+};
+
+void JitShader::Compile_LoadExternal(X64Reg dest, const void* ptr) {
+    const auto symbol = std::find(std::begin(external_symbols), std::end(external_symbols), ptr);
+    ASSERT_MSG(symbol != std::end(external_symbols), "Referenced an unknown external symbol");
+
+    // Always emits a 64-bit immediate so that the address can be patched in place
+    MOV(64, R(dest), ImmPtr(ptr));
+    relocations.push_back({ static_cast<u32>(GetOffset(GetCodePtr()) - sizeof(u64)),
+                            static_cast<u32>(symbol - std::begin(external_symbols)) });
+}
+
+void JitShader::Compile_CallExternal(const void* func) {
+    Compile_LoadExternal(RAX, func);
+    CALLptr(R(RAX));
+}
+
 void JitShader::Compile_Assert(bool condition, const char* msg) {
     if (!condition) {
-        ABI_CallFunctionP(reinterpret_cast<const void*>(LogCritical), const_cast<char*>(msg));
+        Compile_LoadExternal(ABI_PARAM1, msg);
+        Compile_CallExternal(reinterpret_cast<const void*>(LogCritical));
     }
 }
 
@@ -415,7 +467,7 @@ void JitShader::Compile_EX2(Instruction instr) {
     MOVSS(XMM0, R(SRC1));
 
     ABI_PushRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
-    ABI_CallFunction(reinterpret_cast<const void*>(exp2f));
+    Compile_CallExternal(reinterpret_cast<const void*>(exp2f));
     ABI_PopRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
 
     SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
@@ -428,7 +480,7 @@ void JitShader::Compile_LG2(Instruction instr) {
     MOVSS(XMM0, R(SRC1));
 
     ABI_PushRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
-    ABI_CallFunction(reinterpret_cast<const void*>(log2f));
+    Compile_CallExternal(reinterpret_cast<const void*>(log2f));
     ABI_PopRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
 
     SHUFPS(XMM0, R(XMM0), _MM_SHUFFLE(0, 0, 0, 0));
@@ -669,7 +721,7 @@ void JitShader::Compile_MAD(Instruction instr) {
 }
 
 void JitShader::Compile_IF(Instruction instr) {
-    Compile_Assert(instr.flow_control.dest_offset >= program_counter, "Backwards if-statements not supported");
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter, msg_backwards_if);
 
     // Evaluate the "IF" condition
     if (instr.opcode.Value() == OpCode::Id::IFU) {
@@ -700,8 +752,8 @@ void JitShader::Compile_IF(Instruction instr) {
 }
 
 void JitShader::Compile_LOOP(Instruction instr) {
-    Compile_Assert(instr.flow_control.dest_offset >= program_counter, "Backwards loops not supported");
-    Compile_Assert(!looping, "Nested loops not supported");
+    Compile_Assert(instr.flow_control.dest_offset >= program_counter, msg_backwards_loop);
+    Compile_Assert(!looping, msg_nested_loop);
 
     looping = true;
 
@@ -727,15 +779,10 @@ void JitShader::Compile_LOOP(Instruction instr) {
     looping = false;
 }
 
-static void Handle_EMIT(void* param1) {
-    UnitState<false>& state = *static_cast<UnitState<false>*>(param1);
-    Shader::HandleEMIT(state);
-};
-
 void JitShader::Compile_EMIT(Instruction instr) {
     ABI_PushRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
     MOV(PTRBITS, R(ABI_PARAM1), R(STATE));
-    ABI_CallFunctionR(reinterpret_cast<const void*>(Handle_EMIT), ABI_PARAM1);
+    Compile_CallExternal(reinterpret_cast<const void*>(Handle_EMIT));
     ABI_PopRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
 }
 
@@ -830,6 +877,7 @@ void JitShader::Compile(const ShaderSetup& setup) {
     looping = false;
     code_ptr.fill(nullptr);
     fixup_branches.clear();
+    relocations.clear();
 
     // Find all `CALL` instructions and identify return locations
     FindReturnOffsets();
@@ -845,14 +893,10 @@ void JitShader::Compile(const ShaderSetup& setup) {
     XOR(64, R(ADDROFFS_REG_1), R(ADDROFFS_REG_1));
     XOR(64, R(LOOPCOUNT_REG), R(LOOPCOUNT_REG));
 
-    // Used to set a register to one
-    static const __m128 one = { 1.f, 1.f, 1.f, 1.f };
-    MOV(PTRBITS, R(RAX), ImmPtr(&one));
+    Compile_LoadExternal(RAX, const_one);
     MOVAPS(ONE, MatR(RAX));
 
-    // Used to negate registers
-    static const __m128 neg = { -0.f, -0.f, -0.f, -0.f };
-    MOV(PTRBITS, R(RAX), ImmPtr(&neg));
+    Compile_LoadExternal(RAX, const_neg);
     MOVAPS(NEGBIT, MatR(RAX));
 
     // Jump to start of the shader program
@@ -881,6 +925,69 @@ void JitShader::Compile(const ShaderSetup& setup) {
     this->setup = nullptr;
 }
 
+/// Offset stored for shader instructions that weren't compiled
+static const u32 INVALID_CODE_OFFSET = 0xFFFFFFFF;
+
+struct SerializedShaderHeader {
+    u32 code_size;
+    u32 num_relocations;
+    std::array<u32, 1024> code_offsets;
+};
+
+void JitShader::Serialize(std::vector<u8>& out) const {
+    SerializedShaderHeader header;
+    header.code_size = static_cast<u32>(GetCodePtr() - region);
+    header.num_relocations = static_cast<u32>(relocations.size());
+    for (size_t i = 0; i < code_ptr.size(); ++i) {
+        header.code_offsets[i] = code_ptr[i] ? static_cast<u32>(code_ptr[i] - region) : INVALID_CODE_OFFSET;
+    }
+
+    auto Append = [&out](const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    };
+
+    Append(&header, sizeof(header));
+    Append(relocations.data(), relocations.size() * sizeof(Relocation));
+    Append(region, header.code_size);
+}
+
+bool JitShader::Deserialize(const u8* data, size_t size) {
+    SerializedShaderHeader header;
+    if (size < sizeof(header))
+        return false;
+    std::memcpy(&header, data, sizeof(header));
+
+    const size_t relocations_size = header.num_relocations * sizeof(Relocation);
+    if (header.code_size > MAX_SHADER_SIZE || size != sizeof(header) + relocations_size + header.code_size)
+        return false;
+
+    relocations.resize(header.num_relocations);
+    std::memcpy(relocations.data(), data + sizeof(header), relocations_size);
+    std::memcpy(region, data + sizeof(header) + relocations_size, header.code_size);
+
+    for (const auto& relocation : relocations) {
+        if (relocation.symbol >= ARRAY_SIZE(external_symbols) ||
+            relocation.code_offset + sizeof(u64) > header.code_size) {
+            return false;
+        }
+
+        const u64 address = reinterpret_cast<u64>(external_symbols[relocation.symbol]);
+        std::memcpy(region + relocation.code_offset, &address, sizeof(u64));
+    }
+
+    for (size_t i = 0; i < code_ptr.size(); ++i) {
+        const u32 offset = header.code_offsets[i];
+        if (offset != INVALID_CODE_OFFSET && offset >= header.code_size)
+            return false;
+        code_ptr[i] = (offset != INVALID_CODE_OFFSET) ? region + offset : nullptr;
+    }
+
+    program = (CompiledShader*)region;
+    SetCodePtr(region + header.code_size);
+    return true;
+}
+
 JitShader::JitShader() {
     AllocCodeSpace(MAX_SHADER_SIZE);
 }
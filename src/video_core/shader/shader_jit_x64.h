@@ -42,6 +42,23 @@ public:
 
     void Compile(const ShaderSetup& setup);
 
+    /// Returns the size of the compiled program in bytes
+    size_t GetCodeSize() const {
+        return static_cast<size_t>(GetCodePtr() - region);
+    }
+
+    /**
+     * Appends the compiled program to `out`, in the format expected by Deserialize
+     */
+    void Serialize(std::vector<u8>& out) const;
+
+    /**
+     * Loads a program previously written by Serialize into the code region of this shader,
+     * patching all references to addresses outside of the compiled code.
+     * @return False if the data is malformed, in which case the shader must not be run
+     */
+    bool Deserialize(const u8* data, size_t size);
+
     void Compile_ADD(Instruction instr);
     void Compile_DP3(Instruction instr);
     void Compile_DP4(Instruction instr);
@@ -95,6 +112,15 @@ private:
 
     BitSet32 PersistentCallerSavedRegs();
 
+    /**
+     * Loads the address of an external symbol (a function or constant outside of the code region)
+     * into `dest`, recording a relocation for it.
+     */
+    void Compile_LoadExternal(Gen::X64Reg dest, const void* ptr);
+
+    /// Calls an external function, see Compile_LoadExternal. Clobbers RAX.
+    void Compile_CallExternal(const void* func);
+
     /**
      * Assertion evaluated at compile-time, but only triggered if executed at runtime.
      * @param msg Message to be logged if the assertion fails.
@@ -130,6 +156,14 @@ private:
     /// Branches that need to be fixed up once the entire shader program is compiled
     std::vector<std::pair<Gen::FixupBranch, unsigned>> fixup_branches;
 
+    struct Relocation {
+        u32 code_offset; ///< Offset of the 64-bit address to patch, relative to the code region
+        u32 symbol;      ///< Index of the referenced external symbol
+    };
+
+    /// References to external symbols in the compiled code
+    std::vector<Relocation> relocations;
+
     using CompiledShader = void(const void* setup, void* state, const u8* start_addr);
     CompiledShader* program = nullptr;
 
@@ -0,0 +1,964 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <xmmintrin.h>
+
+#include <nihstro/shader_bytecode.h>
+
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/abi.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/emitter.h"
+
+#include "video_core/shader/shader.h"
+#include "video_core/shader/shader_jit_x64_batch.h"
+
+namespace Pica {
+
+namespace Shader {
+
+using namespace Gen;
+
+typedef void (BatchJitShader::*BatchJitFunction)(Instruction instr);
+
+const BatchJitFunction batch_instr_table[64] = {
+    &BatchJitShader::Compile_ADD,        // add
+    &BatchJitShader::Compile_DP3,        // dp3
+    &BatchJitShader::Compile_DP4,        // dp4
+    &BatchJitShader::Compile_DPH,        // dph
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_EX2,        // ex2
+    &BatchJitShader::Compile_LG2,        // lg2
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_MUL,        // mul
+    &BatchJitShader::Compile_SGE,        // sge
+    &BatchJitShader::Compile_SLT,        // slt
+    &BatchJitShader::Compile_FLR,        // flr
+    &BatchJitShader::Compile_MAX,        // max
+    &BatchJitShader::Compile_MIN,        // min
+    &BatchJitShader::Compile_RCP,        // rcp
+    &BatchJitShader::Compile_RSQ,        // rsq
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_MOVA,       // mova
+    &BatchJitShader::Compile_MOV,        // mov
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_DPH,        // dphi
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_SGE,        // sgei
+    &BatchJitShader::Compile_SLT,        // slti
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    nullptr,                             // unknown
+    &BatchJitShader::Compile_NOP,        // nop
+    &BatchJitShader::Compile_END,        // end
+    nullptr,                             // break
+    &BatchJitShader::Compile_CALL,       // call
+    &BatchJitShader::Compile_CALLC,      // callc
+    &BatchJitShader::Compile_CALLU,      // callu
+    &BatchJitShader::Compile_IF,         // ifu
+    &BatchJitShader::Compile_IF,         // ifc
+    &BatchJitShader::Compile_LOOP,       // loop
+    &BatchJitShader::Compile_Unsupported, // emit
+    &BatchJitShader::Compile_Unsupported, // setemit
+    &BatchJitShader::Compile_JMP,        // jmpc
+    &BatchJitShader::Compile_JMP,        // jmpu
+    &BatchJitShader::Compile_CMP,        // cmp
+    &BatchJitShader::Compile_CMP,        // cmp
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // madi
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+    &BatchJitShader::Compile_MAD,        // mad
+};
+
+// Register usage follows JitShader where possible. Every SIMD register holds one component of a
+// Pica register for all vertices of the batch. RAX-RDX can be used as scratch registers.
+
+/// Pointer to the uniform memory
+static const X64Reg SETUP = R9;
+/// VS loop count register, the same for all vertices
+static const X64Reg LOOPCOUNT_REG = R12;
+/// Current VS loop iteration number
+static const X64Reg LOOPCOUNT = RSI;
+/// Number to increment LOOPCOUNT_REG by on each loop iteration
+static const X64Reg LOOPINC = RDI;
+/// Pointer to the BatchUnitState instance
+static const X64Reg STATE = R15;
+/// Stack pointer after the prologue, used to leave the program from within subroutines
+static const X64Reg FRAME = RBP;
+/// Lane mask of the vertices executing the current code path. This needs to be XMM0, since it is
+/// used as the implicit mask operand of BLENDVPS.
+static const X64Reg EXEC = XMM0;
+/// Components of the result of an instruction
+static const std::array<X64Reg, 4> RESULT = {{ XMM1, XMM2, XMM3, XMM4 }};
+/// Loaded with components of the source registers, otherwise can be used as scratch registers
+static const X64Reg SRC1 = XMM5;
+static const X64Reg SRC2 = XMM6;
+static const X64Reg SRC3 = XMM7;
+/// SIMD scratch registers
+static const X64Reg SCRATCH = XMM8;
+static const X64Reg SCRATCH2 = XMM9;
+/// Hold the uniform vector of each vertex when gathering relatively addressed uniforms
+static const std::array<X64Reg, 4> GATHER = {{ XMM10, XMM11, XMM12, XMM13 }};
+/// Constant vector of [1.0f, 1.0f, 1.0f, 1.0f], used to efficiently set a vector to one
+static const X64Reg ONE = XMM14;
+/// Constant vector of [-0.f, -0.f, -0.f, -0.f], used to efficiently negate a vector with XOR
+static const X64Reg NEGBIT = XMM15;
+
+// State registers that must not be modified by external functions calls
+static const BitSet32 persistent_regs = {
+    SETUP, STATE, FRAME, // Pointers to register blocks and the stack frame
+    LOOPCOUNT_REG, LOOPCOUNT, LOOPINC, // Loop state
+    EXEC+16, ONE+16, NEGBIT+16, // Execution mask and constants
+};
+
+/// Upper bound on the code emitted for a single Pica instruction
+static const size_t MAX_INSTRUCTION_SIZE = 1024 * 4;
+
+alignas(16) static const float const_one[4] = { 1.f, 1.f, 1.f, 1.f };
+alignas(16) static const float const_neg[4] = { -0.f, -0.f, -0.f, -0.f };
+
+static int ComponentOffset(unsigned comp) {
+    return static_cast<int>(comp * sizeof(BatchUnitState::Register::comp[0]));
+}
+
+BatchJitShader::SourceOperand BatchJitShader::Compile_PrepareSrc(Instruction instr, unsigned src_num, SourceRegister src_reg) {
+    unsigned operand_desc_id;
+
+    const bool is_inverted = (0 != (instr.opcode.Value().GetInfo().subtype & OpCode::Info::SrcInversed));
+
+    unsigned address_register_index;
+    unsigned offset_src;
+
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        offset_src = is_inverted ? 3 : 2;
+        address_register_index = instr.mad.address_register_index;
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        offset_src = is_inverted ? 2 : 1;
+        address_register_index = instr.common.address_register_index;
+    }
+
+    SwizzlePattern swiz = { setup->swizzle_data[operand_desc_id] };
+
+    SourceOperand src;
+    src.index = INVALID_REG;
+    const bool negate[] = { swiz.negate_src1, swiz.negate_src2, swiz.negate_src3 };
+    src.negate = negate[src_num - 1];
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        const SwizzlePattern::Selector selectors[] = {
+            swiz.GetSelectorSrc1(comp), swiz.GetSelectorSrc2(comp), swiz.GetSelectorSrc3(comp)
+        };
+        src.selector[comp] = static_cast<u8>(selectors[src_num - 1]);
+    }
+
+    const bool is_relative = (src_num == offset_src && address_register_index != 0);
+
+    if (src_reg.GetRegisterType() != RegisterType::FloatUniform) {
+        // In SoA layout, relatively addressing input and temporary registers would need a separate
+        // load per vertex and component. Such programs are left to the scalar JIT.
+        if (is_relative)
+            supported = false;
+
+        src.base = STATE;
+        src.disp = static_cast<int>(BatchUnitState::InputOffset(src_reg));
+        src.broadcast = false;
+        return src;
+    }
+
+    const int uniform_disp = static_cast<int>(ShaderSetup::UniformOffset(RegisterType::FloatUniform, src_reg.GetIndex()));
+
+    if (!is_relative || address_register_index == 3) {
+        // The loop counter is the same for all vertices
+        src.base = SETUP;
+        src.index = is_relative ? LOOPCOUNT_REG : INVALID_REG;
+        src.disp = uniform_disp;
+        src.broadcast = true;
+        return src;
+    }
+
+    // Load the uniform addressed by each vertex and transpose them into SoA layout
+    const int offsets_disp = static_cast<int>(offsetof(BatchUnitState, address_offsets) +
+                                              (address_register_index - 1) * sizeof(BatchUnitState::address_offsets[0]));
+    for (unsigned lane = 0; lane < SHADER_BATCH_SIZE; ++lane) {
+        MOVSX(64, 32, RAX, MDisp(STATE, offsets_disp + lane * sizeof(s32)));
+        MOVAPS(GATHER[lane], MComplex(SETUP, RAX, SCALE_1, uniform_disp));
+    }
+
+    src.base = STATE;
+    src.disp = static_cast<int>(offsetof(BatchUnitState, scratch) + (src_num - 1) * sizeof(BatchUnitState::Register));
+    src.broadcast = false;
+
+    MOVAPS(SCRATCH, R(GATHER[0]));
+    UNPCKLPS(SCRATCH, R(GATHER[1]));  // X0 X1 Y0 Y1
+    MOVAPS(SCRATCH2, R(GATHER[2]));
+    UNPCKLPS(SCRATCH2, R(GATHER[3])); // X2 X3 Y2 Y3
+    MOVAPS(SRC1, R(SCRATCH));
+    MOVLHPS(SRC1, SCRATCH2);          // X0 X1 X2 X3
+    MOVHLPS(SCRATCH2, SCRATCH);       // Y0 Y1 Y2 Y3
+    MOVAPS(MDisp(STATE, src.disp + ComponentOffset(0)), SRC1);
+    MOVAPS(MDisp(STATE, src.disp + ComponentOffset(1)), SCRATCH2);
+
+    UNPCKHPS(GATHER[0], R(GATHER[1])); // Z0 Z1 W0 W1
+    UNPCKHPS(GATHER[2], R(GATHER[3])); // Z2 Z3 W2 W3
+    MOVAPS(SRC1, R(GATHER[0]));
+    MOVLHPS(SRC1, GATHER[2]);          // Z0 Z1 Z2 Z3
+    MOVHLPS(GATHER[2], GATHER[0]);     // W0 W1 W2 W3
+    MOVAPS(MDisp(STATE, src.disp + ComponentOffset(2)), SRC1);
+    MOVAPS(MDisp(STATE, src.disp + ComponentOffset(3)), GATHER[2]);
+
+    return src;
+}
+
+void BatchJitShader::Compile_LoadSrc(const SourceOperand& src, unsigned comp, X64Reg dest) {
+    const unsigned selector = src.selector[comp];
+
+    if (src.broadcast) {
+        const int disp = src.disp + static_cast<int>(selector * sizeof(float24));
+        if (src.index != INVALID_REG) {
+            MOVSS(dest, MComplex(src.base, src.index, SCALE_1, disp));
+        } else {
+            MOVSS(dest, MDisp(src.base, disp));
+        }
+        SHUFPS(dest, R(dest), _MM_SHUFFLE(0, 0, 0, 0));
+    } else {
+        MOVAPS(dest, MDisp(src.base, src.disp + ComponentOffset(selector)));
+    }
+
+    // If the source register should be negated, flip the negative bit using XOR
+    if (src.negate) {
+        XORPS(dest, R(NEGBIT));
+    }
+}
+
+void BatchJitShader::Compile_DestEnable(Instruction instr, const std::array<X64Reg, 4>& results) {
+    DestRegister dest;
+    unsigned operand_desc_id;
+    if (instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MAD ||
+        instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI) {
+        operand_desc_id = instr.mad.operand_desc_id;
+        dest = instr.mad.dest.Value();
+    } else {
+        operand_desc_id = instr.common.operand_desc_id;
+        dest = instr.common.dest.Value();
+    }
+
+    SwizzlePattern swiz = { setup->swizzle_data[operand_desc_id] };
+
+    const int dest_offset_disp = static_cast<int>(BatchUnitState::OutputOffset(dest));
+
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        // Only overwrite the values of active vertices
+        const int disp = dest_offset_disp + ComponentOffset(comp);
+        MOVAPS(SCRATCH, MDisp(STATE, disp));
+        BLENDVPS(SCRATCH, R(results[comp]));
+        MOVAPS(MDisp(STATE, disp), SCRATCH);
+    }
+}
+
+void BatchJitShader::Compile_SanitizedMul(X64Reg src1, X64Reg src2, X64Reg scratch) {
+    MOVAPS(scratch, R(src1));
+    CMPPS(scratch, R(src2), CMP_ORD);
+
+    MULPS(src1, R(src2));
+
+    MOVAPS(src2, R(src1));
+    CMPPS(src2, R(src2), CMP_UNORD);
+
+    XORPS(scratch, R(src2));
+    ANDPS(src1, R(scratch));
+}
+
+void BatchJitShader::Compile_EvaluateCondition(Instruction instr, X64Reg dest) {
+    const int cond_disp = static_cast<int>(offsetof(BatchUnitState, conditional_code));
+
+    // Lane mask of the vertices whose conditional code `index` equals `ref`
+    auto Compare = [&](unsigned index, u32 ref, X64Reg reg) {
+        MOVAPS(reg, MDisp(STATE, cond_disp + index * sizeof(BatchUnitState::conditional_code[0])));
+        if (ref == 0) {
+            PCMPEQD(SCRATCH2, R(SCRATCH2));
+            XORPS(reg, R(SCRATCH2));
+        }
+    };
+
+    switch (instr.flow_control.op) {
+    case Instruction::FlowControlType::Or:
+        Compare(0, instr.flow_control.refx, dest);
+        Compare(1, instr.flow_control.refy, SCRATCH);
+        ORPS(dest, R(SCRATCH));
+        break;
+
+    case Instruction::FlowControlType::And:
+        Compare(0, instr.flow_control.refx, dest);
+        Compare(1, instr.flow_control.refy, SCRATCH);
+        ANDPS(dest, R(SCRATCH));
+        break;
+
+    case Instruction::FlowControlType::JustX:
+        Compare(0, instr.flow_control.refx, dest);
+        break;
+
+    case Instruction::FlowControlType::JustY:
+        Compare(1, instr.flow_control.refy, dest);
+        break;
+    }
+}
+
+void BatchJitShader::Compile_UniformCondition(Instruction instr) {
+    int offset = ShaderSetup::UniformOffset(RegisterType::BoolUniform, instr.flow_control.bool_uniform_id);
+    CMP(sizeof(bool) * 8, MDisp(SETUP, offset), Imm8(0));
+}
+
+BitSet32 BatchJitShader::PersistentCallerSavedRegs() {
+    return persistent_regs & ABI_ALL_CALLER_SAVED;
+}
+
+void BatchJitShader::Compile_ADD(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        ADDPS(RESULT[comp], R(SRC2));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_SumProducts(unsigned num_components) {
+    // Summation order matches the shuffles in JitShader, so that results are bit-identical
+    if (num_components == 3) {
+        ADDPS(RESULT[0], R(RESULT[1]));
+        ADDPS(RESULT[0], R(RESULT[2]));
+    } else {
+        ADDPS(RESULT[2], R(RESULT[3]));
+        ADDPS(RESULT[1], R(RESULT[0]));
+        ADDPS(RESULT[2], R(RESULT[1]));
+        MOVAPS(RESULT[0], R(RESULT[2]));
+    }
+}
+
+void BatchJitShader::Compile_DP3(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 3; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+    }
+    Compile_SumProducts(3);
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_DP4(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+    }
+    Compile_SumProducts(4);
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_DPH(Instruction instr) {
+    const bool is_inverted = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::DPHI;
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, is_inverted ? instr.common.src1i.Value() : instr.common.src1.Value());
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, is_inverted ? instr.common.src2i.Value() : instr.common.src2.Value());
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        // The 4th component of the first source is set to 1.0
+        if (comp == 3) {
+            MOVAPS(RESULT[comp], R(ONE));
+        } else {
+            Compile_LoadSrc(src1, comp, RESULT[comp]);
+        }
+        Compile_LoadSrc(src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+    }
+    Compile_SumProducts(4);
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_CallPerLane(Instruction instr, const void* func) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    Compile_LoadSrc(src1, 0, SRC1);
+
+    // Arguments and results are passed through the scratch memory, as XMM0 is used for both
+    const int scratch_disp = static_cast<int>(offsetof(BatchUnitState, scratch));
+    MOVAPS(MDisp(STATE, scratch_disp), SRC1);
+
+    ABI_PushRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
+    for (unsigned lane = 0; lane < SHADER_BATCH_SIZE; ++lane) {
+        const int disp = scratch_disp + static_cast<int>(lane * sizeof(float24));
+        MOVSS(XMM0, MDisp(STATE, disp));
+        ABI_CallFunction(func);
+        MOVSS(MDisp(STATE, disp), XMM0);
+    }
+    ABI_PopRegistersAndAdjustStack(PersistentCallerSavedRegs(), 0);
+
+    MOVAPS(RESULT[0], MDisp(STATE, scratch_disp));
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_EX2(Instruction instr) {
+    Compile_CallPerLane(instr, reinterpret_cast<const void*>(exp2f));
+}
+
+void BatchJitShader::Compile_LG2(Instruction instr) {
+    Compile_CallPerLane(instr, reinterpret_cast<const void*>(log2f));
+}
+
+void BatchJitShader::Compile_MUL(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_SGE(Instruction instr) {
+    const bool is_inverted = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SGEI;
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, is_inverted ? instr.common.src1i.Value() : instr.common.src1.Value());
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, is_inverted ? instr.common.src2i.Value() : instr.common.src2.Value());
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, SRC1);
+        Compile_LoadSrc(src2, comp, RESULT[comp]);
+        CMPPS(RESULT[comp], R(SRC1), CMP_LE);
+        ANDPS(RESULT[comp], R(ONE));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_SLT(Instruction instr) {
+    const bool is_inverted = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::SLTI;
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, is_inverted ? instr.common.src1i.Value() : instr.common.src1.Value());
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, is_inverted ? instr.common.src2i.Value() : instr.common.src2.Value());
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        CMPPS(RESULT[comp], R(SRC2), CMP_LT);
+        ANDPS(RESULT[comp], R(ONE));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_FLR(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        ROUNDFLOORPS(RESULT[comp], R(RESULT[comp]));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_MAX(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+        MAXPS(RESULT[comp], R(SRC2));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_MIN(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        // SSE semantics match PICA200 ones: In case of NaN, SRC2 is returned.
+        MINPS(RESULT[comp], R(SRC2));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_MOVA(Instruction instr) {
+    SwizzlePattern swiz = { setup->swizzle_data[instr.common.operand_desc_id] };
+
+    if (!swiz.DestComponentEnabled(0) && !swiz.DestComponentEnabled(1)) {
+        return; // NoOp
+    }
+
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        if (!swiz.DestComponentEnabled(comp))
+            continue;
+
+        Compile_LoadSrc(src1, comp, SRC1);
+
+        // Convert floats to integers using truncation and multiply by 16 to be used as an offset
+        CVTTPS2DQ(SRC1, R(SRC1));
+        PSLLD(SRC1, 4);
+
+        const int disp = static_cast<int>(offsetof(BatchUnitState, address_offsets) +
+                                          comp * sizeof(BatchUnitState::address_offsets[0]));
+        MOVAPS(SCRATCH, MDisp(STATE, disp));
+        BLENDVPS(SCRATCH, R(SRC1));
+        MOVAPS(MDisp(STATE, disp), SCRATCH);
+    }
+}
+
+void BatchJitShader::Compile_MOV(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_RCP(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    Compile_LoadSrc(src1, 0, RESULT[0]);
+
+    // RCPPS computes the same approximation for each lane as RCPSS does in JitShader
+    RCPPS(RESULT[0], R(RESULT[0]));
+
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_RSQ(Instruction instr) {
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    Compile_LoadSrc(src1, 0, RESULT[0]);
+
+    // RSQRTPS computes the same approximation for each lane as RSQRTSS does in JitShader
+    RSQRTPS(RESULT[0], R(RESULT[0]));
+
+    Compile_DestEnable(instr, {{ RESULT[0], RESULT[0], RESULT[0], RESULT[0] }});
+}
+
+void BatchJitShader::Compile_NOP(Instruction instr) {
+}
+
+void BatchJitShader::Compile_END(Instruction instr) {
+    // Vertices leaving the program while others are still running can't be tracked
+    MOVMSKPS(RAX, R(EXEC));
+    CMP(32, R(RAX), Imm8(0xF));
+    J_CC(CC_NE, diverged_code, true);
+    JMP(end_code, true);
+}
+
+void BatchJitShader::Compile_CALL(Instruction instr) {
+    // Push offset of the return
+    PUSH(64, Imm32(instr.flow_control.dest_offset + instr.flow_control.num_instructions));
+
+    // Call the subroutine
+    FixupBranch b = CALL();
+    fixup_branches.push_back({ b, instr.flow_control.dest_offset });
+
+    // Skip over the return offset that's on the stack
+    ADD(64, R(RSP), Imm32(8));
+}
+
+void BatchJitShader::Compile_CALLC(Instruction instr) {
+    Compile_EvaluateCondition(instr, SRC1);
+    ANDPS(SRC1, R(EXEC));
+
+    // Skip the call if no vertex takes it
+    MOVMSKPS(RAX, R(SRC1));
+    TEST(32, R(RAX), R(RAX));
+    FixupBranch b = J_CC(CC_Z, true);
+
+    // Run the subroutine with the vertices taking the call only. The mask is saved below the
+    // return offset pushed by Compile_CALL, which keeps the stack 16-byte aligned.
+    SUB(64, R(RSP), Imm8(16));
+    MOVAPS(MatR(RSP), EXEC);
+    MOVAPS(EXEC, R(SRC1));
+
+    Compile_CALL(instr);
+
+    MOVAPS(EXEC, MatR(RSP));
+    ADD(64, R(RSP), Imm8(16));
+
+    SetJumpTarget(b);
+}
+
+void BatchJitShader::Compile_CALLU(Instruction instr) {
+    Compile_UniformCondition(instr);
+    FixupBranch b = J_CC(CC_Z, true);
+    Compile_CALL(instr);
+    SetJumpTarget(b);
+}
+
+void BatchJitShader::Compile_CMP(Instruction instr) {
+    using Op = Instruction::Common::CompareOpType::Op;
+    const Op ops[] = { instr.common.compare_op.x, instr.common.compare_op.y };
+
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.common.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, instr.common.src2);
+
+    // See JitShader::Compile_CMP for why GT and GE are emulated by swapping the operands
+    static const u8 cmp[] = { CMP_EQ, CMP_NEQ, CMP_LT, CMP_LE, CMP_LT, CMP_LE };
+
+    for (unsigned comp = 0; comp < 2; ++comp) {
+        Compile_LoadSrc(src1, comp, SRC1);
+        Compile_LoadSrc(src2, comp, SRC2);
+
+        const bool invert_op = (ops[comp] == Op::GreaterThan || ops[comp] == Op::GreaterEqual);
+        const X64Reg lhs = invert_op ? SRC2 : SRC1;
+        const X64Reg rhs = invert_op ? SRC1 : SRC2;
+        CMPPS(lhs, R(rhs), cmp[ops[comp]]);
+
+        const int disp = static_cast<int>(offsetof(BatchUnitState, conditional_code) +
+                                          comp * sizeof(BatchUnitState::conditional_code[0]));
+        MOVAPS(SCRATCH, MDisp(STATE, disp));
+        BLENDVPS(SCRATCH, R(lhs));
+        MOVAPS(MDisp(STATE, disp), SCRATCH);
+    }
+}
+
+void BatchJitShader::Compile_MAD(Instruction instr) {
+    const bool is_inverted = instr.opcode.Value().EffectiveOpCode() == OpCode::Id::MADI;
+    const SourceOperand src1 = Compile_PrepareSrc(instr, 1, instr.mad.src1);
+    const SourceOperand src2 = Compile_PrepareSrc(instr, 2, is_inverted ? instr.mad.src2i.Value() : instr.mad.src2.Value());
+    const SourceOperand src3 = Compile_PrepareSrc(instr, 3, is_inverted ? instr.mad.src3i.Value() : instr.mad.src3.Value());
+    for (unsigned comp = 0; comp < 4; ++comp) {
+        Compile_LoadSrc(src1, comp, RESULT[comp]);
+        Compile_LoadSrc(src2, comp, SRC2);
+        Compile_SanitizedMul(RESULT[comp], SRC2, SCRATCH);
+        Compile_LoadSrc(src3, comp, SRC3);
+        ADDPS(RESULT[comp], R(SRC3));
+    }
+    Compile_DestEnable(instr, RESULT);
+}
+
+void BatchJitShader::Compile_IF(Instruction instr) {
+    if (instr.flow_control.dest_offset < program_counter) {
+        // Backwards if-statements aren't supported by JitShader either
+        supported = false;
+        return;
+    }
+
+    if (instr.opcode.Value() == OpCode::Id::IFU) {
+        // The condition is the same for all vertices, so this is compiled to plain branches
+        Compile_UniformCondition(instr);
+        FixupBranch b = J_CC(CC_Z, true);
+
+        Compile_Block(instr.flow_control.dest_offset);
+
+        if (instr.flow_control.num_instructions == 0) {
+            SetJumpTarget(b);
+            return;
+        }
+
+        FixupBranch b2 = J(true);
+        SetJumpTarget(b);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+        SetJumpTarget(b2);
+        return;
+    }
+
+    // Both branches are run with the vertices taking them enabled, each skipped if there are none.
+    // The enclosing execution mask and the one for the "ELSE" branch are kept on the stack.
+    Compile_EvaluateCondition(instr, SRC1);
+    SUB(64, R(RSP), Imm8(32));
+    MOVAPS(MatR(RSP), EXEC);
+    MOVAPS(SRC2, R(SRC1));
+    ANDNPS(SRC2, R(EXEC));
+    MOVAPS(MDisp(RSP, 16), SRC2);
+    ANDPS(EXEC, R(SRC1));
+    ++mask_depth;
+
+    MOVMSKPS(RAX, R(EXEC));
+    TEST(32, R(RAX), R(RAX));
+    FixupBranch skip_if = J_CC(CC_Z, true);
+    Compile_Block(instr.flow_control.dest_offset);
+    SetJumpTarget(skip_if);
+
+    if (instr.flow_control.num_instructions != 0) {
+        MOVAPS(EXEC, MDisp(RSP, 16));
+        MOVMSKPS(RAX, R(EXEC));
+        TEST(32, R(RAX), R(RAX));
+        FixupBranch skip_else = J_CC(CC_Z, true);
+        Compile_Block(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+        SetJumpTarget(skip_else);
+    }
+
+    --mask_depth;
+    MOVAPS(EXEC, MatR(RSP));
+    ADD(64, R(RSP), Imm8(32));
+}
+
+void BatchJitShader::Compile_LOOP(Instruction instr) {
+    if (instr.flow_control.dest_offset < program_counter || looping) {
+        // Backwards and nested loops aren't supported by JitShader either
+        supported = false;
+        return;
+    }
+
+    looping = true;
+
+    // The loop counter is shared by all vertices, so inactive vertices would see its final value
+    // afterwards. Loops are therefore only run as a batch while all vertices are active.
+    MOVMSKPS(RAX, R(EXEC));
+    CMP(32, R(RAX), Imm8(0xF));
+    J_CC(CC_NE, diverged_code, true);
+
+    // The loop parameters are uniforms, so all vertices run the same number of iterations
+    int offset = ShaderSetup::UniformOffset(RegisterType::IntUniform, instr.flow_control.int_uniform_id);
+    MOV(32, R(LOOPCOUNT), MDisp(SETUP, offset));
+    MOV(32, R(LOOPCOUNT_REG), R(LOOPCOUNT));
+    SHR(32, R(LOOPCOUNT_REG), Imm8(8));
+    AND(32, R(LOOPCOUNT_REG), Imm32(0xff)); // Y-component is the start
+    MOV(32, R(LOOPINC), R(LOOPCOUNT));
+    SHR(32, R(LOOPINC), Imm8(16));
+    MOVZX(32, 8, LOOPINC, R(LOOPINC)); // Z-component is the incrementer
+    MOVZX(32, 8, LOOPCOUNT, R(LOOPCOUNT)); // X-component is iteration count
+    ADD(32, R(LOOPCOUNT), Imm8(1)); // Iteration count is X-component + 1
+
+    auto loop_start = GetCodePtr();
+
+    Compile_Block(instr.flow_control.dest_offset + 1);
+
+    ADD(32, R(LOOPCOUNT_REG), R(LOOPINC)); // Increment LOOPCOUNT_REG by Z-component
+    SUB(32, R(LOOPCOUNT), Imm8(1)); // Increment loop count by 1
+    J_CC(CC_NZ, loop_start); // Loop if not equal
+
+    looping = false;
+}
+
+void BatchJitShader::Compile_Unsupported(Instruction instr) {
+    supported = false;
+}
+
+void BatchJitShader::Compile_JMP(Instruction instr) {
+    if (instr.opcode.Value() == OpCode::Id::JMPU) {
+        Compile_UniformCondition(instr);
+
+        const bool inverted_condition = (instr.flow_control.num_instructions & 1);
+        const CCFlags taken = inverted_condition ? CC_Z : CC_NZ;
+
+        if (mask_depth != 0) {
+            // Jumping out of an IFC block would leave its execution mask behind
+            J_CC(taken, diverged_code, true);
+        } else {
+            FixupBranch b = J_CC(taken, true);
+            fixup_branches.push_back({ b, instr.flow_control.dest_offset });
+        }
+        return;
+    }
+
+    Compile_EvaluateCondition(instr, SRC1);
+    ANDPS(SRC1, R(EXEC));
+
+    MOVMSKPS(RAX, R(SRC1));
+    TEST(32, R(RAX), R(RAX));
+    FixupBranch not_taken = J_CC(CC_Z, true);
+
+    // The jump can only be followed if all active vertices take it
+    if (mask_depth == 0) {
+        MOVMSKPS(RCX, R(EXEC));
+        CMP(32, R(RAX), R(RCX));
+        FixupBranch b = J_CC(CC_E, true);
+        fixup_branches.push_back({ b, instr.flow_control.dest_offset });
+    }
+    JMP(diverged_code, true);
+
+    SetJumpTarget(not_taken);
+}
+
+void BatchJitShader::Compile_Block(unsigned end) {
+    while (supported && program_counter < end) {
+        Compile_NextInstr();
+    }
+}
+
+void BatchJitShader::Compile_Return() {
+    // Peek return offset on the stack and check if we're at that offset
+    MOV(64, R(RAX), MDisp(RSP, 8));
+    CMP(32, R(RAX), Imm32(program_counter));
+
+    // If so, jump back to before CALL
+    FixupBranch b = J_CC(CC_NZ, true);
+    RET();
+    SetJumpTarget(b);
+}
+
+void BatchJitShader::Compile_NextInstr() {
+    if (GetSpaceLeft() < MAX_INSTRUCTION_SIZE) {
+        supported = false;
+        return;
+    }
+
+    if (std::binary_search(return_offsets.begin(), return_offsets.end(), program_counter)) {
+        // A return inside of an IFC block would need to pop its execution mask first
+        if (mask_depth != 0) {
+            supported = false;
+            return;
+        }
+        Compile_Return();
+    }
+
+    ASSERT_MSG(code_ptr[program_counter] == nullptr, "Tried to compile already compiled shader location!");
+    code_ptr[program_counter] = GetCodePtr();
+    code_mask_depth[program_counter] = mask_depth;
+
+    Instruction instr = GetShaderInstruction(program_counter++);
+
+    OpCode::Id opcode = instr.opcode.Value();
+    auto instr_func = batch_instr_table[static_cast<unsigned>(opcode)];
+
+    // Unhandled instructions are skipped, JitShader already reports them
+    if (instr_func) {
+        ((*this).*instr_func)(instr);
+    }
+}
+
+void BatchJitShader::FindReturnOffsets() {
+    return_offsets.clear();
+
+    for (size_t offset = 0; offset < setup->program_code.size(); ++offset) {
+        Instruction instr = GetShaderInstruction(offset);
+
+        switch (instr.opcode.Value()) {
+        case OpCode::Id::CALL:
+        case OpCode::Id::CALLC:
+        case OpCode::Id::CALLU:
+            return_offsets.push_back(instr.flow_control.dest_offset + instr.flow_control.num_instructions);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Sort for efficient binary search later
+    std::sort(return_offsets.begin(), return_offsets.end());
+}
+
+bool BatchJitShader::Compile(const ShaderSetup& setup) {
+    // Masked register writes are done with BLENDVPS
+    if (!Common::GetCPUCaps().sse4_1)
+        return false;
+
+    // Get a pointer to the setup to access program_code and swizzle_data
+    this->setup = &setup;
+
+    // Reset flow control state
+    program = (CompiledShader*)GetCodePtr();
+    program_counter = 0;
+    looping = false;
+    mask_depth = 0;
+    supported = true;
+    code_ptr.fill(nullptr);
+    code_mask_depth.fill(0);
+    fixup_branches.clear();
+
+    // Find all `CALL` instructions and identify return locations
+    FindReturnOffsets();
+
+    // The stack pointer is 8 modulo 16 at the entry of a procedure
+    ABI_PushRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+
+    MOV(PTRBITS, R(SETUP), R(ABI_PARAM1));
+    MOV(PTRBITS, R(STATE), R(ABI_PARAM2));
+    MOV(PTRBITS, R(FRAME), R(RSP));
+
+    // Zero loop register, address registers and conditional codes
+    XOR(64, R(LOOPCOUNT_REG), R(LOOPCOUNT_REG));
+    XORPS(SCRATCH, R(SCRATCH));
+    for (unsigned i = 0; i < 2; ++i) {
+        MOVAPS(MDisp(STATE, static_cast<int>(offsetof(BatchUnitState, conditional_code) +
+                                             i * sizeof(BatchUnitState::conditional_code[0]))), SCRATCH);
+        MOVAPS(MDisp(STATE, static_cast<int>(offsetof(BatchUnitState, address_offsets) +
+                                             i * sizeof(BatchUnitState::address_offsets[0]))), SCRATCH);
+    }
+
+    MOV(PTRBITS, R(RAX), ImmPtr(const_one));
+    MOVAPS(ONE, MatR(RAX));
+
+    MOV(PTRBITS, R(RAX), ImmPtr(const_neg));
+    MOVAPS(NEGBIT, MatR(RAX));
+
+    // All vertices start out active
+    PCMPEQD(EXEC, R(EXEC));
+
+    // Jump to start of the shader program
+    JMPptr(R(ABI_PARAM3));
+
+    // Epilogue, which is shared by all exits of the program and unwinds any subroutine calls
+    diverged_code = GetCodePtr();
+    XOR(32, R(RAX), R(RAX));
+    FixupBranch exit = J();
+
+    end_code = GetCodePtr();
+    MOV(32, R(RAX), Imm32(1));
+
+    SetJumpTarget(exit);
+    MOV(PTRBITS, R(RSP), R(FRAME));
+    ABI_PopRegistersAndAdjustStack(ABI_ALL_CALLEE_SAVED, 8);
+    RET();
+
+    // Compile entire program
+    Compile_Block(static_cast<unsigned>(this->setup->program_code.size()));
+
+    // Set the target for any incomplete branches now that the entire shader program has been
+    // emitted. Targets inside of IFC blocks would skip pushing the execution mask.
+    for (const auto& branch : fixup_branches) {
+        if (!supported)
+            break;
+
+        if (code_ptr[branch.second] == nullptr || code_mask_depth[branch.second] != 0) {
+            supported = false;
+        } else {
+            SetJumpTarget(branch.first, code_ptr[branch.second]);
+        }
+    }
+
+    // Free memory that's no longer needed
+    return_offsets.clear();
+    return_offsets.shrink_to_fit();
+    fixup_branches.clear();
+    fixup_branches.shrink_to_fit();
+
+    uintptr_t size = reinterpret_cast<uintptr_t>(GetCodePtr()) - reinterpret_cast<uintptr_t>(program);
+    LOG_DEBUG(HW_GPU, "Compiled batch shader size=%lu supported=%d", size, supported);
+
+    // We don't need the setup anymore
+    this->setup = nullptr;
+
+    return supported;
+}
+
+BatchJitShader::BatchJitShader() {
+    AllocCodeSpace(MAX_BATCH_SHADER_SIZE);
+}
+
+} // namespace Shader
+
+} // namespace Pica
@@ -0,0 +1,183 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <nihstro/shader_bytecode.h>
+
+#include "common/bit_set.h"
+#include "common/common_types.h"
+#include "common/x64/emitter.h"
+
+#include "video_core/shader/shader.h"
+
+using nihstro::Instruction;
+using nihstro::OpCode;
+using nihstro::SwizzlePattern;
+
+namespace Pica {
+
+namespace Shader {
+
+/// Memory allocated for each compiled batch shader (512Kb)
+constexpr size_t MAX_BATCH_SHADER_SIZE = 1024 * 512;
+
+/**
+ * Variant of the shader JIT compiler that shades SHADER_BATCH_SIZE vertices per invocation. Each
+ * component of a Pica register is kept in one SSE register, holding the value of that component
+ * for all vertices of the batch (see BatchUnitState).
+ *
+ * Flow control depending on uniforms (IFU, CALLU, JMPU, LOOP) is the same for all vertices and is
+ * compiled to branches. Flow control depending on the per-vertex conditional codes (IFC, CALLC) is
+ * implemented with an execution mask, which restricts register writes to the vertices taking the
+ * current path. Cases which can't be expressed that way, such as a JMPC only taken by some of the
+ * vertices, abort the program; the batch then has to be shaded one vertex at a time.
+ */
+class BatchJitShader : public Gen::XCodeBlock {
+public:
+    BatchJitShader();
+
+    /**
+     * Runs the program for all vertices of the batch
+     * @return False if the vertices diverged in a way that can't be handled by the compiled code.
+     *         The contents of `state` are undefined in that case.
+     */
+    bool Run(const ShaderSetup& setup, BatchUnitState& state, unsigned offset) const {
+        return program(&setup, &state, code_ptr[offset]);
+    }
+
+    /**
+     * Compiles the given shader program
+     * @return False if the program can't be run as a batch (e.g. because it is a geometry shader
+     *         or relatively addresses non-uniform registers), in which case it must not be run
+     */
+    bool Compile(const ShaderSetup& setup);
+
+    /// Returns the size of the compiled program in bytes
+    size_t GetCodeSize() const {
+        return static_cast<size_t>(GetCodePtr() - region);
+    }
+
+    void Compile_ADD(Instruction instr);
+    void Compile_DP3(Instruction instr);
+    void Compile_DP4(Instruction instr);
+    void Compile_DPH(Instruction instr);
+    void Compile_EX2(Instruction instr);
+    void Compile_LG2(Instruction instr);
+    void Compile_MUL(Instruction instr);
+    void Compile_SGE(Instruction instr);
+    void Compile_SLT(Instruction instr);
+    void Compile_FLR(Instruction instr);
+    void Compile_MAX(Instruction instr);
+    void Compile_MIN(Instruction instr);
+    void Compile_RCP(Instruction instr);
+    void Compile_RSQ(Instruction instr);
+    void Compile_MOVA(Instruction instr);
+    void Compile_MOV(Instruction instr);
+    void Compile_NOP(Instruction instr);
+    void Compile_END(Instruction instr);
+    void Compile_CALL(Instruction instr);
+    void Compile_CALLC(Instruction instr);
+    void Compile_CALLU(Instruction instr);
+    void Compile_IF(Instruction instr);
+    void Compile_LOOP(Instruction instr);
+    void Compile_Unsupported(Instruction instr);
+    void Compile_JMP(Instruction instr);
+    void Compile_CMP(Instruction instr);
+    void Compile_MAD(Instruction instr);
+
+private:
+    /// Location of a source operand, with relative addressing already resolved
+    struct SourceOperand {
+        Gen::X64Reg base;
+        Gen::X64Reg index;  ///< Additional byte offset, or INVALID_REG
+        int disp;
+        bool broadcast;     ///< True for uniforms, which are shared by all vertices of the batch
+        bool negate;
+        std::array<u8, 4> selector; ///< Source component of each swizzled component
+    };
+
+    void Compile_Block(unsigned end);
+    void Compile_NextInstr();
+
+    /**
+     * Resolves the location of a source register. Relatively addressed float uniforms are gathered
+     * into the scratch memory of the state, clobbering RAX and all SIMD scratch registers.
+     * @param instr VS instruction, used for determining how to load the source register
+     * @param src_num Number indicating which source register to load (1 = src1, 2 = src2, 3 = src3)
+     * @param src_reg SourceRegister object corresponding to the source register to load
+     */
+    SourceOperand Compile_PrepareSrc(Instruction instr, unsigned src_num, SourceRegister src_reg);
+
+    /// Loads a component of a swizzled source operand into the specified XMM register
+    void Compile_LoadSrc(const SourceOperand& src, unsigned comp, Gen::X64Reg dest);
+
+    /**
+     * Writes the enabled components of the destination register for all active vertices
+     * @param results XMM register holding each component of the result
+     */
+    void Compile_DestEnable(Instruction instr, const std::array<Gen::X64Reg, 4>& results);
+
+    /// See JitShader::Compile_SanitizedMul
+    void Compile_SanitizedMul(Gen::X64Reg src1, Gen::X64Reg src2, Gen::X64Reg scratch);
+
+    /// Computes the sum of the component products held in the result registers, see Compile_DP4
+    void Compile_SumProducts(unsigned num_components);
+
+    /// Calls `func` on the X component of the first source operand for each vertex
+    void Compile_CallPerLane(Instruction instr, const void* func);
+
+    /// Evaluates the condition of the instruction for each vertex, as a lane mask in `dest`
+    void Compile_EvaluateCondition(Instruction instr, Gen::X64Reg dest);
+    void Compile_UniformCondition(Instruction instr);
+
+    /// Emits the code to conditionally return from a subroutine, see JitShader::Compile_Return
+    void Compile_Return();
+
+    BitSet32 PersistentCallerSavedRegs();
+
+    Instruction GetShaderInstruction(size_t offset) {
+        Instruction instruction;
+        std::memcpy(&instruction, &setup->program_code[offset], sizeof(Instruction));
+        return instruction;
+    }
+
+    void FindReturnOffsets();
+
+    /// Mapping of Pica VS instructions to pointers in the emitted code
+    std::array<const u8*, 1024> code_ptr;
+
+    /// Number of execution masks on the stack when each instruction was compiled
+    std::array<unsigned, 1024> code_mask_depth;
+
+    /// Offsets in code where a return needs to be inserted
+    std::vector<unsigned> return_offsets;
+
+    unsigned program_counter = 0;       ///< Offset of the next instruction to decode
+    bool looping = false;               ///< True if compiling a loop, used to check for nested loops
+    unsigned mask_depth = 0;            ///< Number of execution masks pushed by enclosing blocks
+    bool supported = true;              ///< Cleared when encountering code that can't be batched
+
+    /// Exits the program, reporting success or divergence respectively
+    const u8* end_code = nullptr;
+    const u8* diverged_code = nullptr;
+
+    /// Branches that need to be fixed up once the entire shader program is compiled
+    std::vector<std::pair<Gen::FixupBranch, unsigned>> fixup_branches;
+
+    using CompiledShader = bool(const void* setup, void* state, const u8* start_addr);
+    CompiledShader* program = nullptr;
+
+    const ShaderSetup* setup = nullptr;
+};
+
+} // Shader
+
+} // Pica
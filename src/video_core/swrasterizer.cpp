@@ -3,6 +3,7 @@
 // Refer to the license.txt file included.
 
 #include "video_core/clipper.h"
+#include "video_core/rasterizer.h"
 #include "video_core/swrasterizer.h"
 
 namespace VideoCore {
@@ -13,4 +14,25 @@ void SWRasterizer::AddTriangle(const Pica::Shader::OutputVertex& v0,
     Pica::Clipper::ProcessTriangle(v0, v1, v2);
 }
 
+void SWRasterizer::DrawTriangles() {
+    Pica::Rasterizer::FlushBinnedTriangles();
+}
+
+void SWRasterizer::NotifyPicaRegisterChanged(u32 id) {
+    // Binned triangles must be drawn with the register state they were submitted with
+    Pica::Rasterizer::FlushBinnedTriangles();
+}
+
+void SWRasterizer::FlushAll() {
+    Pica::Rasterizer::FlushBinnedTriangles();
+}
+
+void SWRasterizer::FlushRegion(PAddr addr, u32 size) {
+    Pica::Rasterizer::FlushBinnedTriangles();
+}
+
+void SWRasterizer::FlushAndInvalidateRegion(PAddr addr, u32 size) {
+    Pica::Rasterizer::FlushBinnedTriangles();
+}
+
 }
@@ -0,0 +1,523 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#ifdef ARCHITECTURE_x86_64
+#include <emmintrin.h>
+#endif
+
+#include "common/assert.h"
+#include "common/bit_field.h"
+#include "common/color.h"
+#include "common/common_types.h"
+#include "common/hash.h"
+#include "common/logging/log.h"
+#include "common/math_util.h"
+#include "common/vector_math.h"
+
+#include "video_core/texture_decoder.h"
+#include "video_core/utils.h"
+
+namespace Pica {
+
+namespace TextureDecoder {
+
+/// Texels are written to dest[y * stride + x], the stride may be negative to flip the tile
+using TileFunction = void (*)(const u8* source, Math::Vec4<u8>* dest, ptrdiff_t stride);
+
+/// Coordinates (y * TILE_SIZE + x) of the texels of a tile, indexed by their Morton offset
+static const std::array<u8, TEXELS_PER_TILE> morton_to_position = [] {
+    std::array<u8, TEXELS_PER_TILE> table;
+    for (u32 y = 0; y < TILE_SIZE; ++y) {
+        for (u32 x = 0; x < TILE_SIZE; ++x) {
+            table[VideoCore::MortonInterleave(x, y)] = static_cast<u8>(y * TILE_SIZE + x);
+        }
+    }
+    return table;
+}();
+
+static inline Math::Vec4<u8>* TexelAt(Math::Vec4<u8>* dest, ptrdiff_t stride, unsigned position) {
+    return dest + (position / TILE_SIZE) * stride + position % TILE_SIZE;
+}
+
+template <Regs::TextureFormat format>
+static Math::Vec4<u8> DecodeTexel(const u8* source, unsigned morton_offset);
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RGBA8>(const u8* source, unsigned i) {
+    return Color::DecodeRGBA8(source + i * 4);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RGB8>(const u8* source, unsigned i) {
+    return Color::DecodeRGB8(source + i * 3);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RGB5A1>(const u8* source, unsigned i) {
+    return Color::DecodeRGB5A1(source + i * 2);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RGB565>(const u8* source, unsigned i) {
+    return Color::DecodeRGB565(source + i * 2);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RGBA4>(const u8* source, unsigned i) {
+    return Color::DecodeRGBA4(source + i * 2);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::IA8>(const u8* source, unsigned i) {
+    const u8 intensity = source[i * 2 + 1];
+    return { intensity, intensity, intensity, source[i * 2] };
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::RG8>(const u8* source, unsigned i) {
+    return Color::DecodeRG8(source + i * 2);
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::I8>(const u8* source, unsigned i) {
+    return { source[i], source[i], source[i], 255 };
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::A8>(const u8* source, unsigned i) {
+    return { 0, 0, 0, source[i] };
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::IA4>(const u8* source, unsigned i) {
+    const u8 intensity = Color::Convert4To8(source[i] >> 4);
+    return { intensity, intensity, intensity, Color::Convert4To8(source[i] & 0xF) };
+}
+
+/// Odd texels of the 4-bit formats are stored in the upper nibble
+static inline u8 GetNibble(const u8* source, unsigned i) {
+    return Color::Convert4To8((i % 2) ? (source[i / 2] >> 4) : (source[i / 2] & 0xF));
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::I4>(const u8* source, unsigned i) {
+    const u8 intensity = GetNibble(source, i);
+    return { intensity, intensity, intensity, 255 };
+}
+
+template <>
+Math::Vec4<u8> DecodeTexel<Regs::TextureFormat::A4>(const u8* source, unsigned i) {
+    return { 0, 0, 0, GetNibble(source, i) };
+}
+
+template <Regs::TextureFormat format>
+static void DecodeTileScalar(const u8* source, Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    for (unsigned i = 0; i < TEXELS_PER_TILE; ++i)
+        *TexelAt(dest, stride, morton_to_position[i]) = DecodeTexel<format>(source, i);
+}
+
+// ETC1 tiles are split into four 4x4 subtiles of 64 bits each. ETC1A4 additionally stores 64 bits
+// of 4-bit alpha values in front of each subtile. Each half of a subtile (its left and right or,
+// if flipped, its top and bottom half) has a base color and one of eight modifier tables, and each
+// texel selects one of the four modifiers of its half. Hence a subtile can only contain eight
+// distinct colors, which are computed up front.
+
+union ETC1Subtile {
+    u64 raw;
+
+    // One bit per texel each, texels are numbered by 4 * x + y
+    BitField< 0, 16, u64> table_subindexes;
+    BitField<16, 16, u64> negation_flags;
+
+    BitField<32, 1, u64> flip;
+    BitField<33, 1, u64> differential_mode;
+
+    BitField<34, 3, u64> table_index_2;
+    BitField<37, 3, u64> table_index_1;
+
+    union {
+        // delta value + base value
+        BitField<40, 3, s64> db;
+        BitField<43, 5, u64> b;
+
+        BitField<48, 3, s64> dg;
+        BitField<51, 5, u64> g;
+
+        BitField<56, 3, s64> dr;
+        BitField<59, 5, u64> r;
+    } differential;
+
+    union {
+        BitField<40, 4, u64> b2;
+        BitField<44, 4, u64> b1;
+
+        BitField<48, 4, u64> g2;
+        BitField<52, 4, u64> g1;
+
+        BitField<56, 4, u64> r2;
+        BitField<60, 4, u64> r1;
+    } separate;
+
+    /// Returns the base color of the given half of the subtile
+    Math::Vec3<u8> GetBaseColor(unsigned half) const {
+        if (differential_mode) {
+            Math::Vec3<int> color{ static_cast<int>(differential.r),
+                                   static_cast<int>(differential.g),
+                                   static_cast<int>(differential.b) };
+            if (half == 1) {
+                color.r() += static_cast<int>(differential.dr);
+                color.g() += static_cast<int>(differential.dg);
+                color.b() += static_cast<int>(differential.db);
+            }
+            return { Color::Convert5To8(static_cast<u8>(color.r())),
+                     Color::Convert5To8(static_cast<u8>(color.g())),
+                     Color::Convert5To8(static_cast<u8>(color.b())) };
+        }
+
+        if (half == 0) {
+            return { Color::Convert4To8(static_cast<u8>(separate.r1)),
+                     Color::Convert4To8(static_cast<u8>(separate.g1)),
+                     Color::Convert4To8(static_cast<u8>(separate.b1)) };
+        }
+        return { Color::Convert4To8(static_cast<u8>(separate.r2)),
+                 Color::Convert4To8(static_cast<u8>(separate.g2)),
+                 Color::Convert4To8(static_cast<u8>(separate.b2)) };
+    }
+
+    unsigned GetTableIndex(unsigned half) const {
+        return static_cast<unsigned>(half == 0 ? table_index_1 : table_index_2);
+    }
+};
+
+static const std::array<std::array<u8, 2>, 8> etc1_modifier_table = {{
+    {{  2,  8 }}, {{  5, 17 }}, {{  9,  29 }}, {{ 13,  42 }},
+    {{ 18, 60 }}, {{ 24, 80 }}, {{ 33, 106 }}, {{ 47, 183 }}
+}};
+
+/**
+ * Colors of a subtile as RGB with zero alpha, indexed by
+ * (negation flag << 2) | (half << 1) | table subindex
+ */
+using ETC1Palette = std::array<u32, 8>;
+
+static inline u32 PackRGB(int r, int g, int b) {
+    return static_cast<u32>(r) | static_cast<u32>(g) << 8 | static_cast<u32>(b) << 16;
+}
+
+static void BuildETC1PaletteScalar(const ETC1Subtile& subtile, ETC1Palette& palette) {
+    for (unsigned half = 0; half < 2; ++half) {
+        const Math::Vec3<u8> base = subtile.GetBaseColor(half);
+        const auto& modifiers = etc1_modifier_table[subtile.GetTableIndex(half)];
+        for (unsigned subindex = 0; subindex < 2; ++subindex) {
+            const int modifier = modifiers[subindex];
+            palette[half << 1 | subindex] = PackRGB(std::min(base.r() + modifier, 255),
+                                                    std::min(base.g() + modifier, 255),
+                                                    std::min(base.b() + modifier, 255));
+            palette[4 | half << 1 | subindex] = PackRGB(std::max(base.r() - modifier, 0),
+                                                        std::max(base.g() - modifier, 0),
+                                                        std::max(base.b() - modifier, 0));
+        }
+    }
+}
+
+template <void (*BuildPalette)(const ETC1Subtile&, ETC1Palette&), bool has_alpha>
+static void DecodeETC1Tile(const u8* source, Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    for (unsigned subtile_index = 0; subtile_index < 4; ++subtile_index) {
+        u64 alpha = 0xFFFFFFFFFFFFFFFF;
+        if (has_alpha) {
+            std::memcpy(&alpha, source, sizeof(alpha));
+            source += sizeof(alpha);
+        }
+
+        ETC1Subtile subtile;
+        std::memcpy(&subtile.raw, source, sizeof(subtile.raw));
+        source += sizeof(subtile.raw);
+
+        ETC1Palette palette;
+        BuildPalette(subtile, palette);
+
+        const u32 subindexes = static_cast<u32>(subtile.table_subindexes);
+        const u32 negation_flags = static_cast<u32>(subtile.negation_flags);
+        const bool flip = subtile.flip != 0;
+
+        Math::Vec4<u8>* subtile_dest = dest + (subtile_index / 2) * 4 * stride + (subtile_index % 2) * 4;
+        for (unsigned y = 0; y < 4; ++y) {
+            for (unsigned x = 0; x < 4; ++x) {
+                const unsigned texel = 4 * x + y;
+                const unsigned half = flip ? (y >= 2) : (x >= 2);
+                const unsigned index = ((negation_flags >> texel) & 1) << 2 | half << 1 |
+                                       ((subindexes >> texel) & 1);
+                const u32 rgba = palette[index] |
+                                 static_cast<u32>(Color::Convert4To8((alpha >> (4 * texel)) & 0xF)) << 24;
+                std::memcpy(&subtile_dest[y * stride + x], &rgba, sizeof(rgba));
+            }
+        }
+    }
+}
+
+#ifdef ARCHITECTURE_x86_64
+
+// The SSE2 kernels produce four texels of a 2x2 block per register, in Morton order. Two
+// registers holding horizontally adjacent blocks are stored as two rows of four texels.
+
+static inline void StoreBlockPair(__m128i left, __m128i right, Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), _mm_unpacklo_epi64(left, right));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + stride), _mm_unpackhi_epi64(left, right));
+}
+
+/// Stores the 16 texels of the 4x4 subtile at the given Morton offset
+static inline void StoreSubtile(const __m128i blocks[4], unsigned morton_offset,
+                                Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    dest = TexelAt(dest, stride, morton_to_position[morton_offset]);
+    StoreBlockPair(blocks[0], blocks[1], dest, stride);
+    StoreBlockPair(blocks[2], blocks[3], dest + 2 * stride, stride);
+}
+
+static void DecodeRGBA8SSE2(const u8* source, Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    for (unsigned subtile = 0; subtile < 4; ++subtile) {
+        __m128i blocks[4];
+        for (unsigned block = 0; block < 4; ++block) {
+            // Texels are stored as ABGR, reverse the bytes of each of them
+            __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source) + subtile * 4 + block);
+            texels = _mm_shufflelo_epi16(texels, _MM_SHUFFLE(2, 3, 0, 1));
+            texels = _mm_shufflehi_epi16(texels, _MM_SHUFFLE(2, 3, 0, 1));
+            blocks[block] = _mm_or_si128(_mm_slli_epi16(texels, 8), _mm_srli_epi16(texels, 8));
+        }
+        StoreSubtile(blocks, subtile * 16, dest, stride);
+    }
+}
+
+/// Replicates the upper bits of 5-bit components in the lower 16-bit lanes, as Color::Convert5To8
+static inline __m128i Expand5To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 3), _mm_srli_epi16(value, 2));
+}
+
+static inline __m128i Expand4To8(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 4), value);
+}
+
+/**
+ * Converts eight 16-bit texels to (r | g << 8) and (b | a << 8) in 16-bit lanes
+ */
+using Expand16Function = void (*)(__m128i texels, __m128i& rg, __m128i& ba);
+
+static void ExpandRGB565(__m128i texels, __m128i& rg, __m128i& ba) {
+    const __m128i r = Expand5To8(_mm_srli_epi16(texels, 11));
+    const __m128i g6 = _mm_and_si128(_mm_srli_epi16(texels, 5), _mm_set1_epi16(0x3F));
+    const __m128i g = _mm_or_si128(_mm_slli_epi16(g6, 2), _mm_srli_epi16(g6, 4));
+    const __m128i b = Expand5To8(_mm_and_si128(texels, _mm_set1_epi16(0x1F)));
+    rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    ba = _mm_or_si128(b, _mm_set1_epi16(static_cast<s16>(0xFF00)));
+}
+
+static void ExpandRGB5A1(__m128i texels, __m128i& rg, __m128i& ba) {
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    const __m128i r = Expand5To8(_mm_srli_epi16(texels, 11));
+    const __m128i g = Expand5To8(_mm_and_si128(_mm_srli_epi16(texels, 6), mask));
+    const __m128i b = Expand5To8(_mm_and_si128(_mm_srli_epi16(texels, 1), mask));
+    // Broadcast the alpha bit to the whole lane
+    const __m128i a = _mm_srai_epi16(_mm_slli_epi16(texels, 15), 15);
+    rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    ba = _mm_or_si128(b, _mm_and_si128(a, _mm_set1_epi16(static_cast<s16>(0xFF00))));
+}
+
+static void ExpandRGBA4(__m128i texels, __m128i& rg, __m128i& ba) {
+    const __m128i mask = _mm_set1_epi16(0xF);
+    const __m128i r = Expand4To8(_mm_srli_epi16(texels, 12));
+    const __m128i g = Expand4To8(_mm_and_si128(_mm_srli_epi16(texels, 8), mask));
+    const __m128i b = Expand4To8(_mm_and_si128(_mm_srli_epi16(texels, 4), mask));
+    const __m128i a = Expand4To8(_mm_and_si128(texels, mask));
+    rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    ba = _mm_or_si128(b, _mm_slli_epi16(a, 8));
+}
+
+static void ExpandIA8(__m128i texels, __m128i& rg, __m128i& ba) {
+    // Alpha is stored in the lower byte and intensity in the upper one
+    const __m128i intensity = _mm_srli_epi16(texels, 8);
+    rg = _mm_or_si128(intensity, _mm_slli_epi16(intensity, 8));
+    ba = _mm_or_si128(intensity, _mm_slli_epi16(texels, 8));
+}
+
+template <Expand16Function Expand>
+static void Decode16SSE2(const u8* source, Math::Vec4<u8>* dest, ptrdiff_t stride) {
+    for (unsigned subtile = 0; subtile < 4; ++subtile) {
+        __m128i blocks[4];
+        for (unsigned half = 0; half < 2; ++half) {
+            const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source) + subtile * 2 + half);
+            __m128i rg, ba;
+            Expand(texels, rg, ba);
+            blocks[half * 2] = _mm_unpacklo_epi16(rg, ba);
+            blocks[half * 2 + 1] = _mm_unpackhi_epi16(rg, ba);
+        }
+        StoreSubtile(blocks, subtile * 16, dest, stride);
+    }
+}
+
+static void BuildETC1PaletteSSE2(const ETC1Subtile& subtile, ETC1Palette& palette) {
+    const Math::Vec3<u8> base1 = subtile.GetBaseColor(0);
+    const Math::Vec3<u8> base2 = subtile.GetBaseColor(1);
+    const auto& modifiers1 = etc1_modifier_table[subtile.GetTableIndex(0)];
+    const auto& modifiers2 = etc1_modifier_table[subtile.GetTableIndex(1)];
+
+    const u32 rgb1 = PackRGB(base1.r(), base1.g(), base1.b());
+    const u32 rgb2 = PackRGB(base2.r(), base2.g(), base2.b());
+    const __m128i base = _mm_setr_epi32(rgb1, rgb1, rgb2, rgb2);
+    const __m128i modifiers = _mm_setr_epi32(modifiers1[0] * 0x010101, modifiers1[1] * 0x010101,
+                                             modifiers2[0] * 0x010101, modifiers2[1] * 0x010101);
+
+    // Saturating arithmetic clamps the components to [0, 255]
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(palette.data()), _mm_adds_epu8(base, modifiers));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(palette.data() + 4), _mm_subs_epu8(base, modifiers));
+}
+
+#endif // ARCHITECTURE_x86_64
+
+static TileFunction GetTileFunction(Regs::TextureFormat format) {
+    switch (format) {
+#ifdef ARCHITECTURE_x86_64
+    case Regs::TextureFormat::RGBA8:
+        return DecodeRGBA8SSE2;
+    case Regs::TextureFormat::RGB5A1:
+        return Decode16SSE2<ExpandRGB5A1>;
+    case Regs::TextureFormat::RGB565:
+        return Decode16SSE2<ExpandRGB565>;
+    case Regs::TextureFormat::RGBA4:
+        return Decode16SSE2<ExpandRGBA4>;
+    case Regs::TextureFormat::IA8:
+        return Decode16SSE2<ExpandIA8>;
+    case Regs::TextureFormat::ETC1:
+        return DecodeETC1Tile<BuildETC1PaletteSSE2, false>;
+    case Regs::TextureFormat::ETC1A4:
+        return DecodeETC1Tile<BuildETC1PaletteSSE2, true>;
+#else
+    case Regs::TextureFormat::RGBA8:
+        return DecodeTileScalar<Regs::TextureFormat::RGBA8>;
+    case Regs::TextureFormat::RGB5A1:
+        return DecodeTileScalar<Regs::TextureFormat::RGB5A1>;
+    case Regs::TextureFormat::RGB565:
+        return DecodeTileScalar<Regs::TextureFormat::RGB565>;
+    case Regs::TextureFormat::RGBA4:
+        return DecodeTileScalar<Regs::TextureFormat::RGBA4>;
+    case Regs::TextureFormat::IA8:
+        return DecodeTileScalar<Regs::TextureFormat::IA8>;
+    case Regs::TextureFormat::ETC1:
+        return DecodeETC1Tile<BuildETC1PaletteScalar, false>;
+    case Regs::TextureFormat::ETC1A4:
+        return DecodeETC1Tile<BuildETC1PaletteScalar, true>;
+#endif
+    case Regs::TextureFormat::RGB8:
+        return DecodeTileScalar<Regs::TextureFormat::RGB8>;
+    case Regs::TextureFormat::RG8:
+        return DecodeTileScalar<Regs::TextureFormat::RG8>;
+    case Regs::TextureFormat::I8:
+        return DecodeTileScalar<Regs::TextureFormat::I8>;
+    case Regs::TextureFormat::A8:
+        return DecodeTileScalar<Regs::TextureFormat::A8>;
+    case Regs::TextureFormat::IA4:
+        return DecodeTileScalar<Regs::TextureFormat::IA4>;
+    case Regs::TextureFormat::I4:
+        return DecodeTileScalar<Regs::TextureFormat::I4>;
+    case Regs::TextureFormat::A4:
+        return DecodeTileScalar<Regs::TextureFormat::A4>;
+    default:
+        LOG_ERROR(HW_GPU, "Unknown texture format: %x", (u32)format);
+        DEBUG_ASSERT(false);
+        return nullptr;
+    }
+}
+
+/// Size in bytes of an encoded tile, indexed by format
+static const std::array<u16, 14> tile_sizes = {{
+    // RGBA8, RGB8, RGB5A1, RGB565, RGBA4, IA8, RG8, I8, A8, IA4, I4, A4, ETC1, ETC1A4
+    256, 192, 128, 128, 128, 128, 128, 64, 64, 64, 32, 32, 32, 64
+}};
+
+size_t GetTileSize(Regs::TextureFormat format) {
+    const size_t index = static_cast<size_t>(format);
+    if (index >= tile_sizes.size())
+        return Regs::NibblesPerPixel(format) * TEXELS_PER_TILE / 2;
+    return tile_sizes[index];
+}
+
+void DecodeTile(Regs::TextureFormat format, const u8* source, DecodedTile& dest) {
+    const TileFunction decode = GetTileFunction(format);
+    if (decode != nullptr)
+        decode(source, dest.data(), TILE_SIZE);
+    else
+        dest.fill({});
+}
+
+void DecodeTexture(const DebugUtils::TextureInfo& info, const u8* source, Math::Vec4<u8>* dest,
+                   bool flip_vertically) {
+    DEBUG_ASSERT(info.width % TILE_SIZE == 0 && info.height % TILE_SIZE == 0);
+
+    const TileFunction decode = GetTileFunction(info.format);
+    if (decode == nullptr) {
+        std::fill(dest, dest + info.width * info.height, Math::Vec4<u8>{});
+        return;
+    }
+
+    const size_t tile_size = GetTileSize(info.format);
+    const size_t row_size = tile_size * (info.width / TILE_SIZE);
+    const ptrdiff_t stride = flip_vertically ? -info.width : info.width;
+
+    for (int tile_y = 0; tile_y < info.height / TILE_SIZE; ++tile_y) {
+        const int first_row = flip_vertically ? info.height - 1 - tile_y * TILE_SIZE : tile_y * TILE_SIZE;
+        for (int tile_x = 0; tile_x < info.width / TILE_SIZE; ++tile_x) {
+            decode(source + tile_y * row_size + tile_x * tile_size,
+                   dest + first_row * info.width + tile_x * TILE_SIZE, stride);
+        }
+    }
+}
+
+/// Number of tiles held by a TileCache, about 140 KiB of decoded texels
+static constexpr size_t TILE_CACHE_SIZE = 512;
+
+TileCache::TileCache() : entries(TILE_CACHE_SIZE) {
+    for (Entry& entry : entries) {
+        // Tiles are at least 32 byte aligned, so this never matches
+        entry.address = 0xFFFFFFFF;
+    }
+}
+
+const TileCache::Entry& TileCache::GetTile(const u8* source, PAddr address,
+                                           Regs::TextureFormat format, u32 generation) {
+    // Fibonacci hashing, since the tiles of a texture are evenly spaced
+    const size_t index = ((address >> 5) * 0x9E3779B1u >> 16) % TILE_CACHE_SIZE;
+    Entry& entry = entries[index];
+    if (entry.address == address && entry.format == format && entry.generation == generation)
+        return entry;
+
+    const size_t tile_size = GetTileSize(format);
+    const u64 hash = Common::ComputeHash64(source, static_cast<int>(tile_size));
+    if (entry.address != address || entry.format != format || entry.hash != hash) {
+        entry.address = address;
+        entry.format = format;
+        entry.hash = hash;
+        DecodeTile(format, source, entry.texels);
+    }
+    entry.generation = generation;
+    return entry;
+}
+
+const Math::Vec4<u8>& TileCache::LookupTexel(const u8* source, int x, int y,
+                                             const DebugUtils::TextureInfo& info, u32 generation) {
+    const unsigned tile_x = static_cast<unsigned>(x) / TILE_SIZE;
+    const unsigned tile_y = static_cast<unsigned>(y) / TILE_SIZE;
+    const unsigned tiles_per_row = static_cast<unsigned>(info.width) / TILE_SIZE;
+    const u32 offset = (tile_y * tiles_per_row + tile_x) * static_cast<u32>(GetTileSize(info.format));
+
+    const Entry& entry = GetTile(source + offset, info.physical_address + offset,
+                                 info.format, generation);
+    return entry.texels[(static_cast<unsigned>(y) % TILE_SIZE) * TILE_SIZE + static_cast<unsigned>(x) % TILE_SIZE];
+}
+
+} // namespace TextureDecoder
+
+} // namespace Pica
@@ -0,0 +1,98 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include "common/common_types.h"
+#include "common/vector_math.h"
+
+#include "video_core/debug_utils/debug_utils.h"
+#include "video_core/pica.h"
+
+namespace Pica {
+
+/**
+ * Decoding of PICA textures to RGBA8. Textures are stored as 8x8 tiles with their texels in Morton
+ * order, so a whole tile is decoded at once rather than looking up each texel separately: the
+ * format is only dispatched on once per tile, and the common formats have SIMD kernels.
+ *
+ * Rows are numbered in memory order, i.e. row 0 is the first row of the first tile, matching the
+ * coordinates accepted by DebugUtils::LookupTexture.
+ */
+namespace TextureDecoder {
+
+/// Width and height of a tile, in texels
+constexpr int TILE_SIZE = 8;
+constexpr int TEXELS_PER_TILE = TILE_SIZE * TILE_SIZE;
+
+/// Texels of a decoded tile, row by row
+using DecodedTile = std::array<Math::Vec4<u8>, TEXELS_PER_TILE>;
+
+/// Returns the size in bytes of an encoded tile of the given format
+size_t GetTileSize(Regs::TextureFormat format);
+
+/**
+ * Decodes a single tile
+ * @param format Format of the tile
+ * @param source Encoded tile, GetTileSize(format) bytes
+ * @param dest Decoded texels
+ */
+void DecodeTile(Regs::TextureFormat format, const u8* source, DecodedTile& dest);
+
+/**
+ * Decodes a whole texture. The width and height of the texture must be multiples of TILE_SIZE.
+ * @param info Texture to decode
+ * @param source Encoded texture data
+ * @param dest Buffer of info.width * info.height texels, written row by row
+ * @param flip_vertically If true, the last row in memory is written first, as OpenGL expects
+ */
+void DecodeTexture(const DebugUtils::TextureInfo& info, const u8* source, Math::Vec4<u8>* dest,
+                   bool flip_vertically = false);
+
+/**
+ * Direct-mapped cache of decoded tiles, used by the software rasterizer to sample textures. Tiles
+ * are identified by their physical address and format, and validated against a hash of their
+ * encoded data. As hashing costs about as much as decoding the simple formats, a tile is only
+ * validated the first time it is used in each generation: the owner has to pass a new generation
+ * whenever texture memory may have been modified.
+ *
+ * A cache must only be used by a single thread at a time.
+ */
+class TileCache final {
+public:
+    TileCache();
+
+    /**
+     * Returns the texel at the given coordinates, decoding its tile if needed
+     * @param source Encoded texture data, starting at info.physical_address
+     * @param x,y Coordinates of the texel, with the rows in memory order
+     * @param info Texture to sample
+     * @param generation Current generation, tiles cached in other generations get re-validated
+     */
+    const Math::Vec4<u8>& LookupTexel(const u8* source, int x, int y,
+                                      const DebugUtils::TextureInfo& info, u32 generation);
+
+private:
+    struct Entry {
+        PAddr address;
+        Regs::TextureFormat format;
+        u32 generation;
+        u64 hash;
+        DecodedTile texels;
+    };
+
+    /// Looks up the entry of the given tile, decoding or re-validating it if needed
+    const Entry& GetTile(const u8* source, PAddr address, Regs::TextureFormat format,
+                         u32 generation);
+
+    std::vector<Entry> entries;
+};
+
+} // namespace TextureDecoder
+
+} // namespace Pica
@@ -1,4 +1,5 @@
 #include <memory>
+#include <unordered_map>
 
 #include <boost/range/algorithm/fill.hpp>
 
@@ -6,6 +7,7 @@
 #include "common/assert.h"
 #include "common/bit_field.h"
 #include "common/common_types.h"
+#include "common/hash.h"
 #include "common/logging/log.h"
 #include "common/vector_math.h"
 
@@ -18,8 +20,39 @@
 #include "video_core/shader/shader.h"
 #include "video_core/vertex_loader.h"
 
+#ifdef ARCHITECTURE_x86_64
+#include "video_core/vertex_loader_jit_x64.h"
+#endif // ARCHITECTURE_x86_64
+
+#include "video_core/video_core.h"
+
 namespace Pica {
 
+#ifdef ARCHITECTURE_x86_64
+static std::unordered_map<u64, std::unique_ptr<VertexLoaderJit>> loader_map;
+#endif // ARCHITECTURE_x86_64
+
+void VertexLoader::ClearCache() {
+#ifdef ARCHITECTURE_x86_64
+    loader_map.clear();
+#endif // ARCHITECTURE_x86_64
+}
+
+u64 VertexLoader::GetLayoutHash() const {
+    // Everything LoadVertex depends on, packed into one buffer so that it can be hashed at once
+    std::array<u32, 16 * 5 + 1> layout;
+    for (int i = 0; i < 16; ++i) {
+        layout[i * 5 + 0] = vertex_attribute_sources[i];
+        layout[i * 5 + 1] = vertex_attribute_strides[i];
+        layout[i * 5 + 2] = static_cast<u32>(vertex_attribute_formats[i]);
+        layout[i * 5 + 3] = vertex_attribute_elements[i];
+        layout[i * 5 + 4] = vertex_attribute_is_default[i];
+    }
+    layout[16 * 5] = static_cast<u32>(num_total_attributes);
+
+    return Common::ComputeHash64(layout.data(), sizeof(layout));
+}
+
 void VertexLoader::Setup(const Pica::Regs& regs) {
     ASSERT_MSG(!is_setup, "VertexLoader is not intended to be setup more than once.");
 
@@ -64,11 +97,40 @@ void VertexLoader::Setup(const Pica::Regs& regs) {
     }
 
     is_setup = true;
+
+#ifdef ARCHITECTURE_x86_64
+    if (VideoCore::g_shader_jit_enabled) {
+        const u64 cache_key = GetLayoutHash();
+
+        auto iter = loader_map.find(cache_key);
+        if (iter != loader_map.end()) {
+            jit_loader = iter->second.get();
+        } else {
+            auto loader = std::make_unique<VertexLoaderJit>();
+            loader->Compile(*this);
+            jit_loader = loader.get();
+            loader_map[cache_key] = std::move(loader);
+        }
+    }
+#endif // ARCHITECTURE_x86_64
 }
 
 void VertexLoader::LoadVertex(u32 base_address, int index, int vertex, Shader::InputVertex& input, DebugUtils::MemoryAccessTracker& memory_accesses) {
     ASSERT_MSG(is_setup, "A VertexLoader needs to be setup before loading vertices.");
 
+#ifdef ARCHITECTURE_x86_64
+    // The compiled loader doesn't report its memory accesses, so it is bypassed while recording.
+    // Attribute data is addressed relative to the base address, relying on vertex arrays not
+    // straddling two physical memory regions.
+    if (jit_loader && !(g_debug_context && g_debug_context->recorder)) {
+        const u8* vertex_data = Memory::GetPhysicalPointer(base_address);
+        if (vertex_data != nullptr) {
+            jit_loader->Run(vertex_data, static_cast<u32>(vertex), input);
+            return;
+        }
+    }
+#endif // ARCHITECTURE_x86_64
+
     for (int i = 0; i < num_total_attributes; ++i) {
         if (vertex_attribute_elements[i] != 0) {
             // Load per-vertex data from the loader arrays
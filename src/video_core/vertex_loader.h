@@ -15,7 +15,11 @@ namespace Shader {
 struct InputVertex;
 }
 
+class VertexLoaderJit;
+
 class VertexLoader {
+    friend class VertexLoaderJit;
+
 public:
     VertexLoader() = default;
     explicit VertexLoader(const Pica::Regs& regs) {
@@ -27,14 +31,23 @@ public:
 
     int GetNumTotalAttributes() const { return num_total_attributes; }
 
+    /// Frees all compiled vertex loaders
+    static void ClearCache();
+
 private:
+    /// Computes a hash identifying the attribute layout, used as the key of the loader cache
+    u64 GetLayoutHash() const;
+
     std::array<u32, 16> vertex_attribute_sources;
     std::array<u32, 16> vertex_attribute_strides{};
-    std::array<Regs::VertexAttributeFormat, 16> vertex_attribute_formats;
+    std::array<Regs::VertexAttributeFormat, 16> vertex_attribute_formats{};
     std::array<u32, 16> vertex_attribute_elements{};
     std::array<bool, 16> vertex_attribute_is_default;
     int num_total_attributes = 0;
     bool is_setup = false;
+
+    /// Compiled loader for this layout, or nullptr if the generic path is used
+    const VertexLoaderJit* jit_loader = nullptr;
 };
 
 }  // namespace Pica
@@ -0,0 +1,135 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common/assert.h"
+#include "common/logging/log.h"
+#include "common/x64/abi.h"
+#include "common/x64/cpu_detect.h"
+#include "common/x64/emitter.h"
+
+#include "video_core/pica.h"
+#include "video_core/pica_state.h"
+#include "video_core/shader/shader.h"
+#include "video_core/vertex_loader.h"
+#include "video_core/vertex_loader_jit_x64.h"
+
+namespace Pica {
+
+using namespace Gen;
+
+/// Host pointer to the vertex attribute base address
+static const X64Reg VERTEX_DATA = ABI_PARAM1;
+/// Index of the vertex being loaded
+static const X64Reg VERTEX = ABI_PARAM2;
+/// Pointer to the InputVertex being written
+static const X64Reg INPUT = ABI_PARAM3;
+/// Byte offset of the current attribute's vertex data, relative to VERTEX_DATA
+static const X64Reg OFFSET = RAX;
+/// General purpose scratch register
+static const X64Reg SCRATCH = R10;
+/// SIMD scratch register
+static const X64Reg SCRATCH_XMM = XMM0;
+
+/// Raw bit patterns of the values used to fill up attributes with less than 4 elements
+static const u32 FLOAT_ZERO = 0x00000000;
+static const u32 FLOAT_ONE = 0x3F800000;
+
+void VertexLoaderJit::Compile(const VertexLoader& loader) {
+    program = (CompiledLoader*)GetCodePtr();
+
+    const bool has_sse4_1 = Common::GetCPUCaps().sse4_1;
+
+    for (int i = 0; i < loader.num_total_attributes; ++i) {
+        const int dest_disp = static_cast<int>(offsetof(Shader::InputVertex, attr) + i * sizeof(Math::Vec4<float24>));
+
+        if (loader.vertex_attribute_elements[i] != 0) {
+            const u32 num_elements = loader.vertex_attribute_elements[i];
+            const Regs::VertexAttributeFormat format = loader.vertex_attribute_formats[i];
+            const int source_disp = static_cast<int>(loader.vertex_attribute_sources[i]);
+
+            // OFFSET = stride * vertex, with the same 32-bit wraparound as the generic loader. The
+            // 32-bit multiplication also discards the undefined upper half of the VERTEX argument.
+            IMUL(32, OFFSET, R(VERTEX), Imm32(loader.vertex_attribute_strides[i]));
+
+            auto Source = [&](u32 byte_offset) {
+                return MComplex(VERTEX_DATA, OFFSET, SCALE_1, source_disp + static_cast<int>(byte_offset));
+            };
+
+            if (format == Regs::VertexAttributeFormat::FLOAT) {
+                if (num_elements == 4) {
+                    MOVUPS(SCRATCH_XMM, Source(0));
+                    MOVAPS(MDisp(INPUT, dest_disp), SCRATCH_XMM);
+                } else {
+                    for (u32 comp = 0; comp < num_elements; ++comp) {
+                        MOV(32, R(SCRATCH), Source(comp * 4));
+                        MOV(32, MDisp(INPUT, dest_disp + comp * 4), R(SCRATCH));
+                    }
+                }
+            } else if (num_elements == 4 && has_sse4_1) {
+                // Sign/zero extend all components at once. This is only done for full vectors, as
+                // the extending loads would otherwise read past the end of the attribute.
+                switch (format) {
+                case Regs::VertexAttributeFormat::BYTE:
+                    PMOVSXBD(SCRATCH_XMM, Source(0));
+                    break;
+                case Regs::VertexAttributeFormat::UBYTE:
+                    PMOVZXBD(SCRATCH_XMM, Source(0));
+                    break;
+                case Regs::VertexAttributeFormat::SHORT:
+                    PMOVSXWD(SCRATCH_XMM, Source(0));
+                    break;
+                default:
+                    UNREACHABLE();
+                }
+                CVTDQ2PS(SCRATCH_XMM, R(SCRATCH_XMM));
+                MOVAPS(MDisp(INPUT, dest_disp), SCRATCH_XMM);
+            } else {
+                for (u32 comp = 0; comp < num_elements; ++comp) {
+                    switch (format) {
+                    case Regs::VertexAttributeFormat::BYTE:
+                        MOVSX(32, 8, SCRATCH, Source(comp));
+                        break;
+                    case Regs::VertexAttributeFormat::UBYTE:
+                        MOVZX(32, 8, SCRATCH, Source(comp));
+                        break;
+                    case Regs::VertexAttributeFormat::SHORT:
+                        MOVSX(32, 16, SCRATCH, Source(comp * 2));
+                        break;
+                    default:
+                        UNREACHABLE();
+                    }
+                    CVTSI2SS(SCRATCH_XMM, R(SCRATCH));
+                    MOVSS(MDisp(INPUT, dest_disp + comp * 4), SCRATCH_XMM);
+                }
+            }
+
+            // Default attribute values set if array elements have < 4 components, see
+            // VertexLoader::LoadVertex
+            for (u32 comp = num_elements; comp < 4; ++comp) {
+                MOV(32, MDisp(INPUT, dest_disp + comp * 4), Imm32(comp == 3 ? FLOAT_ONE : FLOAT_ZERO));
+            }
+        } else if (loader.vertex_attribute_is_default[i]) {
+            // Default attributes may change between draws, so they are read at runtime
+            MOV(PTRBITS, R(SCRATCH), ImmPtr(&g_state.vs_default_attributes[i]));
+            MOVUPS(SCRATCH_XMM, MatR(SCRATCH));
+            MOVAPS(MDisp(INPUT, dest_disp), SCRATCH_XMM);
+        }
+    }
+
+    RET();
+
+    uintptr_t size = reinterpret_cast<uintptr_t>(GetCodePtr()) - reinterpret_cast<uintptr_t>(program);
+    ASSERT_MSG(size <= MAX_VERTEX_LOADER_SIZE, "Compiled a vertex loader that exceeds the allocated size!");
+
+    LOG_DEBUG(HW_GPU, "Compiled vertex loader size=%lu", size);
+}
+
+VertexLoaderJit::VertexLoaderJit() {
+    AllocCodeSpace(MAX_VERTEX_LOADER_SIZE);
+}
+
+} // namespace Pica
@@ -0,0 +1,49 @@
+// Copyright 2016 Citra Emulator Project
+// Licensed under GPLv2 or any later version
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+
+#include "common/common_types.h"
+#include "common/x64/emitter.h"
+
+namespace Pica {
+
+namespace Shader {
+struct InputVertex;
+}
+
+class VertexLoader;
+
+/// Memory allocated for each compiled vertex loader (4Kb)
+constexpr size_t MAX_VERTEX_LOADER_SIZE = 1024 * 4;
+
+/**
+ * Vertex loader specialized for a single attribute layout. All format, element count and stride
+ * decisions of VertexLoader::LoadVertex are resolved at compile time, so that loading a vertex only
+ * consists of straight-line fetch and convert code for the enabled attributes.
+ */
+class VertexLoaderJit : public Gen::XCodeBlock {
+public:
+    VertexLoaderJit();
+
+    /**
+     * Loads the attributes of a vertex
+     * @param vertex_data Host pointer to the vertex attribute base address
+     * @param vertex Index of the vertex to load
+     * @param input Destination for the loaded attributes
+     */
+    void Run(const u8* vertex_data, u32 vertex, Shader::InputVertex& input) const {
+        program(vertex_data, vertex, &input);
+    }
+
+    void Compile(const VertexLoader& loader);
+
+private:
+    using CompiledLoader = void(const u8* vertex_data, u32 vertex, Shader::InputVertex* input);
+    CompiledLoader* program = nullptr;
+};
+
+} // namespace Pica
@@ -6,9 +6,12 @@
 
 #include "common/logging/log.h"
 
+#include "core/settings.h"
+
 #include "video_core/pica.h"
 #include "video_core/renderer_base.h"
 #include "video_core/video_core.h"
+#include "video_core/renderer_null/renderer_null.h"
 #include "video_core/renderer_opengl/renderer_opengl.h"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -21,7 +24,13 @@ std::unique_ptr<RendererBase> g_renderer;             ///< Renderer plugin
 
 std::atomic<bool> g_hw_renderer_enabled;
 std::atomic<bool> g_shader_jit_enabled;
+std::atomic<bool> g_shader_jit_disk_cache_enabled;
+std::atomic<bool> g_shader_jit_async_enabled;
+std::atomic<bool> g_shader_jit_batch_enabled;
 std::atomic<bool> g_scaled_resolution_enabled;
+std::atomic<int> g_sw_rasterizer_threads;
+std::atomic<int> g_vertex_shader_threads;
+std::atomic<int> g_surface_cache_size;
 std::atomic<bool> g_vsync_enabled;
 
 /// Initialize the video core
@@ -29,7 +38,11 @@ bool Init(EmuWindow* emu_window) {
     Pica::Init();
 
     g_emu_window = emu_window;
-    g_renderer = std::make_unique<RendererOpenGL>();
+    if (Settings::values.use_null_renderer) {
+        g_renderer = std::make_unique<RendererNull>();
+    } else {
+        g_renderer = std::make_unique<RendererOpenGL>();
+    }
     g_renderer->SetWindow(g_emu_window);
     if (g_renderer->Init()) {
         LOG_DEBUG(Render, "initialized OK");
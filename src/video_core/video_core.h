@@ -36,7 +36,13 @@ extern EmuWindow*                    g_emu_window; ///< Emu window
 // TODO: Wrap these in a user settings struct along with any other graphics settings (often set from qt ui)
 extern std::atomic<bool> g_hw_renderer_enabled;
 extern std::atomic<bool> g_shader_jit_enabled;
+extern std::atomic<bool> g_shader_jit_disk_cache_enabled;
+extern std::atomic<bool> g_shader_jit_async_enabled;
+extern std::atomic<bool> g_shader_jit_batch_enabled;
 extern std::atomic<bool> g_scaled_resolution_enabled;
+extern std::atomic<int> g_sw_rasterizer_threads; ///< 0 selects a thread count automatically
+extern std::atomic<int> g_vertex_shader_threads;  ///< 0 selects a thread count automatically
+extern std::atomic<int> g_surface_cache_size;     ///< In MiB, 0 disables eviction
 
 /// Start the video core
 void Start();